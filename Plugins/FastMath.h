@@ -0,0 +1,84 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+// Approximations used when drawing distortion maps, where millions of
+// values are computed per frame but only need to be accurate enough to
+// pick a color.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define YT_SSE2 1
+#	include <emmintrin.h>
+#endif
+
+#include <string.h>
+
+#define FAST_MATH_LN2       0.69314718056f
+#define FAST_MATH_LOG10_E   0.43429448190f
+#define FAST_MATH_SQRT2     1.41421356237f
+
+// Natural logarithm of x>0. x is split into 2^e*m with m in [sqrt(0.5), sqrt(2)),
+// and log(m) = 2*atanh(t) with t = (m-1)/(m+1) is summed up to t^7, relative
+// error is below 1e-7. Zero gives a large negative number instead of -inf.
+inline float FastLog(float x)
+{
+	unsigned int bits;
+	memcpy(&bits, &x, sizeof(bits));
+	int e = (int)((bits>>23) & 0xFF) - 127;
+	bits = (bits & 0x007FFFFF) | 0x3F800000;
+	float m;
+	memcpy(&m, &bits, sizeof(m));
+	if (m > FAST_MATH_SQRT2)
+	{
+		m *= 0.5f;
+		e++;
+	}
+
+	float t = (m-1.0f)/(m+1.0f);
+	float t2 = t*t;
+	float s = t*(2.0f + t2*(2.0f/3 + t2*(2.0f/5 + t2*(2.0f/7))));
+	return e*FAST_MATH_LN2 + s;
+}
+
+#ifdef YT_SSE2
+inline __m128 FastLog(__m128 x)
+{
+	__m128i bits = _mm_castps_si128(x);
+	__m128i e = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xFF)), _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+	__m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(FAST_MATH_SQRT2));
+	m = _mm_sub_ps(m, _mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+	__m128 ef = _mm_add_ps(_mm_cvtepi32_ps(e), _mm_and_ps(big, _mm_set1_ps(1.0f)));
+
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+	__m128 t2 = _mm_mul_ps(t, t);
+	__m128 s = _mm_add_ps(_mm_set1_ps(2.0f/5), _mm_mul_ps(t2, _mm_set1_ps(2.0f/7)));
+	s = _mm_add_ps(_mm_set1_ps(2.0f/3), _mm_mul_ps(t2, s));
+	s = _mm_add_ps(_mm_set1_ps(2.0f), _mm_mul_ps(t2, s));
+	s = _mm_mul_ps(t, s);
+	return _mm_add_ps(_mm_mul_ps(ef, _mm_set1_ps(FAST_MATH_LN2)), s);
+}
+#endif
+
+// dst[i] = bias + scale*log10(src[i]), src and dst may be the same
+inline void FastLog10(const float* src, float* dst, int count, float scale, float bias)
+{
+	int i = 0;
+	float s = scale*FAST_MATH_LOG10_E;
+#ifdef YT_SSE2
+	__m128 s4 = _mm_set1_ps(s);
+	__m128 bias4 = _mm_set1_ps(bias);
+	for (; i+4<=count; i+=4)
+	{
+		__m128 v = FastLog(_mm_loadu_ps(src+i));
+		_mm_storeu_ps(dst+i, _mm_add_ps(bias4, _mm_mul_ps(s4, v)));
+	}
+#endif
+	for (; i<count; i++)
+	{
+		dst[i] = bias + s*FastLog(src[i]);
+	}
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+
+// Runs func(from, to) on ranges that together cover [0, count). Ranges are
+// at least grain long. Calling thread runs one range itself, and also any
+// range for which no idle thread of the global pool is available, so it
+// never waits for a thread that has not been started.
+template <class Func>
+class ParallelForTask : public QRunnable
+{
+public:
+	ParallelForTask(Func& func, int from, int to, QSemaphore* done) :
+		m_Func(func), m_From(from), m_To(to), m_Done(done) {}
+
+	void run()
+	{
+		m_Func(m_From, m_To);
+		m_Done->release();
+	}
+private:
+	Func& m_Func;
+	int m_From;
+	int m_To;
+	QSemaphore* m_Done;
+};
+
+template <class Func>
+void ParallelFor(int count, int grain, Func& func)
+{
+	int chunks = qMin(QThread::idealThreadCount(), (count+grain-1)/qMax(grain, 1));
+	if (chunks <= 1)
+	{
+		func(0, count);
+		return;
+	}
+
+	int size = (count+chunks-1)/chunks;
+	QSemaphore done;
+	int started = 0;
+	for (int i=1; i<chunks; i++)
+	{
+		int from = i*size;
+		int to = qMin(from+size, count);
+		if (from >= to)
+		{
+			break;
+		}
+
+		ParallelForTask<Func>* task = new ParallelForTask<Func>(func, from, to, &done);
+		if (QThreadPool::globalInstance()->tryStart(task))
+		{
+			started++;
+		}else
+		{
+			delete task;
+			func(from, to);
+		}
+	}
+
+	func(0, qMin(size, count));
+	done.acquire(started);
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef PLANE_SCALING_H
+#define PLANE_SCALING_H
+
+#include "FastMath.h"
+
+// Exactly half size, each output pixel is the rounded mean of a 2x2 block.
+// src and dst may be the same plane with the same stride, each output row
+// is written over input rows that are already read.
+inline void HalvePlane(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int width, int height)
+{
+	for (int i=0; i<height; i++)
+	{
+		const unsigned char* row0 = src+(2*i)*srcStride;
+		const unsigned char* row1 = row0+srcStride;
+		unsigned char* out = dst+i*dstStride;
+
+		int j = 0;
+#ifdef YT_SSE2
+		__m128i mask = _mm_set1_epi16(0x00FF);
+		for (; j+16<=width; j+=16)
+		{
+			__m128i lo = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(row0+2*j)), _mm_loadu_si128((const __m128i*)(row1+2*j)));
+			__m128i hi = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(row0+2*j+16)), _mm_loadu_si128((const __m128i*)(row1+2*j+16)));
+			__m128i even = _mm_packus_epi16(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+			__m128i odd = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+			_mm_storeu_si128((__m128i*)(out+j), _mm_avg_epu8(even, odd));
+		}
+#endif
+		for (; j<width; j++)
+		{
+			int a = (row0[2*j]+row1[2*j]+1)>>1;
+			int b = (row0[2*j+1]+row1[2*j+1]+1)>>1;
+			out[j] = (unsigned char)((a+b+1)>>1);
+		}
+	}
+}
+
+#endif
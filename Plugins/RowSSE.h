@@ -0,0 +1,55 @@
+#ifndef ROW_SSE_H
+#define ROW_SSE_H
+
+// Sum of squared errors of 8 bit rows, shared by the basic measures and the
+// statistics the host computes while converting frames, so both give the
+// same result. Integer arithmetic only, so scalar and SSE2 code agree.
+
+#include "FastMath.h"
+#include <QtCore/QtGlobal>
+
+#ifdef YT_SSE2
+// Adds squared differences of 16 pixels to the four 32 bit lanes of acc.
+// Each lane gets 4 squares per 16 pixels, so it does not overflow for rows
+// below 264000 pixels.
+inline __m128i SSE16(__m128i acc, __m128i a, __m128i b)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i dlo = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+	__m128i dhi = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+	acc = _mm_add_epi32(acc, _mm_madd_epi16(dlo, dlo));
+	return _mm_add_epi32(acc, _mm_madd_epi16(dhi, dhi));
+}
+
+inline quint64 SumLanes32(__m128i v)
+{
+	quint32 lanes[4];
+	_mm_storeu_si128((__m128i*)lanes, v);
+	return (quint64)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
+
+inline quint64 RowSSE(const unsigned char* p1, const unsigned char* p2, int width)
+{
+	int j = 0;
+	quint64 sum = 0;
+#ifdef YT_SSE2
+	if (width >= 16)
+	{
+		__m128i acc = _mm_setzero_si128();
+		for (; j+16<=width; j+=16)
+		{
+			acc = SSE16(acc, _mm_loadu_si128((const __m128i*)(p1+j)), _mm_loadu_si128((const __m128i*)(p2+j)));
+		}
+		sum = SumLanes32(acc);
+	}
+#endif
+	for (; j<width; j++)
+	{
+		int diff = ((int)p1[j])-((int)p2[j]);
+		sum += diff*diff;
+	}
+	return sum;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <QtCore/QVector>
+#include <QtCore/QList>
+#include <QtCore/QtAlgorithms>
+
+// Non-decreasing presentation time stamps of a source, one per frame, kept
+// in one contiguous array. Frame index to PTS is a lookup, and PTS to frame
+// index a binary search, so seeking does not depend on length of video.
+class Timeline
+{
+public:
+	void Set(const QList<unsigned int>& timeStamps)
+	{
+		m_TimeStamps = timeStamps.toVector();
+	}
+
+	void Clear() {m_TimeStamps.clear();}
+	bool IsEmpty() const {return m_TimeStamps.isEmpty();}
+	int Size() const {return m_TimeStamps.size();}
+	unsigned int Last() const {return m_TimeStamps.last();}
+	// pts must not be less than Last()
+	void Append(unsigned int pts) {m_TimeStamps.append(pts);}
+
+	// PTS of frame index, last PTS if index is past the end
+	unsigned int PTS(unsigned int index) const
+	{
+		if (index >= (unsigned int)m_TimeStamps.size())
+		{
+			index = m_TimeStamps.size()-1;
+		}
+		return m_TimeStamps.at(index);
+	}
+
+	// Index of the frame shown at pts, i.e. last one with PTS <= pts,
+	// first one if pts is before all frames
+	unsigned int Index(unsigned int pts) const
+	{
+		QVector<unsigned int>::const_iterator it =
+			qUpperBound(m_TimeStamps.constBegin(), m_TimeStamps.constEnd(), pts);
+		int index = (it-m_TimeStamps.constBegin())-1;
+		return qMax(index, 0);
+	}
+
+	// Append first count time stamps to list
+	void ToList(QList<unsigned int>& list, int count) const
+	{
+		count = qMin(count, m_TimeStamps.size());
+		list.reserve(list.size()+count);
+		for (int i=0; i<count; i++)
+		{
+			list.append(m_TimeStamps.at(i));
+		}
+	}
+
+private:
+	QVector<unsigned int> m_TimeStamps;
+};
+
+#endif
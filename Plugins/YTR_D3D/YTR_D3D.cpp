@@ -37,8 +37,15 @@ void YTR_D3DPlugin::ReleaseRenderer( Renderer* parent )
 
 
 YTR_D3D::YTR_D3D(Host* host, QWidget* widget, const QString& name) 
-	: m_Host(host), D3DWidget(widget), m_NeedReset(false), m_ResetLastCheckedWidth(0), m_ResetLastCheckedHeight(0)
+	: m_Host(host), D3DWidget(widget), m_NeedReset(false), m_YV12Supported(false), m_ResetLastCheckedWidth(0), m_ResetLastCheckedHeight(0)
 {
+	if (d3D)
+	{
+		HRESULT hr = d3D->CheckDeviceFormatConversion(adapter, D3DDEVTYPE_HAL, 
+			(D3DFORMAT)MAKEFOURCC('Y','V','1','2'), d3dpp.BackBufferFormat);
+		m_YV12Supported = SUCCEEDED(hr);
+	}
+
 	QTimer *timer = new QTimer(widget);
 	connect(timer, SIGNAL(timeout()), this, SLOT(OnResizeTimer()));
 
@@ -147,8 +154,9 @@ RESULT YTR_D3D::RenderScene(const FrameList& frames)
 			dstRect->bottom *= scale_y;				
 		}
 
+		D3DTEXTUREFILTERTYPE filter = frame->Info(RENDER_NEAREST).toBool()?D3DTEXF_POINT:D3DTEXF_LINEAR;
 		hr = d3DDevice->StretchRect(pSurface, srcRect, 
-			pRT, dstRect, D3DTEXF_LINEAR);
+			pRT, dstRect, filter);
 	}
 
 	hr = d3DDevice->Present( 0, 0, 0, 0 );
@@ -162,6 +170,15 @@ RESULT YTR_D3D::RenderScene(const FrameList& frames)
 	return OK;
 }
 
+bool YTR_D3D::IsColorSupported( COLOR_FORMAT color, int width, int height )
+{
+	if ((width & 1) || (height & 1))
+	{
+		return false;
+	}
+	return m_YV12Supported && (color == I420 || color == Y800);
+}
+
 RESULT YTR_D3D::Allocate( FramePtr& frame, FormatPtr sourceFormat )
 {
 	IDirect3DDevice9* d3DDevice = GetDevice();
@@ -172,20 +189,30 @@ RESULT YTR_D3D::Allocate( FramePtr& frame, FormatPtr sourceFormat )
 		return E_UNKNOWN;
 	}
 
+	COLOR_FORMAT color = sourceFormat->Color();
+	bool yv12 = IsColorSupported(color, sourceFormat->Width(), sourceFormat->Height());
+
 	IDirect3DSurface9* surface = NULL;
 	HRESULT hr = d3DDevice->CreateOffscreenPlainSurface(sourceFormat->Width(),
-		sourceFormat->Height(), D3DFMT_X8R8G8B8, D3DPOOL_DEFAULT, &surface, NULL);
+		sourceFormat->Height(), yv12 ? (D3DFORMAT)MAKEFOURCC('Y','V','1','2') : D3DFMT_X8R8G8B8, 
+		D3DPOOL_DEFAULT, &surface, NULL);
 	if (FAILED(hr))
 	{
 		return E_RENDER_RESET;
 	}
 
 	D3DLOCKED_RECT d3d_lr;
-	hr = surface->LockRect(&d3d_lr, NULL, D3DLOCK_READONLY);
+	hr = surface->LockRect(&d3d_lr, NULL, yv12 ? 0 : D3DLOCK_READONLY);
 	if (FAILED(hr))
 	{
 		return E_RENDER_RESET;
 	}
+	if (color == Y800)
+	{
+		// Only luma is copied for Y800, keep chroma neutral
+		unsigned char* chroma = (unsigned char*)d3d_lr.pBits + d3d_lr.Pitch*sourceFormat->Height();
+		memset(chroma, 128, d3d_lr.Pitch*sourceFormat->Height()/2);
+	}
 	surface->UnlockRect();
 	// D3DSURFACE_DESC d3d_sd;
 	// surface->GetDesc(&d3d_sd);
@@ -194,13 +221,20 @@ RESULT YTR_D3D::Allocate( FramePtr& frame, FormatPtr sourceFormat )
 	frame->SetFormat(sourceFormat);
 
 	frame->SetExternData((void*) surface);
-	// support only rgb32
 	frame->Format()->SetStride(0, d3d_lr.Pitch);
 	frame->Format()->SetStride(1,0);
 	frame->Format()->SetStride(2,0);
 	frame->Format()->SetStride(3,0);
 
-	frame->Format()->SetColor(XRGB32);
+	if (color == I420 && yv12)
+	{
+		frame->Format()->SetStride(1, d3d_lr.Pitch/2);
+		frame->Format()->SetStride(2, d3d_lr.Pitch/2);
+	}else if (!yv12)
+	{
+		// everything else is converted to rgb32
+		frame->Format()->SetColor(XRGB32);
+	}
 	
 	return OK;
 }
@@ -231,6 +265,16 @@ RESULT YTR_D3D::GetFrame( FramePtr& frame )
 	frame->SetData(2, 0);
 	frame->SetData(3, 0);
 
+	if (frame->Format()->Color() == I420)
+	{
+		// YV12 surface, V plane comes before U plane
+		int height = frame->Format()->Height();
+		unsigned char* v = (unsigned char*)d3d_lr.pBits + d3d_lr.Pitch*height;
+		unsigned char* u = v + (d3d_lr.Pitch/2)*(height/2);
+		frame->SetData(1, u);
+		frame->SetData(2, v);
+	}
+
 	counter ++;
 
 	return OK;
@@ -35,6 +35,10 @@ public:
 	virtual QWidget* GetWidget() {return this;}
 	virtual RESULT RenderScene(const FrameList& frames);
 
+	// I420 and Y800 go to YV12 surfaces if the device can stretch them and
+	// both dimensions are even, as YV12 requires
+	virtual bool IsColorSupported(COLOR_FORMAT color, int width, int height);
+
 	// Allocate render specific buffers
 	virtual RESULT Allocate(FramePtr& frame, FormatPtr sourceFormat);
 	virtual RESULT Deallocate(FramePtr frame);
@@ -57,6 +61,7 @@ public slots:
 protected:
 	Host* m_Host;
 	bool m_NeedReset;
+	bool m_YV12Supported;
 
 	int counter;
 	int m_ResetLastCheckedWidth;
@@ -0,0 +1,276 @@
+#include "../YT_Interface.h"
+#include "RawDirectReader.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
+
+#if defined(Q_WS_WIN)
+#	include <windows.h>
+#else
+#	include <unistd.h>
+#	include <fcntl.h>
+#	include <errno.h>
+#endif
+#include <string.h>
+
+#define ALIGN_DOWN(x)	((x)&~(qint64)(RAW_DIRECT_ALIGNMENT-1))
+#define ALIGN_UP(x)		ALIGN_DOWN((x)+RAW_DIRECT_ALIGNMENT-1)
+
+RawDirectReader::RawDirectReader( const QString& path ) : m_Path(path),
+#if defined(Q_WS_WIN)
+	m_Handle(INVALID_HANDLE_VALUE),
+#else
+	m_Fd(-1), m_Direct(false),
+#endif
+	m_Current(0), m_Stop(false)
+{
+	for (int i=0; i<2; i++)
+	{
+		memset(&m_Slots[i], 0, sizeof(Slot));
+		m_Slots[i].state = SLOT_EMPTY;
+	}
+}
+
+RawDirectReader::~RawDirectReader()
+{
+	Stop();
+	Close();
+
+	for (int i=0; i<2; i++)
+	{
+		qFreeAligned(m_Slots[i].buffer);
+	}
+}
+
+bool RawDirectReader::Open()
+{
+#if defined(Q_WS_WIN)
+	m_Handle = CreateFileW((LPCWSTR)m_Path.utf16(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE,
+		NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING|FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_Handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+#else
+	QByteArray name = QFile::encodeName(m_Path);
+#	if defined(O_DIRECT)
+	m_Fd = ::open(name.constData(), O_RDONLY|O_DIRECT);
+	m_Direct = m_Fd >= 0;
+#	endif
+	if (m_Fd < 0)
+	{
+		// File system without O_DIRECT support, like tmpfs
+		m_Fd = ::open(name.constData(), O_RDONLY);
+	}
+	if (m_Fd < 0)
+	{
+		return false;
+	}
+#	if defined(F_NOCACHE)
+	fcntl(m_Fd, F_NOCACHE, 1);
+	m_Direct = true;
+#	endif
+#endif
+
+	start();
+	return true;
+}
+
+void RawDirectReader::Stop()
+{
+	m_Mutex.lock();
+	m_Stop = true;
+	m_Submitted.wakeAll();
+	m_Mutex.unlock();
+
+	wait();
+}
+
+void RawDirectReader::Close()
+{
+#if defined(Q_WS_WIN)
+	if (m_Handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_Handle);
+		m_Handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_Fd >= 0)
+	{
+		::close(m_Fd);
+		m_Fd = -1;
+	}
+#endif
+}
+
+const char* RawDirectReader::Read( qint64 offset, unsigned int size )
+{
+	QMutexLocker locker(&m_Mutex);
+
+	// Usually frame was read ahead already, or is being read
+	int current = -1;
+	for (int i=0; i<2; i++)
+	{
+		const Slot& slot = m_Slots[i];
+		if (slot.offset == offset && slot.size == size &&
+			(slot.state == SLOT_PENDING || slot.state == SLOT_READY))
+		{
+			current = i;
+		}
+	}
+
+	if (current < 0)
+	{
+		// Seek, reuse slot not returned last time
+		current = m_Current^1;
+		while (m_Slots[current].state == SLOT_PENDING && !m_Stop)
+		{
+			m_Completed.wait(&m_Mutex);
+		}
+		Submit(current, offset, size);
+	}
+
+	while (m_Slots[current].state == SLOT_PENDING && !m_Stop)
+	{
+		m_Completed.wait(&m_Mutex);
+	}
+
+	Slot& slot = m_Slots[current];
+	if (slot.state != SLOT_READY)
+	{
+		slot.state = SLOT_EMPTY;
+		return NULL;
+	}
+	m_Current = current;
+
+	// Read next frame while this one is copied
+	int next = current^1;
+	while (m_Slots[next].state == SLOT_PENDING && !m_Stop)
+	{
+		m_Completed.wait(&m_Mutex);
+	}
+	Submit(next, offset+size, size);
+
+	return slot.buffer+(offset-slot.start);
+}
+
+void RawDirectReader::Submit( int index, qint64 offset, unsigned int size )
+{
+	Slot& slot = m_Slots[index];
+	slot.offset = offset;
+	slot.size = size;
+	slot.start = ALIGN_DOWN(offset);
+	slot.length = (size_t)(ALIGN_UP(offset+size)-slot.start);
+
+	if (slot.capacity < slot.length)
+	{
+		qFreeAligned(slot.buffer);
+		slot.buffer = (char*)qMallocAligned(slot.length, RAW_DIRECT_ALIGNMENT);
+		slot.capacity = slot.buffer?slot.length:0;
+	}
+
+	slot.state = slot.buffer?SLOT_PENDING:SLOT_FAILED;
+	m_Submitted.wakeAll();
+}
+
+qint64 RawDirectReader::ReadAligned( char* buffer, qint64 start, size_t length )
+{
+	size_t done = 0;
+	while (done < length)
+	{
+#if defined(Q_WS_WIN)
+		LARGE_INTEGER pos;
+		pos.QuadPart = start+done;
+		DWORD n = 0;
+		if (!SetFilePointerEx(m_Handle, pos, NULL, FILE_BEGIN) ||
+			!ReadFile(m_Handle, buffer+done, (DWORD)(length-done), &n, NULL))
+		{
+			break;
+		}
+#else
+		ssize_t n = pread(m_Fd, buffer+done, length-done, start+done);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+#	if defined(O_DIRECT)
+		if (n < 0 && errno == EINVAL && m_Direct)
+		{
+			// Opened but not supported for reading, read through cache instead
+			fcntl(m_Fd, F_SETFL, fcntl(m_Fd, F_GETFL)&~O_DIRECT);
+			m_Direct = false;
+			continue;
+		}
+#	endif
+#endif
+		if (n <= 0)
+		{
+			break;
+		}
+		done += n;
+
+		if (done % RAW_DIRECT_ALIGNMENT)
+		{
+			// Short read at end of file
+			break;
+		}
+	}
+
+#if !defined(Q_WS_WIN)
+#	if defined(POSIX_FADV_DONTNEED)
+	if (!m_Direct)
+	{
+		// Drop the pages at least after they were read
+		posix_fadvise(m_Fd, start, length, POSIX_FADV_DONTNEED);
+	}
+#	endif
+#endif
+
+	return done;
+}
+
+void RawDirectReader::run()
+{
+	while (true)
+	{
+		m_Mutex.lock();
+		int index = -1;
+		while (!m_Stop && index < 0)
+		{
+			for (int i=0; i<2 && index<0; i++)
+			{
+				if (m_Slots[i].state == SLOT_PENDING)
+				{
+					index = i;
+				}
+			}
+
+			if (index < 0)
+			{
+				m_Submitted.wait(&m_Mutex);
+			}
+		}
+
+		if (m_Stop)
+		{
+			m_Completed.wakeAll();
+			m_Mutex.unlock();
+			break;
+		}
+
+		// Slot is not changed by Read() while it is pending
+		Slot& slot = m_Slots[index];
+		char* buffer = slot.buffer;
+		qint64 start = slot.start;
+		size_t length = slot.length;
+		qint64 needed = slot.offset+slot.size-slot.start;
+		m_Mutex.unlock();
+
+		qint64 n = ReadAligned(buffer, start, length);
+
+		m_Mutex.lock();
+		slot.state = (n >= needed)?SLOT_READY:SLOT_FAILED;
+		m_Completed.wakeAll();
+		m_Mutex.unlock();
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef RAW_DIRECT_READER_H
+#define RAW_DIRECT_READER_H
+
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QString>
+
+// Alignment of file offsets, read sizes and buffers for unbuffered reads,
+// covers both 512 byte and 4K sectors
+#define RAW_DIRECT_ALIGNMENT 4096
+
+// Reads frames of a raw file bypassing the page cache, with O_DIRECT or
+// FILE_FLAG_NO_BUFFERING, so one pass over a huge file does not evict
+// everything else from memory. Two buffers are used: while the caller
+// copies a frame out of one, the next frame is read into the other on the
+// reader thread.
+class RawDirectReader : public QThread
+{
+public:
+	RawDirectReader(const QString& path);
+	~RawDirectReader();
+
+	// Returns false if file can not be opened
+	bool Open();
+	void Stop();
+
+	// Reads size bytes at offset, returns NULL at end of file or on error.
+	// Data stays valid until next call. Data following it is read ahead.
+	const char* Read(qint64 offset, unsigned int size);
+
+private:
+	enum SlotState
+	{
+		SLOT_EMPTY,
+		SLOT_PENDING,
+		SLOT_READY,
+		SLOT_FAILED
+	};
+
+	struct Slot
+	{
+		char* buffer;
+		size_t capacity;
+		qint64 offset;	// requested range
+		unsigned int size;
+		qint64 start;	// aligned range actually read
+		size_t length;
+		SlotState state;
+	};
+
+	void run();
+	// Queue read of range into slot, m_Mutex has to be locked
+	void Submit(int slot, qint64 offset, unsigned int size);
+	// Reads aligned range, returns number of bytes read
+	qint64 ReadAligned(char* buffer, qint64 start, size_t length);
+	void Close();
+
+	QString m_Path;
+#if defined(Q_WS_WIN)
+	void* m_Handle;
+#else
+	int m_Fd;
+	bool m_Direct;	// O_DIRECT was accepted by the file system
+#endif
+
+	QMutex m_Mutex;
+	QWaitCondition m_Submitted;
+	QWaitCondition m_Completed;
+	Slot m_Slots[2];
+	int m_Current; // slot returned by last Read()
+	volatile bool m_Stop;
+};
+
+#endif
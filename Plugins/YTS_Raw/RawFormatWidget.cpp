@@ -69,6 +69,8 @@ RawFormatWidget::RawFormatWidget(YTS_Raw* r, QWidget *parent) : QWidget(parent),
 	ui.Stride3->setValidator(new QIntValidator(ui.Stride3));
 
 	connect(ui.Apply, SIGNAL(clicked()), this, SLOT(OnApply()));
+	connect(ui.Follow, SIGNAL(toggled(bool)), this, SLOT(OnFollow(bool)));
+	connect(ui.Unbuffered, SIGNAL(toggled(bool)), this, SLOT(OnUnbuffered(bool)));
 }
 
 RawFormatWidget::~RawFormatWidget()
@@ -91,6 +93,19 @@ void RawFormatWidget::OnApply()
 	rawSource->ReInit(m_Format, fps);
 }
 
+void RawFormatWidget::OnFollow( bool follow )
+{
+	rawSource->SetFollow(follow);
+}
+
+void RawFormatWidget::OnUnbuffered( bool unbuffered )
+{
+	if (!rawSource->SetUnbuffered(unbuffered))
+	{
+		ui.Unbuffered->setChecked(rawSource->IsUnbuffered());
+	}
+}
+
 void RawFormatWidget::showEvent( QShowEvent *event )
 {
 	if (!m_Format)
@@ -115,6 +130,10 @@ void RawFormatWidget::showEvent( QShowEvent *event )
 	}
 	ui.Color->setCurrentIndex(idx);
 	ui.FPS->setValue(info.maxFps);
+	ui.Follow->setChecked(rawSource->IsFollowing());
+	ui.Follow->setEnabled(!RawStream::IsStreamPath(rawSource->GetPath()));
+	ui.Unbuffered->setChecked(rawSource->IsUnbuffered());
+	ui.Unbuffered->setEnabled(!RawStream::IsStreamPath(rawSource->GetPath()));
 	/*ui.Stride0->setText(QString::number(info.format->Stride(0)));
 	ui.Stride1->setText(QString::number(info.format->Stride(1)));
 	ui.Stride2->setText(QString::number(info.format->Stride(2)));
@@ -20,6 +20,8 @@ protected:
 	void showEvent(QShowEvent *event);
 public slots:
 	void OnApply();
+	void OnFollow(bool);
+	void OnUnbuffered(bool);
 private:
 	Ui::RawFormatWidget ui;
 	YTS_Raw* rawSource;
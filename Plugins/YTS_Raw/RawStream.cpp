@@ -0,0 +1,335 @@
+#include "../YT_Interface.h"
+#include "RawStream.h"
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <string.h>
+
+#if defined(Q_OS_UNIX)
+#	include <unistd.h>
+#	include <fcntl.h>
+#	include <errno.h>
+#	include <poll.h>
+#	include <sys/stat.h>
+#	include <sys/socket.h>
+#	include <sys/un.h>
+#	define RAW_STREAM_POLL 1
+#else
+#	include <windows.h>
+#endif
+
+// Interval to check for stop while waiting for data, ms
+#define RAW_STREAM_POLL_INTERVAL 100
+// Interval to peek pipe for data where it can not be polled, ms
+#define RAW_STREAM_PEEK_INTERVAL 5
+
+RawStream::RawStream( const QString& path, unsigned int frameSize ) :
+	m_Path(path), m_Fd(-1), m_Handle(NULL), m_Pipe(false), m_Head(0), m_Count(0),
+	m_FrameSize(frameSize), m_NewFrameSize(frameSize), m_Generation(0), m_Peeked(false), m_FramesRead(0), m_Ended(false), m_Stop(false)
+{
+	m_Ring.resize(RAW_STREAM_BUFFER_FRAMES);
+}
+
+RawStream::~RawStream()
+{
+	Stop();
+}
+
+bool RawStream::IsStreamPath( const QString& path )
+{
+	if (path.startsWith(SOURCE_STDIN_PREFIX) || path.startsWith(SOURCE_SOCKET_PREFIX))
+	{
+		return true;
+	}
+
+#if defined(RAW_STREAM_POLL)
+	// Named pipe, or socket opened as a file
+	QFileInfo info(path);
+	return info.exists() && !info.isFile() && !info.isDir();
+#else
+	return path.startsWith("\\\\.\\pipe\\");
+#endif
+}
+
+void RawStream::Stop()
+{
+	m_Mutex.lock();
+	m_Stop = true;
+	m_NotFull.wakeAll();
+	m_Mutex.unlock();
+
+#if defined(RAW_STREAM_POLL)
+	// Reader may wait in open() for the writer of a named pipe, open it for
+	// writing to let it through
+	QByteArray name = QFile::encodeName(m_Path);
+	while (!wait(RAW_STREAM_POLL_INTERVAL))
+	{
+		struct stat st;
+		if (stat(name.constData(), &st) == 0 && S_ISFIFO(st.st_mode))
+		{
+			int fd = ::open(name.constData(), O_WRONLY|O_NONBLOCK);
+			if (fd >= 0)
+			{
+				::close(fd);
+			}
+		}
+	}
+#else
+	// Reads do not block for longer than the peek interval
+	wait();
+#endif
+	Close();
+}
+
+void RawStream::SetFrameSize( unsigned int frameSize )
+{
+	QMutexLocker locker(&m_Mutex);
+	m_NewFrameSize = frameSize;
+	if (!m_Peeked)
+	{
+		ApplyFrameSize();
+	}
+}
+
+void RawStream::ApplyFrameSize()
+{
+	if (m_NewFrameSize == m_FrameSize)
+	{
+		return;
+	}
+
+	m_FrameSize = m_NewFrameSize;
+	m_Generation++;
+	m_Head = 0;
+	m_Count = 0;
+	m_NotFull.wakeAll();
+}
+
+const char* RawStream::Peek()
+{
+	QMutexLocker locker(&m_Mutex);
+	if (m_Count == 0)
+	{
+		return NULL;
+	}
+
+	m_Peeked = true;
+	return m_Ring.at(m_Head).constData();
+}
+
+void RawStream::Release()
+{
+	QMutexLocker locker(&m_Mutex);
+	if (m_Count > 0)
+	{
+		m_Head = (m_Head+1)%m_Ring.size();
+		m_Count--;
+		m_NotFull.wakeAll();
+	}
+
+	m_Peeked = false;
+	ApplyFrameSize();
+}
+
+bool RawStream::AtEnd()
+{
+	QMutexLocker locker(&m_Mutex);
+	return m_Ended && m_Count == 0;
+}
+
+unsigned int RawStream::FramesRead()
+{
+	QMutexLocker locker(&m_Mutex);
+	return m_FramesRead;
+}
+
+bool RawStream::Open()
+{
+	QString path = m_Path;
+#if defined(RAW_STREAM_POLL)
+	if (path.startsWith(SOURCE_STDIN_PREFIX))
+	{
+		m_Fd = dup(0);
+	}else if (path.startsWith(SOURCE_SOCKET_PREFIX))
+	{
+		path = path.mid(strlen(SOURCE_SOCKET_PREFIX));
+		QByteArray name = QFile::encodeName(path);
+
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, name.constData(), sizeof(addr.sun_path)-1);
+
+		// Wait for the writing process to create the socket
+		while (!m_Stop)
+		{
+			m_Fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (m_Fd < 0 || ::connect(m_Fd, (struct sockaddr*)&addr, sizeof(addr)) == 0)
+			{
+				break;
+			}
+			::close(m_Fd);
+			m_Fd = -1;
+			msleep(RAW_STREAM_POLL_INTERVAL);
+		}
+	}else
+	{
+		// Waits for the writer, so that end of file is not seen before it
+		// has opened the pipe. Stop() ends the wait.
+		do
+		{
+			m_Fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+		} while (m_Fd < 0 && errno == EINTR && !m_Stop);
+
+		if (m_Fd >= 0)
+		{
+			fcntl(m_Fd, F_SETFL, fcntl(m_Fd, F_GETFL)|O_NONBLOCK);
+		}
+	}
+	return m_Fd >= 0;
+#else
+	if (path.startsWith(SOURCE_STDIN_PREFIX))
+	{
+		HANDLE process = GetCurrentProcess();
+		if (!DuplicateHandle(process, GetStdHandle(STD_INPUT_HANDLE), process, &m_Handle,
+			0, FALSE, DUPLICATE_SAME_ACCESS))
+		{
+			m_Handle = NULL;
+		}
+	}else
+	{
+		m_Handle = CreateFileW((const wchar_t*)path.utf16(), GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+		if (m_Handle == INVALID_HANDLE_VALUE)
+		{
+			m_Handle = NULL;
+		}
+	}
+	if (!m_Handle)
+	{
+		return false;
+	}
+
+	// Console reads block until input and can not be stopped, pipes are only
+	// read when data is waiting, reads of files always return
+	DWORD type = GetFileType(m_Handle);
+	m_Pipe = (type == FILE_TYPE_PIPE);
+	return type != FILE_TYPE_CHAR;
+#endif
+}
+
+void RawStream::Close()
+{
+#if defined(RAW_STREAM_POLL)
+	if (m_Fd >= 0)
+	{
+		::close(m_Fd);
+		m_Fd = -1;
+	}
+#else
+	if (m_Handle)
+	{
+		CloseHandle(m_Handle);
+		m_Handle = NULL;
+	}
+#endif
+}
+
+bool RawStream::ReadFully( char* data, unsigned int size )
+{
+	unsigned int done = 0;
+	while (done < size && !m_Stop)
+	{
+#if defined(RAW_STREAM_POLL)
+		struct pollfd pfd;
+		pfd.fd = m_Fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		int res = poll(&pfd, 1, RAW_STREAM_POLL_INTERVAL);
+		if (res == 0 || (res < 0 && errno == EINTR))
+		{
+			continue;
+		}
+
+		ssize_t n = ::read(m_Fd, data+done, size-done);
+		if (n < 0 && (errno == EAGAIN || errno == EINTR))
+		{
+			continue;
+		}
+#else
+		DWORD toRead = size-done;
+		if (m_Pipe)
+		{
+			DWORD avail = 0;
+			if (!PeekNamedPipe(m_Handle, NULL, 0, NULL, &avail, NULL))
+			{
+				// Writer has closed the pipe
+				return false;
+			}
+			if (avail == 0)
+			{
+				msleep(RAW_STREAM_PEEK_INTERVAL);
+				continue;
+			}
+			toRead = qMin<DWORD>(toRead, avail);
+		}
+
+		DWORD read = 0;
+		qint64 n = ReadFile(m_Handle, data+done, toRead, &read, NULL)?(qint64)read:-1;
+#endif
+		// Writer has closed, whether it sent data or not
+		if (n <= 0)
+		{
+			return false;
+		}
+
+		done += n;
+	}
+	return done == size;
+}
+
+void RawStream::run()
+{
+	if (!Open())
+	{
+		QMutexLocker locker(&m_Mutex);
+		m_Ended = true;
+		return;
+	}
+
+	while (true)
+	{
+		m_Mutex.lock();
+		while (!m_Stop && m_Count == m_Ring.size())
+		{
+			m_NotFull.wait(&m_Mutex);
+		}
+		int tail = (m_Head+m_Count)%m_Ring.size();
+		unsigned int frameSize = m_FrameSize;
+		unsigned int generation = m_Generation;
+		QByteArray& frame = m_Ring[tail];
+		m_Mutex.unlock();
+
+		if (m_Stop)
+		{
+			break;
+		}
+
+		// Slot is not used by reader until m_Count is increased
+		frame.resize(frameSize);
+		bool ok = ReadFully(frame.data(), frameSize);
+
+		QMutexLocker locker(&m_Mutex);
+		if (!ok)
+		{
+			m_Ended = true;
+			break;
+		}
+
+		// Frames read before the size changed are dropped
+		if (generation == m_Generation)
+		{
+			m_Count++;
+			m_FramesRead++;
+		}
+	}
+}
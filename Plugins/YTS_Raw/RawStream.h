@@ -0,0 +1,69 @@
+#ifndef RAW_STREAM_H
+#define RAW_STREAM_H
+
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QVector>
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+
+// Number of frames buffered ahead of playback
+#define RAW_STREAM_BUFFER_FRAMES 16
+
+// Reads raw frames from stdin, a named pipe or a local socket on its own
+// thread into a ring of frame buffers. When the ring is full the thread
+// stops reading, so the pipe fills up and the writing process blocks.
+class RawStream : public QThread
+{
+public:
+	RawStream(const QString& path, unsigned int frameSize);
+	~RawStream();
+
+	// Stdin, socket or named pipe, the path then has no size
+	static bool IsStreamPath(const QString& path);
+
+	void Stop();
+	// Applies to frames read from now on, buffered frames are dropped. While
+	// a frame is peeked, the change waits for its Release().
+	void SetFrameSize(unsigned int frameSize);
+
+	// Oldest buffered frame, or NULL if no frame is buffered yet. It stays
+	// valid until Release() is called.
+	const char* Peek();
+	void Release();
+
+	// Stream has ended and all frames have been taken
+	bool AtEnd();
+	// Number of complete frames read from the stream so far
+	unsigned int FramesRead();
+
+private:
+	void run();
+	bool Open();
+	void Close();
+	// Reads exactly size bytes, returns false at end of stream or on stop
+	bool ReadFully(char* data, unsigned int size);
+	// Drops buffered frames if frame size changed, called with m_Mutex locked
+	void ApplyFrameSize();
+
+	QString m_Path;
+	int m_Fd;		// polled descriptor on Unix
+	void* m_Handle;	// handle on other systems, pipes are peeked before reading
+	bool m_Pipe;
+
+	QMutex m_Mutex;
+	QWaitCondition m_NotFull;
+	QVector<QByteArray> m_Ring;
+	int m_Head; // next frame to take
+	int m_Count;
+	unsigned int m_FrameSize;
+	unsigned int m_NewFrameSize; // waits for peeked frame to be released
+	unsigned int m_Generation; // frames read before the last size change are dropped
+	bool m_Peeked;
+	unsigned int m_FramesRead;
+	bool m_Ended;
+	volatile bool m_Stop;
+};
+
+#endif
@@ -63,12 +63,21 @@ void RawPlugin::ReleaseSource( Source* source)
 
 
 YTS_Raw::YTS_Raw() : m_FPS(30), m_FrameIndex(0), m_InsertFrame0(0),
-	m_NumFrames(0), m_Duration(0), m_RawFormatWidget(0), m_Callback(0)
+	m_NumFrames(0), m_Duration(0), m_Stream(0), m_DirectReader(0), m_Follow(false), m_NotifiedNumFrames(0),
+	m_Watcher(0), m_RawFormatWidget(0), m_Callback(0)
 {
+	m_PollTimer = new QTimer(this);
+	connect(m_PollTimer, SIGNAL(timeout()), this, SLOT(CheckFileSize()));
+
+	// Encoder writes many times per frame, only check once for all of them
+	m_NotifyTimer = new QTimer(this);
+	m_NotifyTimer->setSingleShot(true);
+	connect(m_NotifyTimer, SIGNAL(timeout()), this, SLOT(CheckFileSize()));
 }
 
 YTS_Raw::~YTS_Raw()
 {
+	CloseReadFiles();
 }
 
 RESULT YTS_Raw::EnumSupportedItems( char** items )
@@ -222,6 +231,18 @@ void YTS_Raw::InitInternal()
 		frame_size += m_Format->PlaneSize(i);
 	}
 
+	m_FrameIndex = 0;
+	if (RawStream::IsStreamPath(m_Path))
+	{
+		// Length is not known, it grows as frames come in
+		m_NumFrames = 1;
+		m_Duration = IndexToPTS(m_NumFrames);
+
+		m_Stream = new RawStream(m_Path, frame_size);
+		m_Stream->start();
+		return;
+	}
+
 	QFileInfo file_info(m_Path);
 
 	if (frame_size > 0)
@@ -231,10 +252,10 @@ void YTS_Raw::InitInternal()
 		
 		m_Duration = IndexToPTS(m_NumFrames);
 	}
+	m_NotifiedNumFrames = m_NumFrames;
 
 	m_File = QSharedPointer<QFile>(new QFile(m_Path));
 	m_File->open(QIODevice::ReadOnly);
-	m_FrameIndex = 0;
 }
 
 RESULT YTS_Raw::GetInfo( SourceInfo& info )
@@ -246,9 +267,9 @@ RESULT YTS_Raw::GetInfo( SourceInfo& info )
 	info.lastPTS = IndexToPTS(m_NumFrames-1);
 	info.maxFps = m_FPS;
 
-	if (m_TimeStamps.size())
+	if (!m_TimeStamps.IsEmpty())
 	{
-		info.duration = m_TimeStamps.last();
+		info.duration = m_TimeStamps.Last();
 	}
 
 	return OK;
@@ -256,11 +277,19 @@ RESULT YTS_Raw::GetInfo( SourceInfo& info )
 
 RESULT YTS_Raw::UnInit()
 {
+	m_PollTimer->stop();
+	m_NotifyTimer->stop();
+	SAFE_DELETE(m_Watcher);
+	SAFE_DELETE(m_Stream);
+	SAFE_DELETE(m_DirectReader);
+
 	if (m_File)
 	{
 		m_File->close();
 	}
 
+	CloseReadFiles();
+
 	return OK;
 }
 
@@ -268,6 +297,11 @@ RESULT YTS_Raw::GetFrame( FramePtr frame, unsigned int seekingPTS )
 {
 	QMutexLocker locker(&m_Mutex);
 
+	if (m_Stream)
+	{
+		return GetStreamFrame(frame, seekingPTS);
+	}
+
 	if (!m_File)
 	{
 		return E_UNKNOWN;
@@ -281,40 +315,161 @@ RESULT YTS_Raw::GetFrame( FramePtr frame, unsigned int seekingPTS )
 		WARNING_LOG("YTS_Raw GetFrame Seeking frame ptr %d index %d", seekingPTS, m_FrameIndex);
 	}
 
-	unsigned int frame_size = 0;
-	for (int i=0; i<4; i++)
+	if (m_Follow && m_FrameIndex >= m_NumFrames)
 	{
-		frame_size += m_Format->PlaneSize(i);
+		// Wait for CheckFileSize() to append more frames
+		return FRAME_NOT_READY;
+	}
+
+	RESULT res = ReadFrameInternal(m_File.data(), m_DirectReader, frame, m_FrameIndex);
+	if (res == OK)
+	{
+		frame->SetInfo(SEEKING_PTS, seekingPTS);
+		m_FrameIndex++;
+	}else if (res == END_OF_FILE && m_Follow)
+	{
+		// Last frame is not completely written yet
+		res = FRAME_NOT_READY;
+	}
+
+	return res;
+}
+
+RESULT YTS_Raw::ReadFrame( FramePtr frame, unsigned int pts )
+{
+	qint64 frameIdx = 0;
+	{
+		// Only file size and format are guarded, the read itself runs in
+		// parallel with playback and other readers
+		QMutexLocker locker(&m_Mutex);
+
+		// Streams can not be read randomly
+		if (!m_File || m_Stream)
+		{
+			return E_UNKNOWN;
+		}
+
+		unsigned int frameIndex = MyMin(PTSToIndex(pts), m_NumFrames-1);
+		frameIdx = (frameIndex>0 || !m_InsertFrame0) ? (qint64)frameIndex - m_InsertFrame0 : -1;
+
+		frame->SetFormat(m_Format);
+		SetFrameInfo(frame, frameIndex);
+	}
+
+	frame->Allocate();
+
+	// Separate file handle, so that position of playback is not changed
+	QFile* file = TakeReadFile();
+	if (!file)
+	{
+		return E_UNKNOWN;
+	}
+
+	bool file_status = ReadFrameData(file, NULL, frame, frameIdx);
+	ReturnReadFile(file);
+
+	return file_status ? OK : END_OF_FILE;
+}
+
+QFile* YTS_Raw::TakeReadFile()
+{
+	{
+		QMutexLocker locker(&m_ReadFilesMutex);
+		if (!m_ReadFiles.isEmpty())
+		{
+			return m_ReadFiles.takeLast();
+		}
 	}
 
+	QFile* file = new QFile(m_Path);
+	if (!file->open(QIODevice::ReadOnly))
+	{
+		SAFE_DELETE(file);
+	}
+
+	return file;
+}
+
+void YTS_Raw::ReturnReadFile( QFile* file )
+{
+	QMutexLocker locker(&m_ReadFilesMutex);
+	m_ReadFiles.append(file);
+}
+
+void YTS_Raw::CloseReadFiles()
+{
+	QMutexLocker locker(&m_ReadFilesMutex);
+	qDeleteAll(m_ReadFiles);
+	m_ReadFiles.clear();
+}
+
+RESULT YTS_Raw::ReadFrameInternal( QFile* file, RawDirectReader* direct, FramePtr frame, unsigned int frameIndex )
+{
 	frame->SetFormat(m_Format);
 	frame->Allocate();
 
+	qint64 frameIdx = (frameIndex>0 || !m_InsertFrame0) ? (qint64)frameIndex - m_InsertFrame0 : -1;
+	if (!ReadFrameData(file, direct, frame, frameIdx))
+	{
+		return END_OF_FILE;
+	}
+
+	SetFrameInfo(frame, frameIndex);
+
+	return OK;
+}
+
+bool YTS_Raw::ReadFrameData( QFile* file, RawDirectReader* direct, FramePtr frame, qint64 frameIdx )
+{
+	const FormatPtr format = frame->Format();
+	unsigned int frame_size = 0;
+	for (int i=0; i<4; i++)
+	{
+		frame_size += format->PlaneSize(i);
+	}
+
 	bool file_status = true;
-	if (m_FrameIndex>0 || !m_InsertFrame0)
+	if (frameIdx >= 0)
 	{
-		qint64 frameIdx = m_FrameIndex - m_InsertFrame0;
 		qint64 readPos =  frame_size*frameIdx; 
 		
-		if (m_File->pos() != readPos)
+		if (direct)
 		{
-			file_status = m_File->seek(readPos);
-		}
+			// Next frame is read ahead while this one is copied
+			const char* data = direct->Read(readPos, frame_size);
+			file_status = data != NULL;
+			for (int i=0; i<4 && file_status; i++)
+			{
+				unsigned int plane_size = format->PlaneSize(i);
 
-		for (int i=0; i<4 && file_status; i++)
+				if (plane_size>0)
+				{
+					memcpy(frame->Data(i), data, plane_size);
+					data += plane_size;
+				}
+			}
+		}else
 		{
-			unsigned int plane_size = m_Format->PlaneSize(i);
+			if (file->pos() != readPos)
+			{
+				file_status = file->seek(readPos);
+			}
 
-			if (plane_size>0)
+			for (int i=0; i<4 && file_status; i++)
 			{
-				file_status = m_File->read((char*)frame->Data(i), plane_size) == plane_size;
+				unsigned int plane_size = format->PlaneSize(i);
+
+				if (plane_size>0)
+				{
+					file_status = file->read((char*)frame->Data(i), plane_size) == plane_size;
+				}
 			}
 		}
 	}else
 	{
 		for (int i=0; i<4; i++)
 		{
-			unsigned int plane_size = m_Format->PlaneSize(i);
+			unsigned int plane_size = format->PlaneSize(i);
 
 			if (plane_size>0)
 			{
@@ -323,38 +478,84 @@ RESULT YTS_Raw::GetFrame( FramePtr frame, unsigned int seekingPTS )
 		}
 	}
 
-	
-	if (file_status)
+	return file_status;
+}
+
+void YTS_Raw::SetFrameInfo( FramePtr frame, unsigned int frameIndex )
+{
+	unsigned int pts = IndexToPTS(frameIndex);
+	frame->SetPTS(pts);
+	frame->SetFrameNumber(frameIndex);
+	// More frames may follow when file is followed
+	bool isLastFrame = !m_Follow && frameIndex == m_NumFrames-1;
+	frame->SetInfo(IS_LAST_FRAME, isLastFrame);
+	if (isLastFrame)
 	{
-		unsigned int pts = IndexToPTS(m_FrameIndex);
-		frame->SetPTS(pts);
-		frame->SetFrameNumber(m_FrameIndex);
-		frame->SetInfo(IS_LAST_FRAME, m_FrameIndex == m_NumFrames-1);
-		frame->SetInfo(SEEKING_PTS, seekingPTS);
-		if (m_FrameIndex == m_NumFrames-1)
+		frame->SetInfo(NEXT_PTS, INVALID_PTS);
+	}else
+	{
+		frame->SetInfo(NEXT_PTS, IndexToPTS(frameIndex+1));
+	}
+}
+
+RESULT YTS_Raw::GetStreamFrame( FramePtr frame, unsigned int seekingPTS )
+{
+	// Stream is only read forward, seeking drops buffered frames before it
+	if (seekingPTS < INVALID_PTS)
+	{
+		unsigned int frameIndex = (unsigned int)ceil(seekingPTS*m_FPS/1000.0);
+		if (frameIndex < m_FrameIndex)
 		{
-			frame->SetInfo(NEXT_PTS, INVALID_PTS);
-		}else
+			WARNING_LOG("YTS_Raw stream can not seek back to %d, next frame %d", seekingPTS, m_FrameIndex);
+			return E_PTS_NOT_FOUND;
+		}
+
+		while (m_FrameIndex < frameIndex && m_Stream->Peek())
 		{
-			frame->SetInfo(NEXT_PTS, IndexToPTS(m_FrameIndex+1));
-		}		
+			m_Stream->Release();
+			m_FrameIndex++;
+		}
+	}
 
-		m_FrameIndex++;
+	const char* data = m_Stream->Peek();
+	if (!data)
+	{
+		return m_Stream->AtEnd()?END_OF_FILE:FRAME_NOT_READY;
+	}
 
-		return OK;
-	}else
+	frame->SetFormat(m_Format);
+	frame->Allocate();
+	for (int i=0; i<4; i++)
 	{
-		return END_OF_FILE;
+		unsigned int plane_size = m_Format->PlaneSize(i);
+		if (plane_size>0)
+		{
+			memcpy(frame->Data(i), data, plane_size);
+			data += plane_size;
+		}
 	}
-}
+	m_Stream->Release();
+
+	m_NumFrames = MyMax(m_Stream->FramesRead(), m_FrameIndex+1);
+	m_Duration = IndexToPTS(m_NumFrames);
+
+	// More frames may follow, so last one is never known
+	frame->SetPTS(IndexToPTS(m_FrameIndex));
+	frame->SetFrameNumber(m_FrameIndex);
+	frame->SetInfo(IS_LAST_FRAME, false);
+	frame->SetInfo(NEXT_PTS, IndexToPTS(m_FrameIndex+1));
+	frame->SetInfo(SEEKING_PTS, seekingPTS);
+	m_FrameIndex++;
 
+	return OK;
+}
 
 unsigned int YTS_Raw::IndexToPTS( unsigned int frame_idx )
 {
 	frame_idx = MyMin(frame_idx, m_NumFrames);
-	if (m_TimeStamps.size())
+	if (!m_TimeStamps.IsEmpty())
 	{
-		return m_TimeStamps[frame_idx];
+		return m_TimeStamps.PTS(frame_idx);
 	}else
 	{
 		return (unsigned int)floor(1000.0*frame_idx/m_FPS);
@@ -371,22 +572,9 @@ unsigned int YTS_Raw::IndexToPTSInternal( unsigned int frame_idx )
 unsigned int YTS_Raw::PTSToIndex( unsigned int PTS )
 {
 	unsigned int frame_idx = 0;
-	if (m_TimeStamps.size())
+	if (!m_TimeStamps.IsEmpty())
 	{
-		QList<unsigned int>::iterator itr;
-		unsigned int i;
-		for (i=0, itr = m_TimeStamps.begin(); itr != m_TimeStamps.end(); ++itr, ++i)
-		{
-			if (itr == m_TimeStamps.end()-1)
-			{
-				frame_idx = i;
-				break;
-			}else if ((*itr)>PTS)
-			{
-				frame_idx = (i>0)?i-1:0;
-				break;
-			}
-		}
+		frame_idx = m_TimeStamps.Index(PTS);
 	}else
 	{
 		frame_idx = (unsigned int)ceil(PTS*m_FPS/1000.0);
@@ -422,25 +610,156 @@ void YTS_Raw::ReInit( const FormatPtr format, double FPS )
 		frame_size += m_Format->PlaneSize(i);
 	}
 
-	QFileInfo file_info(m_Path);
-
-	if (frame_size > 0)
+	if (m_Stream)
+	{
+		m_Stream->SetFrameSize(frame_size);
+	}else if (frame_size > 0)
 	{
+		QFileInfo file_info(m_Path);
 		m_NumFrames = file_info.size()/frame_size;
 
 		m_Duration = IndexToPTS(m_NumFrames);
 	}
+	m_NotifiedNumFrames = m_NumFrames;
 
 	m_Callback->ResolutionDurationChanged();
 }
 
+void YTS_Raw::SetFollow( bool follow )
+{
+	if (m_Stream || follow == m_Follow)
+	{
+		return;
+	}
+
+	if (follow)
+	{
+		// Uses inotify or similar where available, and polls otherwise
+		m_Watcher = new QFileSystemWatcher(this);
+		m_Watcher->addPath(m_Path);
+		connect(m_Watcher, SIGNAL(fileChanged(const QString&)), this, SLOT(OnFileChanged()));
+
+		// Network file systems do not report writes from other hosts
+		m_PollTimer->start(FOLLOW_POLL_INTERVAL);
+	}else
+	{
+		m_PollTimer->stop();
+		m_NotifyTimer->stop();
+		SAFE_DELETE(m_Watcher);
+	}
+
+	m_Mutex.lock();
+	m_Follow = follow;
+	if (follow)
+	{
+		UpdateNumFrames();
+	}
+	m_NotifiedNumFrames = m_NumFrames;
+	m_Mutex.unlock();
+
+	if (m_Callback)
+	{
+		// Frames read already have the old end of file marked
+		m_Callback->ResolutionDurationChanged();
+	}
+}
+
+bool YTS_Raw::SetUnbuffered( bool unbuffered )
+{
+	QMutexLocker locker(&m_Mutex);
+	if (m_Stream || unbuffered == (m_DirectReader != NULL))
+	{
+		return !m_Stream;
+	}
+
+	SAFE_DELETE(m_DirectReader);
+	if (unbuffered)
+	{
+		m_DirectReader = new RawDirectReader(m_Path);
+		if (!m_DirectReader->Open())
+		{
+			WARNING_LOG("YTS_Raw failed to open %s for unbuffered reads", m_Path.toLocal8Bit().constData());
+			SAFE_DELETE(m_DirectReader);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void YTS_Raw::OnFileChanged()
+{
+	if (!m_NotifyTimer->isActive())
+	{
+		m_NotifyTimer->start(FOLLOW_NOTIFY_INTERVAL);
+	}
+}
+
+void YTS_Raw::CheckFileSize()
+{
+	if (m_Watcher && m_Watcher->files().isEmpty())
+	{
+		// File was replaced, watch new one
+		m_Watcher->addPath(m_Path);
+	}
+
+	m_Mutex.lock();
+	UpdateNumFrames();
+	bool extended = (m_NumFrames != m_NotifiedNumFrames);
+	m_NotifiedNumFrames = m_NumFrames;
+	m_Mutex.unlock();
+
+	if (extended)
+	{
+		m_Callback->DurationExtended();
+	}
+}
+
+// Appends frames written to file since last check, m_Mutex has to be locked
+bool YTS_Raw::UpdateNumFrames()
+{
+	unsigned int frame_size = 0;
+	for (int i=0; i<4; i++)
+	{
+		frame_size += m_Format->PlaneSize(i);
+	}
+
+	if (frame_size == 0)
+	{
+		return false;
+	}
+
+	QFileInfo file_info(m_Path);
+	unsigned int numFrames = file_info.size()/frame_size;
+	if (numFrames <= m_NumFrames)
+	{
+		// Truncated file is only picked up by ReInit
+		return false;
+	}
+
+	unsigned int oldNumFrames = m_NumFrames;
+	m_NumFrames = numFrames;
+	if (!m_TimeStamps.IsEmpty())
+	{
+		// Continue custom time stamps at frame rate, like SetTimeStamps
+		unsigned int lastTs = m_TimeStamps.Last();
+		for (unsigned int i=1; i<=numFrames-oldNumFrames; i++)
+		{
+			m_TimeStamps.Append(lastTs+IndexToPTSInternal(i));
+		}
+	}
+	m_Duration = IndexToPTS(m_NumFrames);
+
+	return true;
+}
+
 RESULT YTS_Raw::GetTimeStamps( QList<unsigned int>& timeStamps )
 {
 	timeStamps.clear();
-	if (m_TimeStamps.size())
+	if (!m_TimeStamps.IsEmpty())
 	{
-		timeStamps.append(m_TimeStamps);
-		timeStamps.removeLast();
+		// Last one is the duration
+		m_TimeStamps.ToList(timeStamps, m_TimeStamps.Size()-1);
 	}else
 	{		
 		timeStamps.reserve(m_NumFrames);
@@ -454,40 +773,40 @@ RESULT YTS_Raw::GetTimeStamps( QList<unsigned int>& timeStamps )
 
 RESULT YTS_Raw::SetTimeStamps( QList<unsigned int> timeStamps )
 {
-	m_TimeStamps = timeStamps;
 	m_InsertFrame0 = 0;
 
-	if (m_TimeStamps.size()>0)
+	if (timeStamps.size()>0)
 	{
 		// Ensure that time stamp list is as big as the number of frames + 1
 		// last one for duration
 
-		while (m_TimeStamps.size()>m_NumFrames+1)
+		while (timeStamps.size()>m_NumFrames+1)
 		{
-			m_TimeStamps.removeLast();
+			timeStamps.removeLast();
 		}
 
 		// make sure it is non-decreasing
-		for (int i = 1; i < m_TimeStamps.size(); ++i) 
+		for (int i = 1; i < timeStamps.size(); ++i) 
 		{
-			if (m_TimeStamps.at(i) < m_TimeStamps.at(i-1))
+			if (timeStamps.at(i) < timeStamps.at(i-1))
 			{
-				m_TimeStamps[i] = m_TimeStamps[i-1];
+				timeStamps[i] = timeStamps[i-1];
 			}
 		}
 
-		unsigned int lastTs = (m_TimeStamps.size())?m_TimeStamps.last():0;
-		for (int i=1; m_TimeStamps.size()<m_NumFrames+1; i++)
+		unsigned int lastTs = (timeStamps.size())?timeStamps.last():0;
+		for (int i=1; timeStamps.size()<m_NumFrames+1; i++)
 		{
-			m_TimeStamps.append(lastTs+IndexToPTSInternal(i));
+			timeStamps.append(lastTs+IndexToPTSInternal(i));
 		}
 
-		if (!m_TimeStamps.startsWith(0))
+		if (!timeStamps.startsWith(0))
 		{
 			m_InsertFrame0 = 1;
-			m_TimeStamps.insert(m_TimeStamps.begin(), 0);
+			timeStamps.insert(timeStamps.begin(), 0);
 		}
 	}
+	m_TimeStamps.Set(timeStamps);
 
 	m_Callback->ResolutionDurationChanged();
 
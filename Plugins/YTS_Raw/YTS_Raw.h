@@ -2,11 +2,17 @@
 #define YTS_RAW_H
 
 #include "../YT_Interface.h"
+#include "../Timeline.h"
+#include "RawStream.h"
+#include "RawDirectReader.h"
 #include "RawFormatWidget.h"
 #include <QtCore/QThread>
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
 #include <QtCore/QMap>
+#include <QtCore/QList>
+#include <QtCore/QTimer>
+#include <QtCore/QFileSystemWatcher>
 
 #include <stdio.h>
 
@@ -22,6 +28,12 @@ public:
 };
 
 
+// Fallback check of file size in follow mode, for file systems that do not
+// report changes, ms
+#define FOLLOW_POLL_INTERVAL 1000
+// Changes reported within this time are handled at once, ms
+#define FOLLOW_NOTIFY_INTERVAL 200
+
 #define RESOLUTION_COUNT 13
 extern QString resolution_names[RESOLUTION_COUNT];
 
@@ -42,6 +54,7 @@ public:
 	virtual RESULT UnInit();
 
 	virtual RESULT GetFrame(FramePtr frame, unsigned int seekingPTS);
+	virtual RESULT ReadFrame(FramePtr frame, unsigned int pts);
 
 	virtual RESULT GetInfo( SourceInfo& info );
 	virtual RESULT GetTimeStamps(QList<unsigned int>& timeStamps);
@@ -53,21 +66,55 @@ public:
 
 	void ReInit(const FormatPtr format, double FPS);
 	const QString GetPath() {return m_Path;}
+
+	// Follow file while it is being written, frames are appended as
+	// the file grows and the end of file is never reached
+	void SetFollow(bool follow);
+	bool IsFollowing() {return m_Follow;}
+
+	// Read playback frames bypassing the page cache, returns false if
+	// file can not be opened that way
+	bool SetUnbuffered(bool unbuffered);
+	bool IsUnbuffered() {return m_DirectReader != NULL;}
 protected:
 	unsigned int PTSToIndex(unsigned int PTS);
 	unsigned int IndexToPTSInternal(unsigned int frame_idx);
 
 	void InitInternal();
+	RESULT ReadFrameInternal(QFile* file, RawDirectReader* direct, FramePtr frame, unsigned int frameIndex);
+	// Reads planes in format of frame, frameIdx<0 gives the inserted black frame 0
+	static bool ReadFrameData(QFile* file, RawDirectReader* direct, FramePtr frame, qint64 frameIdx);
+	void SetFrameInfo(FramePtr frame, unsigned int frameIndex);
+
+	// Idle file handles of ReadFrame(..), one is opened per concurrent reader
+	QFile* TakeReadFile();
+	void ReturnReadFile(QFile* file);
+	void CloseReadFiles();
+	RESULT GetStreamFrame(FramePtr frame, unsigned int seekingPTS);
+	bool UpdateNumFrames();
+private slots:
+	void OnFileChanged();
+	void CheckFileSize();
 private:
 	double			m_FPS;
 	unsigned int	m_FrameIndex;
 	
 	unsigned int	m_NumFrames;
 	unsigned int	m_Duration;
-	QList<unsigned int> m_TimeStamps; // custom time stamps
+	Timeline		m_TimeStamps; // custom time stamps
 	int             m_InsertFrame0; // first timestamp is not zero, insert frame 0
 
 	QSharedPointer<QFile> m_File;
+	QList<QFile*> m_ReadFiles; // used by ReadFrame(..)
+	QMutex m_ReadFilesMutex; // guards m_ReadFiles only, not held while reading
+	RawStream* m_Stream; // reads from stdin, pipe or socket instead of m_File
+	RawDirectReader* m_DirectReader; // used by GetFrame(..) instead of m_File
+
+	bool m_Follow;
+	unsigned int m_NotifiedNumFrames; // m_NumFrames last reported to m_Callback
+	QFileSystemWatcher* m_Watcher;
+	QTimer* m_PollTimer;
+	QTimer* m_NotifyTimer;
 
 	FormatPtr m_Format;
 	QString m_Path;
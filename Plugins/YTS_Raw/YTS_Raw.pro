@@ -3,10 +3,14 @@ TARGET   = YTS_Raw
 DEFINES += 
 
 SOURCES += RawFormatWidget.cpp\
-		   YTS_Raw.cpp
+		   YTS_Raw.cpp\
+		   RawStream.cpp\
+		   RawDirectReader.cpp
 
 HEADERS += RawFormatWidget.h\
-		   YTS_Raw.h
+		   YTS_Raw.h\
+		   RawStream.h\
+		   RawDirectReader.h
 		
 FORMS   += RawFormatWidget.ui
 
@@ -95,13 +95,17 @@ RESULT OpenGLRenderer::RenderScene(const FrameList& frames)
 			const QRect srcRect = frame->Info(SRC_RECT).toRect();
 			const QRect dstRect = frame->Info(DST_RECT).toRect();
 
-			QImage image = *(QImage*)(frame->ExternData());
+			bool gray = (frame->Format()->Color() == Y800);
+			int bpp = gray ? 1 : 3;
+			int stride = frame->Format()->Stride(0);
+
 			glRasterPos2f(dstRect.left(), dstRect.top());
 			glPixelZoom(((float)(dstRect.width()))/(srcRect.width()), 
 				-1.0 * ((float)(dstRect.height()))/(srcRect.height()));	
-			glPixelStorei(GL_UNPACK_ROW_LENGTH, image.width());
-			const uchar* bits  = image.bits() + (srcRect.top())*image.width()*3 + srcRect.left()*3;
-			glDrawPixels(srcRect.width(), srcRect.height(), GL_RGB, GL_UNSIGNED_BYTE, bits);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, stride/bpp);
+			const uchar* bits  = frame->Data(0) + (srcRect.top())*stride + srcRect.left()*bpp;
+			glDrawPixels(srcRect.width(), srcRect.height(), gray ? GL_LUMINANCE : GL_RGB, GL_UNSIGNED_BYTE, bits);
 			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 		}
 
@@ -115,7 +119,10 @@ RESULT OpenGLRenderer::RenderScene(const FrameList& frames)
 
 RESULT OpenGLRenderer::Allocate( FramePtr& frame, FormatPtr sourceFormat )
 {
-	QImage* image = new QImage(ALIGNED16(sourceFormat->Width()), sourceFormat->Height(), QImage::Format_RGB888);
+	// Y800 is kept as is, everything else is converted to rgb24
+	bool gray = IsColorSupported(sourceFormat->Color(), sourceFormat->Width(), sourceFormat->Height());
+	QImage* image = new QImage(ALIGNED16(sourceFormat->Width()), sourceFormat->Height(), 
+		gray ? QImage::Format_Indexed8 : QImage::Format_RGB888);
 
 	frame = m_Host->NewFrame();
 	frame->SetFormat(sourceFormat);
@@ -126,13 +133,12 @@ RESULT OpenGLRenderer::Allocate( FramePtr& frame, FormatPtr sourceFormat )
 	frame->SetData(2, 0);
 	frame->SetData(3, 0);
 
-	// support only rgb24
-	frame->Format()->SetStride(0,ALIGNED16(sourceFormat->Width())*3);
+	frame->Format()->SetStride(0,image->bytesPerLine());
 	frame->Format()->SetStride(1,0);
 	frame->Format()->SetStride(2,0);
 	frame->Format()->SetStride(3,0);
 
-	frame->Format()->SetColor(RGB24);
+	frame->Format()->SetColor(gray ? Y800 : RGB24);
 
 	return OK;
 }
@@ -27,6 +27,9 @@ public:
 
 	virtual RESULT RenderScene(const FrameList& frames);
 
+	// Y800 is uploaded directly as luminance
+	virtual bool IsColorSupported(COLOR_FORMAT color, int, int) {return color == Y800;}
+
 	// Allocate render specific buffers
 	virtual RESULT Allocate(FramePtr& frame, FormatPtr sourceFormat);
 	virtual RESULT Deallocate(FramePtr frame);
@@ -7,9 +7,15 @@ class QWidget;
 #define INVALID_PTS		0xffffffff
 #define FOURCC(a,b,c,d) (((unsigned int)a)|(((unsigned int)b)<<8)|(((unsigned int)c)<<16)|(((unsigned int)d)<<24)) 
 
+// Paths of sources that stream raw video instead of reading a file. Rest
+// of the path is the name of the socket, or only gives the format for stdin.
+#define SOURCE_STDIN_PREFIX		"stdin:"
+#define SOURCE_SOCKET_PREFIX	"socket:"
+
 enum RESULT {
 	OK 					= 0x00000000,
 	END_OF_FILE         = 0x00000001,
+	FRAME_NOT_READY     = 0x00000002, // live source has no new frame yet
 	E_UNKNOWN 			= 0xffffffff,
 	E_WRONG_FORMAT		= 0xf0000001,
 	E_PTS_NOT_FOUND     = 0xf0000002,
@@ -54,6 +60,9 @@ enum INFO_KEY {
 	DST_RECT,         // QRect, destination rect for rendering
 	RENDER_SRC_SCALE_X, // float, scale used inside renderer
 	RENDER_SRC_SCALE_Y, // float, scale used inside renderer
+	RENDER_NEAREST,   // bool, scale up without interpolation, e.g. block based distortion maps
+	FRAME_STATS,      // plane statistics computed by host while reading the frame, used by host only
+	RENDER_REGION,    // QRect, part of source frame held by a render frame, used by host only
 	LAST_INFO_KEY,
 };
 
@@ -126,6 +135,7 @@ public:
 	virtual unsigned int FrameNumber() const = 0;
 	virtual void SetFrameNumber(unsigned int value) = 0;
 
+	// Info may be read and set by several threads once frame is shared
 	virtual bool HasInfo(INFO_KEY) const = 0;
 	virtual QVariant Info(INFO_KEY) const = 0;
 	virtual void SetInfo(INFO_KEY, QVariant) = 0;
@@ -208,7 +218,7 @@ public:
 	virtual void ReleaseMeasure(Measure*) {}
 };
 
-Q_DECLARE_INTERFACE(YTPlugIn, "net.yocto.YUVToolkit.PlugIn/1.2")
+Q_DECLARE_INTERFACE(YTPlugIn, "net.yocto.YUVToolkit.PlugIn/1.9")
 
 // Each module below should manage memory of its own
 enum SOURCE_TYPE {
@@ -254,6 +264,10 @@ public:
 
 	// Signals when video format was changed and new frame should be requested
 	virtual void ResolutionDurationChanged() = 0;
+
+	// Signals when frames were appended to the source, frames read so far
+	// stay valid so nothing has to be requested again
+	virtual void DurationExtended() = 0;
 };
 
 
@@ -277,9 +291,15 @@ public:
 
 	// if PTS != 0xFFFFFFFE, seek to PTS
 	// PTS might be larger than the duration, then returns the last frame
+	// Sources read only forward return E_PTS_NOT_FOUND when seeking back
 	// Else get next frame
 	virtual RESULT GetFrame(FramePtr frame, unsigned int seekingPts=INVALID_PTS) = 0;
 
+	// Read the frame that is shown at PTS, without changing the position of
+	// GetFrame(..). It may be called from other threads than the one calling
+	// GetFrame(..). Sources that can not be read randomly return E_UNKNOWN.
+	virtual RESULT ReadFrame(FramePtr frame, unsigned int pts) {return E_UNKNOWN;}
+
 	// Receive a list of source time stamps
 	virtual RESULT GetTimeStamps(QList<unsigned int>& timeStamps) = 0;
 	
@@ -311,11 +331,21 @@ public:
 	// it should have SRC_RECT/DST_RECT properties
 	virtual RESULT RenderScene(const FrameList& frames) = 0;
 	   
+	// Returns true if frames of this color and size can be presented without
+	// converting them to the renderer's own RGB format first. Allocate(..)
+	// keeps the color of sourceFormat for such frames, so the caller only needs
+	// to copy planes.
+	virtual bool IsColorSupported(COLOR_FORMAT color, int width, int height) = 0;
+
 	// Allocate render specific buffers
 	virtual RESULT Allocate(FramePtr& frame, FormatPtr sourceFormat) = 0;
 	virtual RESULT Deallocate(FramePtr frame) = 0;
 
-	// Prepare FramePtr before using it
+	// Prepare FramePtr before using it. All functions are called on the render
+	// thread, but between GetFrame(..) and ReleaseFrame(..) the data of frame
+	// may be written by worker threads, while RenderScene(..) presents other
+	// frames. Several frames can be got at once, a frame is never presented
+	// while it is got.
 	virtual RESULT GetFrame(FramePtr& frame) = 0;
 	virtual RESULT ReleaseFrame(FramePtr frame) = 0;
 
@@ -333,14 +363,16 @@ struct TransformCapability
 	unsigned int transformId;
 	QString outputName;
 
-	unsigned int inputColorsCount;
-	COLOR_FORMAT inputColors[8];
+	// Default parameters shown to user, empty if transform has none
+	QString parameters;
 	
-	bool supportColor; // Can operate on all planes jointly
-	bool supportPlanes; // Can operate on each plane separately
-	bool need2Inputs;
+	bool need2Inputs; // e.g. difference of two videos
 };
 
+// Transform produces a derived video from one or two views, like a
+// difference image, crop or rotation. One instance is created per derived
+// view, Process(..) is called on a worker thread for each scene while
+// other transforms run in parallel.
 class Transform 
 {
 public:
@@ -348,15 +380,17 @@ public:
 
 	virtual const QList<TransformCapability>& GetCapabilities() = 0;
 
-	virtual void Process(FramePtr source1, FramePtr source2, unsigned int transformId, int plane, FramePtr result) = 0;
+	// Select transform of this instance, returns E_UNKNOWN if parameters 
+	// can not be parsed
+	virtual RESULT Init(unsigned int transformId, const QString& parameters) = 0;
 
-	 // Returns what format that is supported	
-	virtual RESULT GetSupportedModes(FormatPtr sourceFormat, QList<QString>& outputNames, QList<QString>& statNames) {return OK;}
+	// Format of result for format of source1, inputs are always in a native 
+	// format (Y800, I420, I422 or I444). Returns E_WRONG_FORMAT if not supported.
+	virtual RESULT GetFormat(const FormatPtr sourceFormat, FormatPtr outputFormat) = 0;
 
-	virtual RESULT GetFormat(FormatPtr sourceFormat, const QString& outputName, FormatPtr outputFormat) {return OK;}
-
-	// Process
-	virtual RESULT Process(const FramePtr input, QMap<QString, FramePtr>& outputs, QMap<QString, QVariant>& stats) {return OK;}
+	// Result is allocated in format returned by GetFormat(..), source2 is 
+	// NULL unless need2Inputs is set
+	virtual RESULT Process(FramePtr source1, FramePtr source2, FramePtr result) = 0;
 };
 
 struct MeasureInfo
@@ -394,6 +428,10 @@ struct MeasureOperation
 	DistMapPtr distMap;
 	int distMapWidth;
 	int distMapHeight;
+	// Requested size of square blocks, one map value per block, 0 or 1 for 
+	// one value per pixel. Measures that can not do blocks ignore it, the 
+	// actual resolution is always given by distMapWidth/distMapHeight.
+	int distMapBlockSize;
 };
 
 
@@ -404,6 +442,18 @@ public:
 
 	virtual const MeasureCapabilities& GetCapabilities() = 0;
 	virtual void Process(FramePtr source1, FramePtr source2, YUV_PLANE plane, const QList<MeasureOperation*>& operations) = 0;
+
+	// Compare one reference frame against several processed frames, operations[k]
+	// belongs to processed[k]. Measures that can share the pass over the reference
+	// planes should override this, default is one Process(..) per processed frame.
+	virtual void ProcessMultiple(FramePtr source, const FrameList& processed, YUV_PLANE plane, 
+		const QList<QList<MeasureOperation*> >& operations)
+	{
+		for (int k=0; k<processed.size(); k++)
+		{
+			Process(source, processed.at(k), plane, operations.at(k));
+		}
+	}
 };
 
 
@@ -1,5 +1,24 @@
 #include "YT_MeasuresBasicPlugin.h"
 #include "YT_MeasuresBasic.h"
+#include "../FastMath.h"
+#include "../RowSSE.h"
+#include "../ParallelFor.h"
+
+// Number of map values per thread
+#define PSNR_MAP_GRAIN (64*1024)
+
+// Converts MSE map to PSNR map, src and dst may be the same
+struct PSNRMapper
+{
+	const float* src;
+	float* dst;
+	float c;
+
+	void operator()(int from, int to)
+	{
+		FastLog10(src+from, dst+from, to-from, -10.0f, c);
+	}
+};
 
 MeasuresBasic::MeasuresBasic()
 {
@@ -9,47 +28,173 @@ MeasuresBasic::~MeasuresBasic()
 {
 }
 
-float MeasuresBasic::ComputeMSE( FramePtr input1, FramePtr input2, int plane, DistMapPtr mseMap)
+// Squared errors of one plane between reference and all processed frames.
+// Rows are split in bands that are processed in parallel, each band is a
+// multiple of all block sizes, so blocks of the maps are never split. Each 
+// band writes its own sums, which are added up in integers afterwards, so 
+// the result does not depend on how rows are split over threads.
+struct SSEBands
 {
-	int width = input1->Format()->PlaneWidth(plane);
-	int height = input1->Format()->PlaneHeight(plane);
+	const unsigned char* p1;
+	int stride1;
+	QVector<const unsigned char*> p2;
+	QVector<int> stride2;
+	QVector<float*> maps;
+	QVector<int> blockSizes;
+	QVector<int> blocksX;
+	int width;
+	int height;
+	int count;
+	int bandRows;
+
+	QVector<quint64> sums; // count sums per band
 
-	if (mseMap)
+	void operator()(int from, int to);
+};
+
+void SSEBands::operator()( int from, int to )
+{
+	QVector<QVector<quint64> > blockSums(count);
+	for (int k=0; k<count; k++)
 	{
-		if (mseMap->size() < width*height)
+		if (maps[k] && blockSizes[k] > 1)
 		{
-			mseMap->resize(width*height);
+			blockSums[k].resize(blocksX[k]);
 		}
 	}
 
-	unsigned char* p1 = input1->Data(plane);
-	unsigned char* p2 = input2->Data(plane);
-	int stride1 = input1->Format()->Stride(plane);
-	int stride2 = input2->Format()->Stride(plane);
-	float* mseData = mseMap?mseMap->data():0;
-
-	float mse = 0;
-	int mseI = 0;
-	for (int i=0; i<height; i++)
+	int rowFrom = from*bandRows;
+	int rowTo = qMin(to*bandRows, height);
+	for (int i=rowFrom; i<rowTo; i++)
 	{
-		for (int j=0; j<width; j++)
+		const unsigned char* row1 = p1+i*stride1;
+		quint64* bandSums = sums.data()+(i/bandRows)*count;
+		for (int k=0; k<count; k++)
 		{
-			int diff = ((int)p1[j])-((int)p2[j]);
-			diff = diff*diff;
-			mse += diff;
+			const unsigned char* row2 = p2[k]+i*stride2[k];
+			int blockSize = blockSizes[k];
+			if (!maps[k])
+			{
+				bandSums[k] += RowSSE(row1, row2, width);
+			}else if (blockSize <= 1)
+			{
+				float* mapRow = maps[k]+i*width;
+				quint64 sum = 0;
+				for (int j=0; j<width; j++)
+				{
+					int diff = ((int)row1[j])-((int)row2[j]);
+					diff = diff*diff;
+					sum += diff;
+					mapRow[j] = (float)diff;
+				}
+				bandSums[k] += sum;
+			}else
+			{
+				quint64* blockRow = blockSums[k].data();
+				int blockY = i%blockSize;
+				if (blockY == 0)
+				{
+					memset(blockRow, 0, blocksX[k]*sizeof(quint64));
+				}
+
+				for (int b=0; b<blocksX[k]; b++)
+				{
+					int j = b*blockSize;
+					quint64 blockSum = RowSSE(row1+j, row2+j, qMin(blockSize, width-j));
+					blockRow[b] += blockSum;
+					bandSums[k] += blockSum;
+				}
 
-			if (mseData)
+				// Last row of the blocks, store mean of each block
+				if (blockY == blockSize-1 || i == height-1)
+				{
+					float* mapRow = maps[k]+(i/blockSize)*blocksX[k];
+					for (int b=0; b<blocksX[k]; b++)
+					{
+						int pixels = qMin(blockSize, width-b*blockSize)*(blockY+1);
+						mapRow[b] = (float)(((double)blockRow[b])/pixels);
+					}
+				}
+			}
+		}
+	}
+}
+
+static int GreatestCommonDivisor(int a, int b)
+{
+	while (b)
+	{
+		int t = a%b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// Number of rows per band at least, so threads do not share small bands
+#define SSE_BAND_MIN_ROWS 16
+
+// Computes sum of squared errors of one plane for all processed frames. Rows of
+// the reference plane are read once and compared with the same row of every 
+// processed frame, so the reference row stays in cache while it is used K times.
+// MSE maps have one value per blockSizes[k] x blockSizes[k] block, the squared
+// errors are summed per block while the rows are compared, so full resolution 
+// map is never stored.
+void MeasuresBasic::ComputeSSE( FramePtr input, const FrameList& processed, int plane, 
+	const QList<DistMapPtr>& mseMaps, const QList<int>& blockSizes, quint64* sse)
+{
+	SSEBands bands;
+	bands.width = input->Format()->PlaneWidth(plane);
+	bands.height = input->Format()->PlaneHeight(plane);
+	bands.count = processed.size();
+	bands.p1 = input->Data(plane);
+	bands.stride1 = input->Format()->Stride(plane);
+	bands.p2.resize(bands.count);
+	bands.stride2.resize(bands.count);
+	bands.maps.resize(bands.count);
+	bands.blockSizes.resize(bands.count);
+	bands.blocksX.resize(bands.count);
+
+	int bandRows = 1;
+	for (int k=0; k<bands.count; k++)
+	{
+		FramePtr input2 = processed.at(k);
+		bands.p2[k] = input2->Data(plane);
+		bands.stride2[k] = input2->Format()->Stride(plane);
+		bands.maps[k] = 0;
+
+		int blockSize = qMax(blockSizes.at(k), 1);
+		bands.blockSizes[k] = blockSize;
+		bands.blocksX[k] = (bands.width+blockSize-1)/blockSize;
+		int blocksY = (bands.height+blockSize-1)/blockSize;
+
+		DistMapPtr mseMap = mseMaps.at(k);
+		if (mseMap)
+		{
+			if (mseMap->size() < bands.blocksX[k]*blocksY)
 			{
-				mseData[mseI++] = (float)diff;
+				mseMap->resize(bands.blocksX[k]*blocksY);
 			}
+			bands.maps[k] = mseMap->data();
+
+			// Least common multiple of block sizes
+			bandRows = bandRows/GreatestCommonDivisor(bandRows, blockSize)*blockSize;
 		}
-		p1 += stride1;
-		p2 += stride2;
 	}
-	mse /= width;
-	mse /= height;
+	bands.bandRows = bandRows;
+
+	int bandCount = (bands.height+bandRows-1)/bandRows;
+	bands.sums.fill(0, bandCount*bands.count);
+	ParallelFor(bandCount, (SSE_BAND_MIN_ROWS+bandRows-1)/bandRows, bands);
 
-	return mse;
+	for (int k=0; k<bands.count; k++)
+	{
+		sse[k] = 0;
+		for (int n=0; n<bandCount; n++)
+		{
+			sse[k] += bands.sums.at(n*bands.count+k);
+		}
+	}
 }
 
 const MeasureCapabilities& MeasuresBasic::GetCapabilities()
@@ -82,153 +227,206 @@ const MeasureCapabilities& MeasuresBasic::GetCapabilities()
 
 void MeasuresBasic::Process(FramePtr source1, FramePtr source2, YUV_PLANE plane, const QList<MeasureOperation*>& operations)
 {
-	int idxMse = -1;
-	int idxPsnr = -1;
-	for (int i=0; i<operations.size(); i++)
+	FrameList processed;
+	processed.append(source2);
+	QList<QList<MeasureOperation*> > operationsList;
+	operationsList.append(operations);
+
+	ProcessMultiple(source1, processed, plane, operationsList);
+}
+
+void MeasuresBasic::ProcessMultiple(FramePtr source, const FrameList& processed, YUV_PLANE plane, 
+	const QList<QList<MeasureOperation*> >& operations)
+{
+	int count = processed.size();
+	QVector<MeasureOperation*> opMse(count);
+	QVector<MeasureOperation*> opPsnr(count);
+	QVector<double*> mseResults(count);
+	QList<DistMapPtr> mseMaps;
+	QVector<int> weightSum(count);
+	QVector<int> planeMask(count);
+	QVector<int> blockSizes(count);
+
+	for (int k=0; k<count; k++)
 	{
-		MeasureOperation* op = operations[i];
+		const QList<MeasureOperation*>& ops = operations.at(k);
+		opMse[k] = 0;
+		opPsnr[k] = 0;
+		for (int i=0; i<ops.size(); i++)
+		{
+			MeasureOperation* op = ops[i];
+
+			op->hasResults[PLANE_Y] = 
+				op->hasResults[PLANE_U] = 
+				op->hasResults[PLANE_V] = 
+				op->hasResults[PLANE_COLOR] = 
+				false;
 
-		op->hasResults[PLANE_Y] = 
-			op->hasResults[PLANE_U] = 
-			op->hasResults[PLANE_V] = 
-			op->hasResults[PLANE_COLOR] = 
-			false;
+			if (op->measureName == "MSE")
+			{
+				opMse[k] = op;
+			}else if (op->measureName == "PSNR")
+			{
+				opPsnr[k] = op;
+			}
+		}
+
+		// Without MSE operation the results are accumulated in PSNR operation
+		// and converted to PSNR in place
+		mseResults[k] = opMse[k]?opMse[k]->results:(opPsnr[k]?opPsnr[k]->results:0);
+		for (int i=0; mseResults[k] && i<PLANE_COUNT; i++)
+		{
+			mseResults[k][i] = 0;
+		}
+		if (opPsnr[k])
+		{
+			opPsnr[k]->results[PLANE_Y] = opPsnr[k]->results[PLANE_U] = 
+				opPsnr[k]->results[PLANE_V] = opPsnr[k]->results[PLANE_COLOR] = 0;
+		}
 
-		if (op->measureName == "MSE")
+		DistMapPtr mseMap;
+		blockSizes[k] = 1;
+		if (opMse[k] && opMse[k]->distMap)
 		{
-			idxMse = i;
-		}else if (op->measureName == "PSNR")
+			mseMap = opMse[k]->distMap;
+			blockSizes[k] = qMax(opMse[k]->distMapBlockSize, 1);
+		}else if (opPsnr[k] && opPsnr[k]->distMap)
 		{
-			idxPsnr = i;
+			mseMap = opPsnr[k]->distMap;
+			blockSizes[k] = qMax(opPsnr[k]->distMapBlockSize, 1);
 		}
+		mseMaps.append(mseMap);
+		weightSum[k] = 0;
+		planeMask[k] = 0;
 	}
 
-	MeasureOperation* opMse = (idxMse>=0)?operations[idxMse]:0;
-	MeasureOperation* opPsnr = (idxPsnr>=0)?operations[idxPsnr]:0;
-	DistMapPtr mseMap;
 	int distMapWidth = 0;
 	int distMapHeight = 0;
-	double* mseResults;
-	if (opMse)
-	{
-		opMse->results[PLANE_Y] = opMse->results[PLANE_U] = 
-			opMse->results[PLANE_V] = opMse->results[PLANE_COLOR] = 0;
-		mseResults = opMse->results;
-	}else if (opPsnr)
-	{
-		mseResults = opPsnr->results;
-	}else
+	QVector<quint64> sse(count);
+	for (int i=0; i<PLANE_COLOR; i++)
 	{
-		return;
-	}
-	
-	if (opPsnr)
-	{
-		opPsnr->results[PLANE_Y] = opPsnr->results[PLANE_U] = 
-			opPsnr->results[PLANE_V] = opPsnr->results[PLANE_COLOR] = 0;
-	}
+		int width1 = source->Format()->PlaneWidth(i);
+		int height1 = source->Format()->PlaneHeight(i);
+		if (width1<=0 || height1<=0)
+		{
+			continue;
+		}
 
-	int weightSum = 0;
-	for (int i=0; i<PLANE_COUNT; i++)
-	{
-		if (i<PLANE_COLOR)
-		{
-			int width1 = source1->Format()->PlaneWidth(i);
-			int height1 = source1->Format()->PlaneHeight(i);
-			int width2 = source2->Format()->PlaneWidth(i);
-			int height2 = source2->Format()->PlaneHeight(i);
-			
-			if (width1 == width2 && height1 == height2 && width1>0 && height1>0)
+		// Only frames with same plane size as reference can be compared
+		FrameList frames;
+		QList<DistMapPtr> maps;
+		QList<int> sizes;
+		QList<int> indices;
+		for (int k=0; k<count; k++)
+		{
+			FramePtr source2 = processed.at(k);
+			if (mseResults[k] && source2->Format()->PlaneWidth(i) == width1 && 
+				source2->Format()->PlaneHeight(i) == height1)
 			{
-				int weightPlane = source1->Format()->Width()*source1->Format()->Height()*4/width1/height1;
-				weightSum += weightPlane;
+				frames.append(source2);
+				maps.append((i == plane)?mseMaps.at(k):DistMapPtr());
+				sizes.append(blockSizes.at(k));
+				indices.append(k);
+			}
+		}
 
-				float mse = 0;
-				if (i == plane)
-				{
-					if (opMse && opMse->distMap)
-					{
-						mseMap = opMse->distMap;
-					}else if (opPsnr && opPsnr->distMap)
-					{
-						mseMap = opPsnr->distMap;
-					}
-					
-					if (mseMap)
-					{
-						distMapWidth = width1;
-						distMapHeight = height1;
-					}
+		if (frames.size() == 0)
+		{
+			continue;
+		}
 
-					mse = ComputeMSE(source1, source2, i, mseMap);
-				}else
-				{
-					mse = ComputeMSE(source1, source2, i, DistMapPtr());
-				}
+		if (i == plane)
+		{
+			distMapWidth = width1;
+			distMapHeight = height1;
+		}
 
-				mseResults[i] = mse;
-				mseResults[PLANE_COLOR] += weightPlane*mse;
-				if (opMse)
-				{
-					opMse->hasResults[i] = true;
-				}
-			}
-		}else
+		ComputeSSE(source, frames, i, maps, sizes, sse.data());
+
+		int weightPlane = source->Format()->Width()*source->Format()->Height()*4/width1/height1;
+		for (int n=0; n<indices.size(); n++)
 		{
-			mseResults[i] /= weightSum;
-			if (opMse)
+			int k = indices.at(n);
+			weightSum[k] += weightPlane;
+			planeMask[k] |= (1<<i);
+			double mse = ((double)sse[n])/((double)width1*height1);
+			mseResults[k][i] = mse;
+			mseResults[k][PLANE_COLOR] += weightPlane*mse;
+			if (opMse[k])
 			{
-				opMse->hasResults[i] = true;
+				opMse[k]->hasResults[i] = true;
 			}
 		}
+	}
 
-		if (opPsnr && weightSum>0)
+	for (int k=0; k<count; k++)
+	{
+		if (weightSum[k] == 0)
 		{
-			float mse_min = qMax<float>(mseResults[i], 0.001f);
-			opPsnr->results[i] = 20.0*log10(255.0) - 10.0*log10(mse_min);
-			opPsnr->hasResults[i] = true;
+			continue;
 		}
-	}
 
-	if (mseMap)
-	{
-		int mapSize = distMapWidth*distMapHeight;
-		if (opPsnr && opPsnr->distMap)
+		mseResults[k][PLANE_COLOR] /= weightSum[k];
+		if (opMse[k])
 		{
-			if (opMse && opMse->distMap)
+			opMse[k]->hasResults[PLANE_COLOR] = true;
+		}
+
+		if (opPsnr[k])
+		{
+			for (int i=0; i<PLANE_COUNT; i++)
 			{
-				// generate PSNR map from MSE map
-				if (opPsnr->distMap->size()<mapSize)
+				if (i<PLANE_COLOR && !(planeMask[k] & (1<<i)))
 				{
-					opPsnr->distMap->resize(mapSize);
+					continue;
 				}
+				double mse_min = qMax<double>(mseResults[k][i], 0.001);
+				opPsnr[k]->results[i] = 20.0*log10(255.0) - 10.0*log10(mse_min);
+				opPsnr[k]->hasResults[i] = true;
+			}
+		}
+
+		DistMapPtr mseMap = mseMaps.at(k);
+		if (!mseMap || !distMapWidth || !distMapHeight)
+		{
+			continue;
+		}
 
-				float* psnrData = opPsnr->distMap->data();
-				float* mseData = opMse->distMap->data();
-				float c = 20.0*log10(255.0);
-				for (int i=0; i<mapSize; i++)
+		int mapWidth = (distMapWidth+blockSizes.at(k)-1)/blockSizes.at(k);
+		int mapHeight = (distMapHeight+blockSizes.at(k)-1)/blockSizes.at(k);
+		int mapSize = mapWidth*mapHeight;
+		if (opPsnr[k] && opPsnr[k]->distMap)
+		{
+			if (opMse[k] && opMse[k]->distMap)
+			{
+				// generate PSNR map from MSE map
+				if (opPsnr[k]->distMap->size()<mapSize)
 				{
-					psnrData[i] = c - 10.0*log10(mseData[i]);
+					opPsnr[k]->distMap->resize(mapSize);
 				}
+
+				PSNRMapper mapper;
+				mapper.src = opMse[k]->distMap->data();
+				mapper.dst = opPsnr[k]->distMap->data();
+				mapper.c = 20.0*log10(255.0);
+				ParallelFor(mapSize, PSNR_MAP_GRAIN, mapper);
 			}else
 			{
 				// generate PSNR map in-place
-				float c = 20.0*log10(255.0);
-				float* psnrData = opPsnr->distMap->data();
-				for (int i=0; i<mapSize; i++)
-				{
-					psnrData[i] = c - 10.0*log10(psnrData[i]);
-				}
+				PSNRMapper mapper;
+				mapper.src = mapper.dst = opPsnr[k]->distMap->data();
+				mapper.c = 20.0*log10(255.0);
+				ParallelFor(mapSize, PSNR_MAP_GRAIN, mapper);
 			}
 
-			opPsnr->distMapWidth = distMapWidth;
-			opPsnr->distMapHeight = distMapHeight;
+			opPsnr[k]->distMapWidth = mapWidth;
+			opPsnr[k]->distMapHeight = mapHeight;
 		}
 
-		if (opMse && opMse->distMap)
+		if (opMse[k] && opMse[k]->distMap)
 		{
-			opMse->distMapWidth = distMapWidth;
-			opMse->distMapHeight = distMapHeight;
+			opMse[k]->distMapWidth = mapWidth;
+			opMse[k]->distMapHeight = mapHeight;
 		}
 	}
 }
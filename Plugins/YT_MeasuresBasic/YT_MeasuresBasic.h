@@ -7,7 +7,8 @@ class MeasuresBasic : public QObject, public Measure
 {
 	Q_OBJECT;
 
-	float ComputeMSE(FramePtr input1, FramePtr input2, int plane, DistMapPtr mseMap);
+	void ComputeSSE(FramePtr input, const FrameList& processed, int plane, 
+		const QList<DistMapPtr>& mseMaps, const QList<int>& blockSizes, quint64* sse);
 
 	MeasureCapabilities m_Capabilities;
 public:
@@ -16,6 +17,8 @@ public:
 
 	virtual const MeasureCapabilities& GetCapabilities();
 	virtual void Process(FramePtr source1, FramePtr source2, YUV_PLANE plane, const QList<MeasureOperation*>& operations);
+	virtual void ProcessMultiple(FramePtr source, const FrameList& processed, YUV_PLANE plane, 
+		const QList<QList<MeasureOperation*> >& operations);
 };
 
 #endif // MEASURESBASIC_H
@@ -0,0 +1,503 @@
+#include "YT_TransformsPlugin.h"
+#include "YT_Transforms.h"
+#include "../FastMath.h"
+#include "../PlaneScaling.h"
+
+// Size of square tiles rotated at once, so rows written and columns read
+// both stay in cache
+#define ROTATE_TILE_SIZE 32
+
+static inline bool IsNative(COLOR_FORMAT color)
+{
+	return color == Y800 || color == I420 || color == I422 || color == I444;
+}
+
+static inline int PlaneCount(COLOR_FORMAT color)
+{
+	return (color == Y800)?1:3;
+}
+
+static void CopyPlane(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int width, int height)
+{
+	for (int i=0; i<height; i++)
+	{
+		memcpy(dst+i*dstStride, src+i*srcStride, width);
+	}
+}
+
+// dst = clamp(a-b+128), so equal pixels are mid gray
+static void DifferenceRow(const unsigned char* a, const unsigned char* b, unsigned char* dst, int width)
+{
+	int j = 0;
+#ifdef YT_SSE2
+	// Bias to signed, saturated subtract clamps to [-128, 127], bias back
+	__m128i bias = _mm_set1_epi8((char)0x80);
+	for (; j+16<=width; j+=16)
+	{
+		__m128i va = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a+j)), bias);
+		__m128i vb = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(b+j)), bias);
+		_mm_storeu_si128((__m128i*)(dst+j), _mm_xor_si128(_mm_subs_epi8(va, vb), bias));
+	}
+#endif
+	for (; j<width; j++)
+	{
+		int diff = ((int)a[j])-((int)b[j])+128;
+		dst[j] = (unsigned char)qBound(0, diff, 255);
+	}
+}
+
+// Largest gain of amplified differences, gain*255 has to fit in 16 bits
+#define DIFFERENCE_MAX_GAIN 128
+
+// dst = clamp(offset+gain*(a-b)), or clamp(offset+gain*|a-b|) if absolute
+// is set. Differences are computed in 16 bits, the final pack saturates.
+static void AmplifiedDifferenceRow(const unsigned char* a, const unsigned char* b, unsigned char* dst, 
+	int width, int gain, int offset, bool absolute)
+{
+	int j = 0;
+#ifdef YT_SSE2
+	__m128i zero = _mm_setzero_si128();
+	__m128i vgain = _mm_set1_epi16((short)gain);
+	__m128i voffset = _mm_set1_epi16((short)offset);
+	for (; j+16<=width; j+=16)
+	{
+		__m128i va = _mm_loadu_si128((const __m128i*)(a+j));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b+j));
+		__m128i lo, hi;
+		if (absolute)
+		{
+			__m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+			lo = _mm_unpacklo_epi8(d, zero);
+			hi = _mm_unpackhi_epi8(d, zero);
+		}else
+		{
+			lo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+			hi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+		}
+		lo = _mm_adds_epi16(_mm_mullo_epi16(lo, vgain), voffset);
+		hi = _mm_adds_epi16(_mm_mullo_epi16(hi, vgain), voffset);
+		_mm_storeu_si128((__m128i*)(dst+j), _mm_packus_epi16(lo, hi));
+	}
+#endif
+	for (; j<width; j++)
+	{
+		int diff = ((int)a[j])-((int)b[j]);
+		if (absolute)
+		{
+			diff = qAbs(diff);
+		}
+		dst[j] = (unsigned char)qBound(0, offset+gain*diff, 255);
+	}
+}
+
+static void FlipRow(const unsigned char* src, unsigned char* dst, int width)
+{
+	int j = 0;
+#ifdef YT_SSE2
+	for (; j+16<=width; j+=16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src+width-16-j));
+		v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0,1,2,3));
+		v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2,3,0,1));
+		v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2,3,0,1));
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128((__m128i*)(dst+j), v);
+	}
+#endif
+	for (; j<width; j++)
+	{
+		dst[j] = src[width-1-j];
+	}
+}
+
+// Rotates clockwise by 90 degrees if clockwise is set, otherwise counter
+// clockwise. width and height are of the source plane.
+static void RotatePlane(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride,
+	int width, int height, bool clockwise)
+{
+	for (int ty=0; ty<width; ty+=ROTATE_TILE_SIZE)
+	{
+		for (int tx=0; tx<height; tx+=ROTATE_TILE_SIZE)
+		{
+			int yEnd = qMin(ty+ROTATE_TILE_SIZE, width);
+			int xEnd = qMin(tx+ROTATE_TILE_SIZE, height);
+			for (int y=ty; y<yEnd; y++)
+			{
+				unsigned char* row = dst+y*dstStride;
+				if (clockwise)
+				{
+					const unsigned char* col = src+y;
+					for (int x=tx; x<xEnd; x++)
+					{
+						row[x] = col[(height-1-x)*srcStride];
+					}
+				}else
+				{
+					const unsigned char* col = src+(width-1-y);
+					for (int x=tx; x<xEnd; x++)
+					{
+						row[x] = col[x*srcStride];
+					}
+				}
+			}
+		}
+	}
+}
+
+// Position of output sample i in input, in 1/256 of a sample, centers aligned
+static inline int ScalePosition(int i, int srcSize, int dstSize)
+{
+	int pos = (int)(((qint64)(2*i+1)*srcSize*256)/(2*dstSize))-128;
+	return qBound(0, pos, (srcSize-1)*256);
+}
+
+// Bilinear scaling in 8 bit fixed point
+static void ScalePlane(const unsigned char* src, int srcStride, int srcWidth, int srcHeight,
+	unsigned char* dst, int dstStride, int dstWidth, int dstHeight)
+{
+	QVector<int> x0(dstWidth), x1(dstWidth), fx(dstWidth);
+	for (int j=0; j<dstWidth; j++)
+	{
+		int pos = ScalePosition(j, srcWidth, dstWidth);
+		x0[j] = pos>>8;
+		x1[j] = qMin(x0[j]+1, srcWidth-1);
+		fx[j] = pos&0xFF;
+	}
+
+	for (int i=0; i<dstHeight; i++)
+	{
+		int pos = ScalePosition(i, srcHeight, dstHeight);
+		int y0 = pos>>8;
+		int fy = pos&0xFF;
+		const unsigned char* row0 = src+y0*srcStride;
+		const unsigned char* row1 = src+qMin(y0+1, srcHeight-1)*srcStride;
+		unsigned char* out = dst+i*dstStride;
+		for (int j=0; j<dstWidth; j++)
+		{
+			int top = row0[x0[j]]*(256-fx[j]) + row0[x1[j]]*fx[j];
+			int bottom = row1[x0[j]]*(256-fx[j]) + row1[x1[j]]*fx[j];
+			out[j] = (unsigned char)((top*(256-fy) + bottom*fy + 32768)>>16);
+		}
+	}
+}
+
+Transforms::Transforms() : m_TransformId(TRANSFORM_DIFFERENCE), m_Gain(1), m_Offset(128)
+{
+}
+
+Transforms::~Transforms()
+{
+}
+
+const QList<TransformCapability>& Transforms::GetCapabilities()
+{
+	if (m_Capabilities.size() == 0)
+	{
+		TransformCapability cap;
+		cap.need2Inputs = false;
+
+		cap.transformId = TRANSFORM_DIFFERENCE;
+		cap.outputName = "Difference";
+		cap.need2Inputs = true;
+		m_Capabilities.append(cap);
+
+		// Parameters are gain and offset of luma, chroma is always centered
+		// at 128 so that equal inputs are gray
+		cap.transformId = TRANSFORM_AMPLIFIED_DIFFERENCE;
+		cap.outputName = "Amplified Difference";
+		cap.parameters = "4,128";
+		m_Capabilities.append(cap);
+
+		cap.transformId = TRANSFORM_ABSOLUTE_DIFFERENCE;
+		cap.outputName = "Absolute Difference";
+		cap.parameters = "4,0";
+		m_Capabilities.append(cap);
+		cap.parameters = "";
+		cap.need2Inputs = false;
+
+		cap.transformId = TRANSFORM_CROP;
+		cap.outputName = "Crop";
+		cap.parameters = "0,0,320,240";
+		m_Capabilities.append(cap);
+		cap.parameters = "";
+
+		cap.transformId = TRANSFORM_FLIP_H;
+		cap.outputName = "Flip Horizontal";
+		m_Capabilities.append(cap);
+
+		cap.transformId = TRANSFORM_FLIP_V;
+		cap.outputName = "Flip Vertical";
+		m_Capabilities.append(cap);
+
+		cap.transformId = TRANSFORM_ROTATE_90;
+		cap.outputName = "Rotate 90";
+		m_Capabilities.append(cap);
+
+		cap.transformId = TRANSFORM_ROTATE_180;
+		cap.outputName = "Rotate 180";
+		m_Capabilities.append(cap);
+
+		cap.transformId = TRANSFORM_ROTATE_270;
+		cap.outputName = "Rotate 270";
+		m_Capabilities.append(cap);
+
+		cap.transformId = TRANSFORM_PLANE_Y;
+		cap.outputName = "Y Plane";
+		m_Capabilities.append(cap);
+
+		cap.transformId = TRANSFORM_PLANE_U;
+		cap.outputName = "U Plane";
+		m_Capabilities.append(cap);
+
+		cap.transformId = TRANSFORM_PLANE_V;
+		cap.outputName = "V Plane";
+		m_Capabilities.append(cap);
+
+		cap.transformId = TRANSFORM_JOIN;
+		cap.outputName = "Join Y with UV";
+		cap.need2Inputs = true;
+		m_Capabilities.append(cap);
+		cap.need2Inputs = false;
+
+		cap.transformId = TRANSFORM_SCALE;
+		cap.outputName = "Scale";
+		cap.parameters = "352x288";
+		m_Capabilities.append(cap);
+	}
+
+	return m_Capabilities;
+}
+
+RESULT Transforms::Init( unsigned int transformId, const QString& parameters )
+{
+	m_TransformId = transformId;
+
+	if (transformId == TRANSFORM_CROP)
+	{
+		QStringList values = parameters.split(',');
+		if (values.size() != 4)
+		{
+			return E_UNKNOWN;
+		}
+
+		bool ok[4];
+		m_Crop = QRect(values[0].trimmed().toInt(&ok[0]), values[1].trimmed().toInt(&ok[1]),
+			values[2].trimmed().toInt(&ok[2]), values[3].trimmed().toInt(&ok[3]));
+		if (!ok[0] || !ok[1] || !ok[2] || !ok[3] || m_Crop.x()<0 || m_Crop.y()<0 || m_Crop.isEmpty())
+		{
+			return E_UNKNOWN;
+		}
+	}else if (transformId == TRANSFORM_AMPLIFIED_DIFFERENCE || transformId == TRANSFORM_ABSOLUTE_DIFFERENCE)
+	{
+		QStringList values = parameters.split(',');
+		if (values.size() != 2)
+		{
+			return E_UNKNOWN;
+		}
+
+		bool ok[2];
+		m_Gain = values[0].trimmed().toInt(&ok[0]);
+		m_Offset = values[1].trimmed().toInt(&ok[1]);
+		if (!ok[0] || !ok[1] || m_Gain < 1 || m_Gain > DIFFERENCE_MAX_GAIN || m_Offset < 0 || m_Offset > 255)
+		{
+			return E_UNKNOWN;
+		}
+	}else if (transformId == TRANSFORM_SCALE)
+	{
+		QStringList values = parameters.toLower().split('x');
+		if (values.size() != 2)
+		{
+			return E_UNKNOWN;
+		}
+
+		bool ok[2];
+		m_Scale = QSize(values[0].trimmed().toInt(&ok[0]), values[1].trimmed().toInt(&ok[1]));
+		if (!ok[0] || !ok[1] || m_Scale.isEmpty())
+		{
+			return E_UNKNOWN;
+		}
+	}
+
+	return OK;
+}
+
+RESULT Transforms::GetFormat( const FormatPtr sourceFormat, FormatPtr outputFormat )
+{
+	COLOR_FORMAT color = sourceFormat->Color();
+	if (!IsNative(color))
+	{
+		return E_WRONG_FORMAT;
+	}
+
+	// Chroma of subsampled formats is aligned to even luma positions
+	int alignX = (color == I420 || color == I422)?2:1;
+	int alignY = (color == I420)?2:1;
+
+	int width = sourceFormat->Width();
+	int height = sourceFormat->Height();
+	switch (m_TransformId)
+	{
+	case TRANSFORM_CROP:
+		{
+			QRect rect = m_Crop.intersected(QRect(0, 0, width, height));
+			width = rect.width()/alignX*alignX;
+			height = rect.height()/alignY*alignY;
+			if (width <= 0 || height <= 0)
+			{
+				return E_WRONG_FORMAT;
+			}
+		}
+		break;
+	case TRANSFORM_ROTATE_90:
+	case TRANSFORM_ROTATE_270:
+		if (color == I422)
+		{
+			// Would be subsampled vertically
+			return E_WRONG_FORMAT;
+		}
+		qSwap(width, height);
+		break;
+	case TRANSFORM_PLANE_Y:
+	case TRANSFORM_PLANE_U:
+	case TRANSFORM_PLANE_V:
+		{
+			int plane = m_TransformId-TRANSFORM_PLANE_Y;
+			if (plane >= PlaneCount(color))
+			{
+				return E_WRONG_FORMAT;
+			}
+			width = sourceFormat->PlaneWidth(plane);
+			height = sourceFormat->PlaneHeight(plane);
+			color = Y800;
+		}
+		break;
+	case TRANSFORM_SCALE:
+		width = qMax(m_Scale.width()/alignX*alignX, alignX);
+		height = qMax(m_Scale.height()/alignY*alignY, alignY);
+		break;
+	}
+
+	outputFormat->SetColor(color);
+	outputFormat->SetWidth(width);
+	outputFormat->SetHeight(height);
+	for (int i=0; i<4; i++)
+	{
+		outputFormat->SetStride(i, 0);
+	}
+	outputFormat->PlaneSize(0);
+
+	return OK;
+}
+
+RESULT Transforms::Process( FramePtr source1, FramePtr source2, FramePtr result )
+{
+	FormatPtr format = source1->Format();
+	FormatPtr output = result->Format();
+	COLOR_FORMAT color = format->Color();
+	int alignX = (color == I420 || color == I422)?2:1;
+	int alignY = (color == I420)?2:1;
+
+	if (source2)
+	{
+		FormatPtr format2 = source2->Format();
+		if (format2->Color() != color || format2->Width() != format->Width() ||
+			format2->Height() != format->Height())
+		{
+			return E_WRONG_FORMAT;
+		}
+	}
+
+	if (m_TransformId >= TRANSFORM_PLANE_Y && m_TransformId <= TRANSFORM_PLANE_V)
+	{
+		int plane = m_TransformId-TRANSFORM_PLANE_Y;
+		CopyPlane(source1->Data(plane), format->Stride(plane), result->Data(0), output->Stride(0),
+			output->Width(), output->Height());
+		return OK;
+	}
+
+	for (int p=0; p<PlaneCount(color); p++)
+	{
+		const unsigned char* src = source1->Data(p);
+		int srcStride = format->Stride(p);
+		int srcWidth = format->PlaneWidth(p);
+		int srcHeight = format->PlaneHeight(p);
+		unsigned char* dst = result->Data(p);
+		int dstStride = output->Stride(p);
+		int dstWidth = output->PlaneWidth(p);
+		int dstHeight = output->PlaneHeight(p);
+
+		switch (m_TransformId)
+		{
+		case TRANSFORM_DIFFERENCE:
+			for (int i=0; i<dstHeight; i++)
+			{
+				DifferenceRow(src+i*srcStride, source2->Data(p)+i*source2->Format()->Stride(p),
+					dst+i*dstStride, dstWidth);
+			}
+			break;
+		case TRANSFORM_AMPLIFIED_DIFFERENCE:
+		case TRANSFORM_ABSOLUTE_DIFFERENCE:
+			{
+				int offset = (p == 0)?m_Offset:128;
+				for (int i=0; i<dstHeight; i++)
+				{
+					AmplifiedDifferenceRow(src+i*srcStride, source2->Data(p)+i*source2->Format()->Stride(p),
+						dst+i*dstStride, dstWidth, m_Gain, offset, m_TransformId == TRANSFORM_ABSOLUTE_DIFFERENCE);
+				}
+			}
+			break;
+		case TRANSFORM_CROP:
+			{
+				// Origin is aligned like the size, see GetFormat(..)
+				int x = m_Crop.x()/alignX*alignX*srcWidth/format->Width();
+				int y = m_Crop.y()/alignY*alignY*srcHeight/format->Height();
+				CopyPlane(src+y*srcStride+x, srcStride, dst, dstStride, dstWidth, dstHeight);
+			}
+			break;
+		case TRANSFORM_FLIP_H:
+			for (int i=0; i<dstHeight; i++)
+			{
+				FlipRow(src+i*srcStride, dst+i*dstStride, dstWidth);
+			}
+			break;
+		case TRANSFORM_FLIP_V:
+			for (int i=0; i<dstHeight; i++)
+			{
+				memcpy(dst+i*dstStride, src+(srcHeight-1-i)*srcStride, dstWidth);
+			}
+			break;
+		case TRANSFORM_ROTATE_90:
+		case TRANSFORM_ROTATE_270:
+			RotatePlane(src, srcStride, dst, dstStride, srcWidth, srcHeight, m_TransformId == TRANSFORM_ROTATE_90);
+			break;
+		case TRANSFORM_ROTATE_180:
+			for (int i=0; i<dstHeight; i++)
+			{
+				FlipRow(src+(srcHeight-1-i)*srcStride, dst+i*dstStride, dstWidth);
+			}
+			break;
+		case TRANSFORM_JOIN:
+			if (p == 0)
+			{
+				CopyPlane(src, srcStride, dst, dstStride, dstWidth, dstHeight);
+			}else
+			{
+				CopyPlane(source2->Data(p), source2->Format()->Stride(p), dst, dstStride, dstWidth, dstHeight);
+			}
+			break;
+		case TRANSFORM_SCALE:
+			if (dstWidth*2 == srcWidth && dstHeight*2 == srcHeight)
+			{
+				HalvePlane(src, srcStride, dst, dstStride, dstWidth, dstHeight);
+			}else
+			{
+				ScalePlane(src, srcStride, srcWidth, srcHeight, dst, dstStride, dstWidth, dstHeight);
+			}
+			break;
+		default:
+			return E_UNKNOWN;
+		}
+	}
+
+	return OK;
+}
@@ -0,0 +1,44 @@
+#ifndef TRANSFORMS_H
+#define TRANSFORMS_H
+
+#include "../YT_Interface.h"
+
+enum TRANSFORM_ID {
+	TRANSFORM_DIFFERENCE,
+	TRANSFORM_CROP,
+	TRANSFORM_FLIP_H,
+	TRANSFORM_FLIP_V,
+	TRANSFORM_ROTATE_90,
+	TRANSFORM_ROTATE_180,
+	TRANSFORM_ROTATE_270,
+	TRANSFORM_PLANE_Y,
+	TRANSFORM_PLANE_U,
+	TRANSFORM_PLANE_V,
+	TRANSFORM_JOIN,
+	TRANSFORM_SCALE,
+	TRANSFORM_AMPLIFIED_DIFFERENCE,
+	TRANSFORM_ABSOLUTE_DIFFERENCE
+};
+
+// Basic transforms of native formats, rows are processed with SSE2 where
+// it pays off. Each instance does one transform, selected in Init(..).
+class Transforms : public Transform
+{
+	QList<TransformCapability> m_Capabilities;
+
+	unsigned int m_TransformId;
+	QRect m_Crop;
+	QSize m_Scale;
+	int m_Gain;
+	int m_Offset;
+public:
+	Transforms();
+	~Transforms();
+
+	virtual const QList<TransformCapability>& GetCapabilities();
+	virtual RESULT Init(unsigned int transformId, const QString& parameters);
+	virtual RESULT GetFormat(const FormatPtr sourceFormat, FormatPtr outputFormat);
+	virtual RESULT Process(FramePtr source1, FramePtr source2, FramePtr result);
+};
+
+#endif // TRANSFORMS_H
@@ -0,0 +1,14 @@
+TARGET   = YT_Transforms
+QT      +=
+
+DEFINES +=
+
+SOURCES += YT_Transforms.cpp \
+YT_TransformsPlugin.cpp
+
+HEADERS += YT_Transforms.h \
+YT_TransformsPlugin.h
+
+! include( ../common.pri ) {
+	error( common.pri not found )
+}
@@ -0,0 +1,29 @@
+#include "YT_Transforms.h"
+#include "YT_TransformsPlugin.h"
+
+Q_EXPORT_PLUGIN2(Transforms, TransformsPlugin)
+
+Host* g_Host = 0;
+Host* GetHost()
+{
+	return g_Host;
+}
+
+RESULT TransformsPlugin::Init( Host* host )
+{
+	g_Host = host;
+
+	g_Host->RegisterPlugin(this, PLUGIN_TRANSFORM, QString("Transforms"));
+
+	return OK;
+}
+
+Transform* TransformsPlugin::NewTransform( const QString& name )
+{
+	return new Transforms;
+}
+
+void TransformsPlugin::ReleaseTransform( Transform* t )
+{
+	delete t;
+}
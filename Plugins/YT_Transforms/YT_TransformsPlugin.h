@@ -0,0 +1,17 @@
+#ifndef TRANSFORMSPLUGIN_H
+#define TRANSFORMSPLUGIN_H
+
+#include "../YT_Interface.h"
+
+class TransformsPlugin : public QObject, public YTPlugIn
+{
+	Q_OBJECT;
+	Q_INTERFACES(YTPlugIn);
+public:
+	virtual RESULT Init(Host*);
+
+	virtual Transform* NewTransform(const QString& name);
+	virtual void ReleaseTransform(Transform*);
+};
+
+#endif // TRANSFORMSPLUGIN_H
@@ -1,6 +1,7 @@
 #include "YT_Interface.h"
 #include "ColorConversion.h"
 #include "YT_InterfaceImpl.h"
+#include "PlaneScaling.h"
 #include <stdlib.h>
 #include <memory.h>
 
@@ -15,6 +16,10 @@ extern "C" {
 
 #define MyMin(x,y)	((x<y)?x:y)
 
+// Input rows per call of converter when output is passed to a sink,
+// multiple of 2 for vertically subsampled input
+#define CONVERSION_BAND_ROWS 32
+
 #include "FFMpeg_Formats.h"
 
 COLOR_FORMAT GetFlippedColor(COLOR_FORMAT c)
@@ -53,7 +58,26 @@ void PrepareCC(COLOR_FORMAT& color, unsigned char* (&data)[4])
 	}
 }
 
-void ColorConversion(const Frame& in, Frame& out)
+static void CopyFrameInfo(const Frame& in, Frame& out)
+{
+	out.SetPTS(in.PTS());
+	out.SetFrameNumber(in.FrameNumber());
+	for (int i=0; i<LAST_INFO_KEY; i++)
+	{
+		if (in.HasInfo((INFO_KEY)i))
+		{
+			out.SetInfo((INFO_KEY)i, in.Info((INFO_KEY)i));
+		}
+	}
+}
+
+// Input formats whose chroma planes have half as many rows
+static bool IsVerticallySubsampled(COLOR_FORMAT color)
+{
+	return color == I420 || color == YV12 || color == NV12;
+}
+
+void ColorConversion(const Frame& in, Frame& out, ConversionSink* sink)
 {
 	const FormatPtr format_in = in.Format();
 	FormatPtr format_out = out.Format();
@@ -101,12 +125,40 @@ void ColorConversion(const Frame& in, Frame& out)
 			YT2FFMpegFormat(color_in), format_out->Width(), format_out->Height(),
 			YT2FFMpegFormat(color_out),
 			SWS_BILINEAR, NULL,NULL,NULL );
-		if (ctx)
+		if (ctx && !sink)
 		{
 			if (sws_scale( ctx, data_in, step_in, 0, format_in->Height(), data_out, format_out->Stride()) == format_out->Height())
 			{
 				ok = true;
 			}
+		}else if (ctx)
+		{
+			// Slices are given in order from the top, each call returns 
+			// the output rows that are complete so far
+			int rowsOut = 0;
+			int height = format_in->Height();
+			for (int y=0; y<height; y+=CONVERSION_BAND_ROWS)
+			{
+				int rows = MyMin(CONVERSION_BAND_ROWS, height-y);
+				unsigned char* slice[4];
+				for (int i=0; i<4; i++)
+				{
+					int sliceY = (i>0 && IsVerticallySubsampled(color_in))?y/2:y;
+					slice[i] = data_in[i]?data_in[i]+sliceY*step_in[i]:0;
+				}
+
+				int n = sws_scale( ctx, slice, step_in, y, rows, data_out, format_out->Stride());
+				if (n > 0)
+				{
+					sink->RowsConverted(out, rowsOut, rowsOut+n);
+					rowsOut += n;
+				}
+			}
+			ok = (rowsOut == format_out->Height());
+		}
+
+		if (ctx)
+		{
 			sws_freeContext( ctx );
 		}		
 	}
@@ -121,17 +173,137 @@ void ColorConversion(const Frame& in, Frame& out)
 				data_out[i][j] = rand()*255/RAND_MAX;
 			}
 		}
+
+		if (sink)
+		{
+			sink->RowsConverted(out, 0, format_out->Height());
+		}
 	}
 
-	out.SetPTS(in.PTS());
-	out.SetFrameNumber(in.FrameNumber());
-	for (int i=0; i<LAST_INFO_KEY; i++)
+	CopyFrameInfo(in, out);
+}
+
+void ScaledColorConversion( const Frame& in, const QRect& rect, Frame& out, FrameImpl& scratch )
+{
+	const FormatPtr format_in = in.Format();
+	FormatPtr format_out = out.Format();
+	COLOR_FORMAT color = format_in->Color();
+
+	// Part of in shown, without copying
+	FrameImpl crop;
+	crop.Format()->SetColor(color);
+	crop.Format()->SetWidth(rect.width());
+	crop.Format()->SetHeight(rect.height());
+	for (int i=0; i<4; i++)
 	{
-		if (in.HasInfo((INFO_KEY)i))
+		int stride = format_in->Stride(i);
+		crop.Format()->SetStride(i, stride);
+		if (in.Data(i) && stride && format_in->PlaneWidth(i))
 		{
-			out.SetInfo((INFO_KEY)i, in.Info((INFO_KEY)i));
+			int x = rect.left()*format_in->PlaneWidth(i)/format_in->Width();
+			int y = rect.top()*format_in->PlaneHeight(i)/format_in->Height();
+			crop.SetData(i, in.Data(i)+y*stride+x);
 		}
 	}
+	crop.Format()->PlaneSize(0);
+
+	const Frame* src = &crop;
+	int width = rect.width();
+	int height = rect.height();
+	while (width >= 2*format_out->Width() && height >= 2*format_out->Height())
+	{
+		FormatPtr format_src = src->Format();
+		width /= 2;
+		height /= 2;
+
+		if (src == &crop)
+		{
+			scratch.Format()->SetColor(color);
+			scratch.Format()->SetWidth(width);
+			scratch.Format()->SetHeight(height);
+			for (int i=0; i<4; i++)
+			{
+				scratch.Format()->SetStride(i, 0);
+			}
+			scratch.Format()->PlaneSize(0);
+			if (scratch.Allocate() != OK)
+			{
+				break;
+			}
+		}else
+		{
+			// Halved again in place, strides are kept
+			scratch.Format()->SetWidth(width);
+			scratch.Format()->SetHeight(height);
+		}
+
+		for (int i=0; i<4; i++)
+		{
+			int planeWidth = scratch.Format()->PlaneWidth(i);
+			int planeHeight = scratch.Format()->PlaneHeight(i);
+			if (src->Data(i) && planeWidth>0 && planeHeight>0)
+			{
+				HalvePlane(src->Data(i), format_src->Stride(i), scratch.Data(i), 
+					scratch.Format()->Stride(i), planeWidth, planeHeight);
+			}
+		}
+		src = &scratch;
+	}
+
+	if (src->Format()->Color() == format_out->Color() && 
+		src->Format()->Width() == format_out->Width() && src->Format()->Height() == format_out->Height())
+	{
+		CopyFrame(*src, out);
+	}else
+	{
+		ColorConversion(*src, out);
+	}
+
+	CopyFrameInfo(in, out);
+}
+
+void CopyFrame(const Frame& in, Frame& out)
+{
+	const FormatPtr format_in = in.Format();
+	FormatPtr format_out = out.Format();
+
+	for (int i=0; i<4; i++)
+	{
+		int stride_in = format_in->Stride(i);
+		int stride_out = format_out->Stride(i);
+		if (stride_in == 0 || stride_out == 0 || !in.Data(i) || !out.Data(i))
+		{
+			continue;
+		}
+
+		int width = format_in->PlaneWidth(i);
+		if (width <= 0)
+		{
+			width = MyMin(stride_in, stride_out);
+		}
+		int height = format_in->PlaneHeight(i);
+		if (height <= 0)
+		{
+			height = (int)(format_in->PlaneSize(i)/stride_in);
+		}
+
+		if (stride_in == stride_out && stride_in == width)
+		{
+			memcpy(out.Data(i), in.Data(i), width*height);
+		}else
+		{
+			const unsigned char* src = in.Data(i);
+			unsigned char* dst = out.Data(i);
+			for (int y=0; y<height; y++)
+			{
+				memcpy(dst, src, width);
+				src += stride_in;
+				dst += stride_out;
+			}
+		}
+	}
+
+	CopyFrameInfo(in, out);
 }
 
 bool IsNativeFormat( unsigned int fourcc )
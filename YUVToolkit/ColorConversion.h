@@ -2,8 +2,30 @@
 #define COLOR_CONVERSION_H
 
 class Frame;
+class FrameImpl;
+class QRect;
 
-void ColorConversion(const Frame& in, Frame& out);
+// Receives bands of rows of the output frame as soon as they are converted,
+// so they can be processed further while still in cache. Rows are luma rows.
+class ConversionSink
+{
+public:
+	virtual ~ConversionSink() {}
+	virtual void RowsConverted(const Frame& out, int from, int to) = 0;
+};
+
+// Converts in bands of CONVERSION_BAND_ROWS rows if sink is given
+void ColorConversion(const Frame& in, Frame& out, ConversionSink* sink=0);
+
+// Converts rect of native format frame in to out, scaled to the size of out.
+// While rect is at least twice the size of out, planes are first averaged
+// 2x2 into scratch, so the converter reads a quarter as many pixels for each
+// halving. If out is the size of rect, only rect is copied or converted.
+// Rect has to be aligned to chroma subsampling of in.
+void ScaledColorConversion(const Frame& in, const QRect& rect, Frame& out, FrameImpl& scratch);
+
+// Copy planes of frames with same color, width and height, strides may differ
+void CopyFrame(const Frame& in, Frame& out);
 
 // Return true if it is a supported format
 bool IsFormatSupported(unsigned int fourcc);
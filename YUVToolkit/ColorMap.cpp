@@ -1,4 +1,6 @@
 #include "ColorMap.h"
+#include "FastMath.h"
+#include "ParallelFor.h"
 
 unsigned int colorMapUndershoots[] = {
 	0xFF0000FF, // Blue
@@ -58,6 +60,73 @@ unsigned int colorMaps[][256] = {
 };
 
 
+// Number of map values per thread
+#define COLOR_MAP_GRAIN (64*1024)
+
+// Maps values through a table that has lower and upper color in first and
+// last entries, so each value becomes clamp, scale and one table look up
+struct ColorMapper
+{
+	const float* src;
+	unsigned int* dst;
+	unsigned int table[258];
+	float lowerRange;
+	float upperRange;
+	float ref; // value mapped to first color of the range
+	float scale; // negative when bigger value is better
+	float maxIndex;
+	int offset;
+
+	inline int Index(float v) const
+	{
+		if (v>=upperRange)
+		{
+			return 257;
+		}else if (v<=lowerRange)
+		{
+			return 0;
+		}
+		return (int)qMin((v-ref)*scale, maxIndex)+offset+1;
+	}
+
+	void operator()(int from, int to)
+	{
+		int x = from;
+#ifdef YT_SSE2
+		__m128 lower4 = _mm_set1_ps(lowerRange);
+		__m128 upper4 = _mm_set1_ps(upperRange);
+		__m128 ref4 = _mm_set1_ps(ref);
+		__m128 scale4 = _mm_set1_ps(scale);
+		__m128 maxIndex4 = _mm_set1_ps(maxIndex);
+		__m128i offset4 = _mm_set1_epi32(offset+1);
+		__m128i last4 = _mm_set1_epi32(257);
+		for (; x+4<=to; x+=4)
+		{
+			__m128 v = _mm_loadu_ps(src+x);
+			// min(..) also maps NaN into the range
+			__m128 t = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(v, ref4), scale4), maxIndex4);
+			__m128i idx = _mm_add_epi32(_mm_cvttps_epi32(t), offset4);
+
+			__m128i under = _mm_castps_si128(_mm_cmple_ps(v, lower4));
+			__m128i over = _mm_castps_si128(_mm_cmpge_ps(v, upper4));
+			idx = _mm_andnot_si128(_mm_or_si128(under, over), idx);
+			idx = _mm_or_si128(idx, _mm_and_si128(over, last4));
+
+			int i[4];
+			_mm_storeu_si128((__m128i*)i, idx);
+			dst[x] = table[i[0]];
+			dst[x+1] = table[i[1]];
+			dst[x+2] = table[i[2]];
+			dst[x+3] = table[i[3]];
+		}
+#endif
+		for (; x<to; x++)
+		{
+			dst[x] = table[Index(src[x])];
+		}
+	}
+};
+
 void CreateColorMap( FramePtr frame, DistMapPtr distMap, int width, int height, float upperRange, float lowerRange, bool biggerValueIsBetter )
 {
 	FormatPtr format = frame->Format();
@@ -76,12 +145,10 @@ void CreateColorMap( FramePtr frame, DistMapPtr distMap, int width, int height,
 		frame->Allocate();
 	}
 
-	unsigned int* d = (unsigned int*)frame->Data(0);
 	int total = width*height;
 	int colorIdx = 0;
 	unsigned int upperColor = (biggerValueIsBetter)?colorMapUndershoots[colorIdx]:colorMapOvershoots[colorIdx];
 	unsigned int lowerColor = (biggerValueIsBetter)?colorMapOvershoots[colorIdx]:colorMapUndershoots[colorIdx];
-	unsigned int* colormap = colorMaps[colorIdx];
 	if (upperRange<lowerRange)
 	{
 		qSwap<float>(upperRange, lowerRange);
@@ -89,39 +156,19 @@ void CreateColorMap( FramePtr frame, DistMapPtr distMap, int width, int height,
 	
 	int offset=50; // cut of last range of colors to make overshoot/undershoot more distinct
 	float rangeScale = 1.0/(upperRange-lowerRange) * (255-offset*2);
-	float* mapData = distMap->data();
-	if (biggerValueIsBetter)
-	{
-		for (int x=0; x<total; x++)
-		{
-			float v = mapData[x];
-			if (v>=upperRange)
-			{
-				d[x] = upperColor;
-			}else if (v<=lowerRange)
-			{
-				d[x] = lowerColor;
-			}else
-			{
-				d[x] = colormap[(int)((upperRange-v)*rangeScale)+offset];
-			}
-		}
-	}else
-	{
-		for (int x=0; x<total; x++)
-		{
-			float v = mapData[x];
-			if (v>=upperRange)
-			{
-				d[x] = upperColor;
-			}else if (v<=lowerRange)
-			{
-				d[x] = lowerColor;
-			}else
-			{
-				d[x] = colormap[(int)((v-lowerRange)*rangeScale)+offset];
-			}
-		}
-	}
-	
+
+	ColorMapper mapper;
+	mapper.src = distMap->data();
+	mapper.dst = (unsigned int*)frame->Data(0);
+	mapper.table[0] = lowerColor;
+	memcpy(mapper.table+1, colorMaps[colorIdx], sizeof(colorMaps[colorIdx]));
+	mapper.table[257] = upperColor;
+	mapper.lowerRange = lowerRange;
+	mapper.upperRange = upperRange;
+	mapper.ref = biggerValueIsBetter?upperRange:lowerRange;
+	mapper.scale = biggerValueIsBetter?-rangeScale:rangeScale;
+	mapper.maxIndex = 255-offset*2;
+	mapper.offset = offset;
+
+	ParallelFor(total, COLOR_MAP_GRAIN, mapper);
 }
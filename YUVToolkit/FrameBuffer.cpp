@@ -0,0 +1,219 @@
+#include "YT_Interface.h"
+#include "FrameBuffer.h"
+
+#if defined(Q_WS_WIN)
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+#define SMALL_PAGE_SIZE		(4*1024)
+#define HUGE_PAGE_SIZE		(2*1024*1024)
+// Buffers above this are rounded to a multiple of it, not to a power of two
+#define SIZE_CLASS_GRANULE	(64*1024)
+// Buffer is rounded up to huge pages if that wastes at most 1/N of it
+#define HUGE_PAGE_WASTE		8
+
+// Free buffers above this total are returned to the system right away
+#define MAX_FREE_SIZE		(512*1024*1024)
+
+FrameBufferArena* FrameBufferArena::Instance()
+{
+	// Never destroyed, pools may still release frames while static objects
+	// are destroyed at exit
+	static FrameBufferArena* arena = new FrameBufferArena;
+	return arena;
+}
+
+FrameBufferArena::FrameBufferArena() : m_FreeSize(0)
+{
+}
+
+FrameBufferArena::~FrameBufferArena()
+{
+	Trim();
+}
+
+// Small buffers are rounded up to power of two number of pages, larger ones
+// to a multiple of the granule. Those close below a multiple of huge pages
+// are rounded up to it, so they can be backed by them.
+size_t FrameBufferArena::SizeClass( size_t size )
+{
+	if (size > SIZE_CLASS_GRANULE)
+	{
+		size_t huge = (size+HUGE_PAGE_SIZE-1)/HUGE_PAGE_SIZE*HUGE_PAGE_SIZE;
+		if ((huge-size)*HUGE_PAGE_WASTE <= size)
+		{
+			return huge;
+		}
+		return (size+SIZE_CLASS_GRANULE-1)/SIZE_CLASS_GRANULE*SIZE_CLASS_GRANULE;
+	}
+
+	size_t c = SMALL_PAGE_SIZE;
+	while (c < size)
+	{
+		c *= 2;
+	}
+	return c;
+}
+
+int FrameBufferArena::CurrentNode()
+{
+#if defined(Q_WS_WIN)
+	UCHAR node = 0;
+	if (GetNumaProcessorNode((UCHAR)GetCurrentProcessorNumber(), &node) && node != 0xFF)
+	{
+		return node;
+	}
+#elif defined(SYS_getcpu)
+	unsigned int cpu = 0, node = 0;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+	{
+		return (int)node;
+	}
+#endif
+	return 0;
+}
+
+unsigned char* FrameBufferArena::SystemAlloc( size_t size )
+{
+	void* data = NULL;
+#if defined(Q_WS_WIN)
+	SIZE_T largePage = GetLargePageMinimum();
+	if (largePage > 0 && size % largePage == 0)
+	{
+		// Needs "Lock pages in memory" privilege, falls back otherwise
+		data = VirtualAlloc(NULL, size, MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES, PAGE_READWRITE);
+	}
+	if (!data)
+	{
+		data = VirtualAlloc(NULL, size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+	}
+#else
+#	if defined(MAP_HUGETLB)
+	if (size % HUGE_PAGE_SIZE == 0)
+	{
+		// Only works if huge pages are reserved by the system
+		data = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+		if (data == MAP_FAILED)
+		{
+			data = NULL;
+		}
+	}
+#	endif
+	if (!data)
+	{
+		data = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if (data == MAP_FAILED)
+		{
+			return NULL;
+		}
+#	if defined(MADV_HUGEPAGE)
+		if (size % HUGE_PAGE_SIZE == 0)
+		{
+			// Ask for transparent huge pages instead
+			madvise(data, size, MADV_HUGEPAGE);
+		}
+#	endif
+	}
+#endif
+	return (unsigned char*)data;
+}
+
+void FrameBufferArena::SystemFree( unsigned char* data, size_t size )
+{
+#if defined(Q_WS_WIN)
+	VirtualFree(data, 0, MEM_RELEASE);
+#else
+	munmap(data, size);
+#endif
+}
+
+unsigned char* FrameBufferArena::Allocate( size_t& size )
+{
+	size = SizeClass(size);
+	int node = CurrentNode();
+
+	{
+		QMutexLocker locker(&m_Mutex);
+		QMap<FreeListKey, QList<unsigned char*> >::iterator it = m_FreeLists.find(FreeListKey(node, size));
+		if (it != m_FreeLists.end() && it.value().size())
+		{
+			m_FreeSize -= size;
+			// Most recently released buffer is most likely still in cache
+			return it.value().takeLast();
+		}
+	}
+
+	unsigned char* data = SystemAlloc(size);
+	if (!data)
+	{
+		// Free buffers of other sizes and try again
+		Trim();
+		data = SystemAlloc(size);
+	}
+
+	if (!data)
+	{
+		WARNING_LOG("Failed to allocate frame buffer of %d bytes", (int)size);
+		size = 0;
+		return NULL;
+	}
+
+	QMutexLocker locker(&m_Mutex);
+	m_Nodes.insert(data, node);
+	return data;
+}
+
+void FrameBufferArena::Release( unsigned char* data, size_t size )
+{
+	if (!data)
+	{
+		return;
+	}
+
+	{
+		// Back to the node it was allocated on, not the one of this thread
+		QMutexLocker locker(&m_Mutex);
+		if (m_FreeSize+size <= MAX_FREE_SIZE)
+		{
+			m_FreeLists[FreeListKey(m_Nodes.value(data), size)].append(data);
+			m_FreeSize += size;
+			return;
+		}
+		m_Nodes.remove(data);
+	}
+
+	SystemFree(data, size);
+}
+
+void FrameBufferArena::Trim()
+{
+	QMap<FreeListKey, QList<unsigned char*> > freeLists;
+	{
+		QMutexLocker locker(&m_Mutex);
+		freeLists = m_FreeLists;
+		m_FreeLists.clear();
+		m_FreeSize = 0;
+
+		QMap<FreeListKey, QList<unsigned char*> >::const_iterator it = freeLists.constBegin();
+		for (; it != freeLists.constEnd(); ++it)
+		{
+			for (int i=0; i<it.value().size(); i++)
+			{
+				m_Nodes.remove(it.value().at(i));
+			}
+		}
+	}
+
+	QMap<FreeListKey, QList<unsigned char*> >::const_iterator it = freeLists.constBegin();
+	for (; it != freeLists.constEnd(); ++it)
+	{
+		for (int i=0; i<it.value().size(); i++)
+		{
+			SystemFree(it.value().at(i), it.key().second);
+		}
+	}
+}
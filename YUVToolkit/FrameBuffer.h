@@ -0,0 +1,53 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <QtCore>
+
+// Alignment of planes inside frame buffers, enough for AVX-512 loads
+#define FRAME_BUFFER_ALIGNMENT	64
+
+// Arena of frame buffers shared by all FramePools. Buffers are rounded up
+// to size classes and kept on a free list of their class when released, so
+// frames of the same resolution reuse them instead of going back to the
+// system. Large buffers that fill most of a multiple of 2 MB are allocated
+// from huge pages when the system allows it, which saves TLB misses on 4K
+// and 8K frames.
+//
+// Memory is never touched here, so with the default first-touch policy the
+// pages are placed on the NUMA node of the thread that first fills the
+// frame, which is the thread that allocated it. Free buffers are kept per
+// node they were allocated on, and only handed to threads running there.
+class FrameBufferArena
+{
+public:
+	static FrameBufferArena* Instance();
+
+	// Returns buffer of at least size bytes, size is updated to the
+	// size of its class
+	unsigned char* Allocate(size_t& size);
+	// Size has to be the one returned by Allocate
+	void Release(unsigned char* data, size_t size);
+
+	// Return all free buffers to the system
+	void Trim();
+
+private:
+	FrameBufferArena();
+	~FrameBufferArena();
+
+	static size_t SizeClass(size_t size);
+	// NUMA node of the processor calling thread runs on, 0 if not known
+	static int CurrentNode();
+	static unsigned char* SystemAlloc(size_t size);
+	static void SystemFree(unsigned char* data, size_t size);
+
+	// Node and size class
+	typedef QPair<int, size_t> FreeListKey;
+
+	QMutex m_Mutex;
+	QMap<FreeListKey, QList<unsigned char*> > m_FreeLists;
+	QHash<unsigned char*, int> m_Nodes; // node of each buffer allocated from system
+	size_t m_FreeSize;
+};
+
+#endif
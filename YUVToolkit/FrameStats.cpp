@@ -0,0 +1,518 @@
+#include "FrameStats.h"
+#include "FastMath.h"
+#include "RowSSE.h"
+#include "ParallelFor.h"
+#include <math.h>
+#include <string.h>
+
+// Sums of one row segment, and SSE against ref if it is given, the same
+// way RowSSE(..) sums it. Squares of pixels are summed in 32 bit lanes too.
+static void RowStats(const unsigned char* p, const unsigned char* ref, int width, PlaneStats& s)
+{
+	int j = 0;
+	int minValue = s.min;
+	int maxValue = s.max;
+	quint64 sum = 0, sumSquares = 0, sse = 0;
+#ifdef YT_SSE2
+	if (width >= 16)
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128i vmin = _mm_set1_epi8((char)0xFF);
+		__m128i vmax = zero;
+		__m128i vsum = zero;
+		__m128i vsq = zero;
+		__m128i vsse = zero;
+		for (; j+16<=width; j+=16)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(p+j));
+			vmin = _mm_min_epu8(vmin, a);
+			vmax = _mm_max_epu8(vmax, a);
+			vsum = _mm_add_epi64(vsum, _mm_sad_epu8(a, zero));
+
+			__m128i lo = _mm_unpacklo_epi8(a, zero);
+			__m128i hi = _mm_unpackhi_epi8(a, zero);
+			vsq = _mm_add_epi32(vsq, _mm_madd_epi16(lo, lo));
+			vsq = _mm_add_epi32(vsq, _mm_madd_epi16(hi, hi));
+
+			if (ref)
+			{
+				vsse = SSE16(vsse, a, _mm_loadu_si128((const __m128i*)(ref+j)));
+			}
+		}
+
+		unsigned char bytes[16];
+		_mm_storeu_si128((__m128i*)bytes, vmin);
+		for (int i=0; i<16; i++)
+		{
+			minValue = qMin(minValue, (int)bytes[i]);
+		}
+		_mm_storeu_si128((__m128i*)bytes, vmax);
+		for (int i=0; i<16; i++)
+		{
+			maxValue = qMax(maxValue, (int)bytes[i]);
+		}
+
+		quint64 sums[2];
+		_mm_storeu_si128((__m128i*)sums, vsum);
+		sum = sums[0] + sums[1];
+
+		sumSquares = SumLanes32(vsq);
+		sse = SumLanes32(vsse);
+	}
+#endif
+	for (; j<width; j++)
+	{
+		int v = p[j];
+		minValue = qMin(minValue, v);
+		maxValue = qMax(maxValue, v);
+		sum += v;
+		sumSquares += v*v;
+		if (ref)
+		{
+			int diff = v-((int)ref[j]);
+			sse += diff*diff;
+		}
+	}
+
+	s.min = minValue;
+	s.max = maxValue;
+	s.count += width;
+	s.sum += sum;
+	s.sumSquares += sumSquares;
+	s.sse += sse;
+}
+
+// Counts into four histograms in turn, so runs of equal pixels do not wait
+// on the same counter. Bins do not vectorize, min, max and sums are taken
+// from the bins afterwards instead.
+static void HistogramRow(const unsigned char* p, int width, quint32 (*histograms)[256])
+{
+	int j = 0;
+	for (; j+4<=width; j+=4)
+	{
+		histograms[0][p[j]]++;
+		histograms[1][p[j+1]]++;
+		histograms[2][p[j+2]]++;
+		histograms[3][p[j+3]]++;
+	}
+	for (; j<width; j++)
+	{
+		histograms[0][p[j]]++;
+	}
+}
+
+double PlaneStats::Mean() const
+{
+	return count?((double)sum)/count:0;
+}
+
+double PlaneStats::Variance() const
+{
+	if (!count)
+	{
+		return 0;
+	}
+
+	double mean = Mean();
+	return qMax(((double)sumSquares)/count - mean*mean, 0.0);
+}
+
+void PlaneStats::FromHistogram()
+{
+	count = 0;
+	min = 255;
+	max = 0;
+	sum = sumSquares = 0;
+	for (int v=0; v<256; v++)
+	{
+		quint64 n = histogram[v];
+		if (n)
+		{
+			count += (int)n;
+			min = qMin(min, v);
+			max = qMax(max, v);
+			sum += n*v;
+			sumSquares += n*v*v;
+		}
+	}
+}
+
+FrameStats::FrameStats() : planes(0), hasHistogram(false), frameNumber(0), pts(INVALID_PTS), hasSSE(false), refViewId(0), refFrameNumber(0), refPTS(INVALID_PTS)
+{
+	Reset(0);
+}
+
+void FrameStats::Reset( int planeCount, bool histogram )
+{
+	planes = planeCount;
+	hasHistogram = histogram;
+	for (int i=0; i<3; i++)
+	{
+		PlaneStats& s = plane[i];
+		s.count = 0;
+		s.min = 255;
+		s.max = 0;
+		s.sum = s.sumSquares = s.sse = 0;
+		if (histogram)
+		{
+			memset(s.histogram, 0, sizeof(s.histogram));
+		}
+	}
+}
+
+void FrameStats::Add( const FrameStats& stats )
+{
+	for (int i=0; i<planes; i++)
+	{
+		PlaneStats& s = plane[i];
+		const PlaneStats& s2 = stats.plane[i];
+		s.count += s2.count;
+		s.min = qMin(s.min, s2.min);
+		s.max = qMax(s.max, s2.max);
+		s.sum += s2.sum;
+		s.sumSquares += s2.sumSquares;
+		s.sse += s2.sse;
+		if (hasHistogram)
+		{
+			for (int v=0; v<256; v++)
+			{
+				s.histogram[v] += s2.histogram[v];
+			}
+		}
+	}
+}
+
+void AccumulateFrameStats( const Frame& frame, const Frame* ref, int from, int to, FrameStats& stats )
+{
+	FormatPtr format = frame.Format();
+	int height = format->Height();
+	for (int p=0; p<stats.planes; p++)
+	{
+		int width = format->PlaneWidth(p);
+		int planeHeight = format->PlaneHeight(p);
+		int stride = format->Stride(p);
+		int refStride = ref?ref->Format()->Stride(p):0;
+
+		// Bands tile the plane exactly, whatever the subsampling
+		int rowFrom = from*planeHeight/height;
+		int rowTo = to*planeHeight/height;
+		PlaneStats& s = stats.plane[p];
+		if (stats.hasHistogram)
+		{
+			quint32 histograms[4][256];
+			memset(histograms, 0, sizeof(histograms));
+			for (int i=rowFrom; i<rowTo; i++)
+			{
+				HistogramRow(frame.Data(p)+i*stride, width, histograms);
+			}
+
+			for (int v=0; v<256; v++)
+			{
+				s.histogram[v] += histograms[0][v]+histograms[1][v]+histograms[2][v]+histograms[3][v];
+			}
+
+			if (!ref)
+			{
+				// Rest is taken from the histogram when the frame is done
+				continue;
+			}
+		}
+
+		for (int i=rowFrom; i<rowTo; i++)
+		{
+			RowStats(frame.Data(p)+i*stride, ref?ref->Data(p)+i*refStride:0, width, s);
+		}
+	}
+}
+
+static int PlaneCount(const Frame& frame)
+{
+	return (frame.Format()->Color() == Y800)?1:3;
+}
+
+// Reference has to match in color and size, otherwise only the frame itself
+// is measured
+static const Frame* MatchingReference(const Frame& frame, const Frame* ref)
+{
+	if (!ref)
+	{
+		return 0;
+	}
+
+	FormatPtr format = frame.Format();
+	FormatPtr refFormat = ref->Format();
+	if (format->Color() != refFormat->Color() || format->Width() != refFormat->Width() ||
+		format->Height() != refFormat->Height())
+	{
+		return 0;
+	}
+
+	return ref;
+}
+
+static void SetReference(const Frame* ref, FrameStats& stats)
+{
+	stats.hasSSE = (ref != 0);
+	if (ref)
+	{
+		stats.refViewId = ref->Info(VIEW_ID).toUInt();
+		stats.refFrameNumber = ref->FrameNumber();
+		stats.refPTS = ref->PTS();
+	}
+}
+
+// Each band sums into its own FrameStats, added up in order afterwards
+struct FrameStatsBands
+{
+	const Frame* frame;
+	const Frame* ref;
+	int height;
+	QVector<FrameStats> bands;
+
+	void operator()(int from, int to)
+	{
+		for (int i=from; i<to; i++)
+		{
+			int rowFrom = i*FRAME_STATS_BAND_ROWS;
+			AccumulateFrameStats(*frame, ref, rowFrom, qMin(rowFrom+FRAME_STATS_BAND_ROWS, height), bands[i]);
+		}
+	}
+};
+
+void ComputeFrameStats( const Frame& frame, const Frame* ref, FrameStats& stats, bool histogram )
+{
+	ref = MatchingReference(frame, ref);
+	stats.Reset(PlaneCount(frame), histogram);
+	SetReference(ref, stats);
+
+	FrameStatsBands job;
+	job.frame = &frame;
+	job.ref = ref;
+	job.height = frame.Format()->Height();
+
+	int bandCount = (job.height+FRAME_STATS_BAND_ROWS-1)/FRAME_STATS_BAND_ROWS;
+	job.bands.resize(bandCount);
+	for (int i=0; i<bandCount; i++)
+	{
+		job.bands[i].Reset(stats.planes, histogram);
+	}
+	ParallelFor(bandCount, 4, job);
+
+	for (int i=0; i<bandCount; i++)
+	{
+		stats.Add(job.bands.at(i));
+	}
+
+	if (histogram)
+	{
+		for (int i=0; i<stats.planes; i++)
+		{
+			stats.plane[i].FromHistogram();
+		}
+	}
+}
+
+FrameStatsPtr GetFrameHistogram( FramePtr frame )
+{
+	FrameStatsPtr cached = frame->Info(FRAME_STATS).value<FrameStatsPtr>();
+	if (cached && cached->hasHistogram && cached->frameNumber == frame->FrameNumber() &&
+		cached->pts == frame->PTS())
+	{
+		return cached;
+	}
+
+	FrameStatsPtr stats(new FrameStats);
+	ComputeFrameStats(*frame, NULL, *stats, true);
+	stats->frameNumber = frame->FrameNumber();
+	stats->pts = frame->PTS();
+	if (cached && cached->hasSSE && cached->planes == stats->planes)
+	{
+		stats->hasSSE = true;
+		stats->refViewId = cached->refViewId;
+		stats->refFrameNumber = cached->refFrameNumber;
+		stats->refPTS = cached->refPTS;
+		for (int i=0; i<stats->planes; i++)
+		{
+			stats->plane[i].sse = cached->plane[i].sse;
+		}
+	}
+
+	frame->SetInfo(FRAME_STATS, qVariantFromValue(stats));
+	return stats;
+}
+
+void FrameStatsSink::RowsConverted( const Frame& out, int from, int to )
+{
+	if (from == 0)
+	{
+		m_Ref = MatchingReference(out, m_Ref);
+		m_Stats->Reset(PlaneCount(out));
+		SetReference(m_Ref, *m_Stats);
+	}
+
+	AccumulateFrameStats(out, m_Ref, from, to, *m_Stats);
+}
+
+bool FusedMeasureResults( const Frame& ref, unsigned int refViewId, const Frame& frame,
+	const QList<MeasureOperation*>& ops )
+{
+	FrameStatsPtr stats = frame.Info(FRAME_STATS).value<FrameStatsPtr>();
+	if (!stats || !stats->hasSSE || stats->refViewId != refViewId ||
+		stats->refFrameNumber != ref.FrameNumber() || stats->refPTS != ref.PTS())
+	{
+		return false;
+	}
+
+	MeasureOperation* opMse = 0;
+	MeasureOperation* opPsnr = 0;
+	for (int i=0; i<ops.size(); i++)
+	{
+		MeasureOperation* op = ops.at(i);
+		if (op->distMap)
+		{
+			return false;
+		}
+
+		if (op->measureName == "MSE")
+		{
+			opMse = op;
+		}else if (op->measureName == "PSNR")
+		{
+			opPsnr = op;
+		}else
+		{
+			return false;
+		}
+	}
+
+	// Planes weighted by their share of samples, like YT_MeasuresBasic
+	FormatPtr format = frame.Format();
+	double mse[PLANE_COUNT] = {0};
+	int weightSum = 0;
+	for (int i=0; i<stats->planes; i++)
+	{
+		const PlaneStats& s = stats->plane[i];
+		if (s.count == 0)
+		{
+			return false;
+		}
+
+		int weightPlane = format->Width()*format->Height()*4/s.count;
+		mse[i] = ((double)s.sse)/s.count;
+		mse[PLANE_COLOR] += weightPlane*mse[i];
+		weightSum += weightPlane;
+	}
+	mse[PLANE_COLOR] /= weightSum;
+
+	for (int i=0; i<PLANE_COUNT; i++)
+	{
+		bool has = (i == PLANE_COLOR || i < stats->planes);
+		if (opMse)
+		{
+			opMse->results[i] = mse[i];
+			opMse->hasResults[i] = has;
+		}
+		if (opPsnr)
+		{
+			double mse_min = qMax<double>(mse[i], 0.001);
+			opPsnr->results[i] = 20.0*log10(255.0) - 10.0*log10(mse_min);
+			opPsnr->hasResults[i] = has;
+		}
+	}
+
+	return true;
+}
+
+FusedMeasure::FusedMeasure() : m_Enabled(false)
+{
+}
+
+void FusedMeasure::SetEnabled( bool enabled )
+{
+	m_Enabled = enabled;
+}
+
+bool FusedMeasure::IsEnabled()
+{
+	return m_Enabled;
+}
+
+void FusedMeasure::SetReferences( const QMap<unsigned int, unsigned int>& references )
+{
+	QMutexLocker locker(&m_Mutex);
+	m_References = references;
+	m_ReferenceIds = m_References.values().toSet();
+
+	// Forget frames of views that are no longer references
+	QMutableMapIterator<unsigned int, QList<QWeakPointer<Frame> > > it(m_Frames);
+	while (it.hasNext())
+	{
+		it.next();
+		if (!m_ReferenceIds.contains(it.key()))
+		{
+			it.remove();
+		}
+	}
+}
+
+void FusedMeasure::AddFrame( unsigned int viewId, FramePtr frame )
+{
+	QMutexLocker locker(&m_Mutex);
+	if (!m_Enabled || !m_ReferenceIds.contains(viewId))
+	{
+		return;
+	}
+
+	QList<QWeakPointer<Frame> >& frames = m_Frames[viewId];
+	frames.append(frame.toWeakRef());
+	while (frames.size() > FUSED_MEASURE_FRAMES)
+	{
+		frames.removeFirst();
+	}
+}
+
+FramePtr FusedMeasure::FindReferenceFrame( unsigned int viewId, unsigned int pts, unsigned int& refViewId )
+{
+	QMutexLocker locker(&m_Mutex);
+	if (!m_Enabled || !m_References.contains(viewId))
+	{
+		return FramePtr();
+	}
+
+	refViewId = m_References.value(viewId);
+	const QList<QWeakPointer<Frame> >& frames = m_Frames[refViewId];
+	for (int i=frames.size()-1; i>=0; i--)
+	{
+		// Frame that went back to its pool can not be taken any more
+		FramePtr frame = frames.at(i).toStrongRef();
+		if (!frame)
+		{
+			continue;
+		}
+
+		unsigned int nextPTS = frame->HasInfo(NEXT_PTS)?frame->Info(NEXT_PTS).toUInt():frame->PTS()+1;
+		if (frame->PTS() <= pts && pts < nextPTS)
+		{
+			return frame;
+		}
+	}
+
+	return FramePtr();
+}
+
+void FusedMeasure::RemoveView( unsigned int viewId )
+{
+	QMutexLocker locker(&m_Mutex);
+	m_Frames.remove(viewId);
+
+	QMutableMapIterator<unsigned int, unsigned int> it(m_References);
+	while (it.hasNext())
+	{
+		it.next();
+		if (it.key() == viewId || it.value() == viewId)
+		{
+			it.remove();
+		}
+	}
+	m_ReferenceIds = m_References.values().toSet();
+}
@@ -0,0 +1,118 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include "YT_Interface.h"
+#include "ColorConversion.h"
+#include <QtCore>
+
+// Luma rows per band of the fused pass, even so chroma rows of 4:2:0 are
+// not split between bands
+#define FRAME_STATS_BAND_ROWS 32
+// Recent frames of each reference video that can be found by FusedMeasure
+#define FUSED_MEASURE_FRAMES 8
+
+// Sums of one plane, and of its squared difference to the same plane of
+// a reference frame
+struct PlaneStats
+{
+	int count;
+	int min;
+	int max;
+	quint64 sum;
+	quint64 sumSquares;
+	quint64 sse;
+	quint32 histogram[256]; // only if FrameStats::hasHistogram
+
+	double Mean() const;
+	double Variance() const;
+	// Count, min, max and sums from the histogram
+	void FromHistogram();
+};
+
+// Statistics of a frame computed by its source thread while the frame is
+// converted, each band while it is still in cache, so later stages do not
+// need to read the frame again for them. Attached to the frame as FRAME_STATS.
+struct FrameStats
+{
+	int planes;
+	PlaneStats plane[3];
+	bool hasHistogram;
+	// Frame the histograms were computed for, pooled frames are reused
+	unsigned int frameNumber;
+	unsigned int pts;
+
+	// Reference frame that sse was computed against
+	bool hasSSE;
+	unsigned int refViewId;
+	unsigned int refFrameNumber;
+	unsigned int refPTS;
+
+	FrameStats();
+	void Reset(int planeCount, bool histogram=false);
+	void Add(const FrameStats& stats);
+};
+
+typedef QSharedPointer<FrameStats> FrameStatsPtr;
+Q_DECLARE_METATYPE(FrameStatsPtr)
+
+// Adds luma rows [from, to) of frame to stats, and the squared difference to
+// ref if it is given. Chroma rows are those of the same part of the frame.
+void AccumulateFrameStats(const Frame& frame, const Frame* ref, int from, int to, FrameStats& stats);
+
+// Whole frame in bands on the worker threads, when histograms are wanted
+void ComputeFrameStats(const Frame& frame, const Frame* ref, FrameStats& stats, bool histogram=false);
+
+// Statistics with histograms cached on frame as FRAME_STATS, computed first if
+// frame has none yet. SSE computed while reading the frame is kept.
+FrameStatsPtr GetFrameHistogram(FramePtr frame);
+
+// Collects statistics of each band while ColorConversion(..) writes it
+class FrameStatsSink : public ConversionSink
+{
+public:
+	FrameStatsSink(FrameStats* stats, const Frame* ref) : m_Stats(stats), m_Ref(ref) {}
+	virtual void RowsConverted(const Frame& out, int from, int to);
+private:
+	FrameStats* m_Stats;
+	const Frame* m_Ref;
+};
+
+// Fills MSE and PSNR operations from the fused SSE of frame against ref,
+// the same way the basic measures compute them. Returns false if frame was
+// not compared with this ref frame, or some operation needs more than the sums.
+bool FusedMeasureResults(const Frame& ref, unsigned int refViewId, const Frame& frame,
+	const QList<MeasureOperation*>& ops);
+
+// Pairs each processed video with the reference it is measured against, and
+// keeps weak references to recent frames of reference videos. Source thread of
+// a processed video looks up the reference frame of same time and computes SSE
+// fused with converting its own frame. Frames are not kept alive by it, they go
+// back to their pool as usual. Thread safe.
+class FusedMeasure
+{
+public:
+	FusedMeasure();
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled();
+
+	// Processed view -> reference view
+	void SetReferences(const QMap<unsigned int, unsigned int>& references);
+
+	// Remembers frame just read if view is a reference of some view
+	void AddFrame(unsigned int viewId, FramePtr frame);
+	// Reference frame shown together with frame of viewId at pts, NULL if
+	// reference frame is not read yet or no longer used
+	FramePtr FindReferenceFrame(unsigned int viewId, unsigned int pts, unsigned int& refViewId);
+	// Forgets frames of closed view and pairs it is part of
+	void RemoveView(unsigned int viewId);
+
+private:
+	QMutex m_Mutex;
+	volatile bool m_Enabled;
+	QMap<unsigned int, unsigned int> m_References;
+	QSet<unsigned int> m_ReferenceIds; // values of m_References, checked per frame
+	QMap<unsigned int, QList<QWeakPointer<Frame> > > m_Frames;
+};
+
+#endif
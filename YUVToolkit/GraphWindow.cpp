@@ -0,0 +1,244 @@
+#include "YT_Interface.h"
+
+#include "GraphWindow.h"
+#include "VideoView.h"
+#include "VideoViewList.h"
+
+#include <qwt_plot.h>
+#include <qwt_plot_curve.h>
+#include <qwt_plot_intervalcurve.h>
+#include <qwt_plot_grid.h>
+#include <qwt_plot_picker.h>
+#include <qwt_picker_machine.h>
+#include <qwt_legend.h>
+
+static const QColor s_CurveColors[] = {
+	QColor(0, 0, 192),
+	QColor(192, 0, 0),
+	QColor(0, 128, 0),
+	QColor(192, 128, 0),
+	QColor(128, 0, 128),
+	QColor(0, 128, 128),
+};
+
+GraphWindow::GraphWindow(VideoViewList* vvList, QWidget *parent, Qt::WFlags flags) :
+	QMainWindow(parent, flags), m_VideoViewList(vvList), m_ToolBar(new QToolBar(this)),
+	m_MeasureCombo(new QComboBox(this)), m_PlaneCombo(new QComboBox(this)),
+	m_Plot(new QwtPlot(this)), m_UpdateTimer(NULL), m_LastRevision(0), m_LastBins(0)
+{
+	m_ToolBar->setMovable(false);
+	m_ToolBar->setAllowedAreas(Qt::TopToolBarArea);
+	m_ToolBar->setIconSize(QSize(22, 22));
+	m_ToolBar->setFloatable(false);
+	addToolBar(Qt::TopToolBarArea, m_ToolBar);
+
+	m_PlaneCombo->addItem("Y");
+	m_PlaneCombo->addItem("U");
+	m_PlaneCombo->addItem("V");
+	m_PlaneCombo->addItem("Color");
+	m_PlaneCombo->setCurrentIndex(PLANE_COLOR);
+
+	m_ToolBar->addWidget(m_MeasureCombo);
+	m_ToolBar->addWidget(m_PlaneCombo);
+	connect(m_MeasureCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(OnSelectionChanged(int)));
+	connect(m_PlaneCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(OnSelectionChanged(int)));
+
+	m_Plot->setCanvasBackground(Qt::white);
+	m_Plot->setAxisTitle(QwtPlot::xBottom, "Frame");
+	m_Plot->insertLegend(new QwtLegend(), QwtPlot::BottomLegend);
+
+	QwtPlotGrid* grid = new QwtPlotGrid();
+#if QWT_VERSION >= 0x060100
+	grid->setMajorPen(QPen(Qt::lightGray, 0, Qt::DotLine));
+#else
+	grid->setMajPen(QPen(Qt::lightGray, 0, Qt::DotLine));
+#endif
+	grid->attach(m_Plot);
+
+	// Click on plot to seek to that frame
+	m_Picker = new QwtPlotPicker(QwtPlot::xBottom, QwtPlot::yLeft,
+		QwtPicker::VLineRubberBand, QwtPicker::ActiveOnly, m_Plot->canvas());
+	m_Picker->setStateMachine(new QwtPickerClickPointMachine());
+	connect(m_Picker, SIGNAL(selected(const QPointF&)), this, SLOT(OnPointSelected(const QPointF&)));
+
+	setWindowFlags(Qt::Widget);
+	setCentralWidget(m_Plot);
+}
+
+GraphWindow::~GraphWindow()
+{
+}
+
+QSize GraphWindow::sizeHint() const
+{
+	return QSize(400, 200);
+}
+
+void GraphWindow::showEvent( QShowEvent *event )
+{
+	m_LastRevision = 0;
+
+	m_UpdateTimer = new QTimer(this);
+	m_UpdateTimer->setInterval(200);
+	connect(m_UpdateTimer, SIGNAL(timeout()), this, SLOT(OnTimer()));
+	m_UpdateTimer->start();
+
+	OnTimer();
+}
+
+void GraphWindow::hideEvent( QHideEvent *event )
+{
+	if (m_UpdateTimer)
+	{
+		m_UpdateTimer->stop();
+		SAFE_DELETE(m_UpdateTimer);
+	}
+}
+
+void GraphWindow::OnTimer()
+{
+	MeasureHistory* history = m_VideoViewList->GetProcessThread()->GetMeasureHistory();
+
+	// Only redraw when there are new results, or plot size has changed
+	unsigned int revision = history->GetRevision();
+	int bins = qMax(m_Plot->canvas()->width(), 1);
+	if (revision == m_LastRevision && bins == m_LastBins)
+	{
+		return;
+	}
+	m_LastRevision = revision;
+	m_LastBins = bins;
+
+	QList<MeasureSeriesId> ids;
+	history->GetSeriesList(ids);
+	UpdateMeasureList(ids);
+
+	QString measureName = m_MeasureCombo->currentText();
+	m_SeriesIds.clear();
+	for (int i=0; i<ids.size(); i++)
+	{
+		if (ids.at(i).measureName == measureName)
+		{
+			m_SeriesIds.append(ids.at(i));
+		}
+	}
+
+	UpdatePlot();
+}
+
+void GraphWindow::UpdateMeasureList( const QList<MeasureSeriesId>& ids )
+{
+	QStringList names;
+	for (int i=0; i<ids.size(); i++)
+	{
+		if (!names.contains(ids.at(i).measureName))
+		{
+			names.append(ids.at(i).measureName);
+		}
+	}
+
+	QStringList current;
+	for (int i=0; i<m_MeasureCombo->count(); i++)
+	{
+		current.append(m_MeasureCombo->itemText(i));
+	}
+
+	if (names != current)
+	{
+		QString selected = m_MeasureCombo->currentText();
+		m_MeasureCombo->blockSignals(true);
+		m_MeasureCombo->clear();
+		m_MeasureCombo->addItems(names);
+		m_MeasureCombo->setCurrentIndex(qMax(names.indexOf(selected), 0));
+		m_MeasureCombo->blockSignals(false);
+	}
+}
+
+void GraphWindow::UpdatePlot()
+{
+	MeasureHistory* history = m_VideoViewList->GetProcessThread()->GetMeasureHistory();
+	int plane = m_PlaneCombo->currentIndex();
+
+	while (m_Curves.size() > m_SeriesIds.size())
+	{
+		delete m_Curves.takeLast();
+		delete m_Envelopes.takeLast();
+	}
+
+	QVector<double> frames, minValues, maxValues, meanValues;
+	for (int i=0; i<m_SeriesIds.size(); i++)
+	{
+		const MeasureSeriesId& id = m_SeriesIds.at(i);
+		QColor color = s_CurveColors[i%(sizeof(s_CurveColors)/sizeof(s_CurveColors[0]))];
+
+		if (i == m_Curves.size())
+		{
+			QwtPlotIntervalCurve* envelope = new QwtPlotIntervalCurve();
+			QColor fill = color;
+			fill.setAlpha(64);
+			envelope->setPen(QPen(fill));
+			envelope->setBrush(QBrush(fill));
+			envelope->setItemAttribute(QwtPlotItem::Legend, false);
+			envelope->attach(m_Plot);
+			m_Envelopes.append(envelope);
+
+			QwtPlotCurve* curve = new QwtPlotCurve();
+			curve->setPen(QPen(color));
+			curve->attach(m_Plot);
+			m_Curves.append(curve);
+		}
+
+		VideoView* vv1 = m_VideoViewList->find(id.sourceViewId1);
+		VideoView* vv2 = m_VideoViewList->find(id.sourceViewId2);
+		QString title;
+		QTextStream(&title) << (vv2?vv2->title():QString("%1").arg(id.sourceViewId2)) << " / "
+			<< (vv1?vv1->title():QString("%1").arg(id.sourceViewId1));
+		m_Curves.at(i)->setTitle(title);
+
+		history->Envelope(id, plane, m_LastBins, frames, minValues, maxValues, meanValues);
+
+		QVector<QwtIntervalSample> intervals(frames.size());
+		for (int j=0; j<frames.size(); j++)
+		{
+			intervals[j] = QwtIntervalSample(frames.at(j), minValues.at(j), maxValues.at(j));
+		}
+		m_Envelopes.at(i)->setSamples(intervals);
+		m_Curves.at(i)->setSamples(frames, meanValues);
+	}
+
+	m_Plot->setAxisTitle(QwtPlot::yLeft, m_MeasureCombo->currentText());
+	m_Plot->replot();
+}
+
+void GraphWindow::ClearCurves()
+{
+	qDeleteAll(m_Curves);
+	qDeleteAll(m_Envelopes);
+	m_Curves.clear();
+	m_Envelopes.clear();
+}
+
+void GraphWindow::OnSelectionChanged( int )
+{
+	ClearCurves();
+
+	// Force redraw on next timer
+	m_LastRevision = 0;
+	m_LastBins = 0;
+	OnTimer();
+}
+
+void GraphWindow::OnPointSelected( const QPointF& pos )
+{
+	if (m_SeriesIds.size() == 0)
+	{
+		return;
+	}
+
+	MeasureHistory* history = m_VideoViewList->GetProcessThread()->GetMeasureHistory();
+	unsigned int pts = history->FrameToPTS(m_SeriesIds.first(), qRound(pos.x()));
+	if (pts != INVALID_PTS)
+	{
+		m_VideoViewList->GetControl()->Seek(pts);
+	}
+}
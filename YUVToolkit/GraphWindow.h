@@ -0,0 +1,54 @@
+#ifndef GRAPH_WINDOW_H
+#define GRAPH_WINDOW_H
+
+#include "MeasureHistory.h"
+#include <QtGui>
+#include <QtCore>
+
+class VideoViewList;
+class QwtPlot;
+class QwtPlotCurve;
+class QwtPlotIntervalCurve;
+class QwtPlotPicker;
+
+// Plots per frame measure results of all compared pairs. Each curve is
+// decimated to one min/max/mean sample per pixel column, so redrawing
+// does not depend on length of the sequence.
+class GraphWindow : public QMainWindow
+{
+	Q_OBJECT;
+	VideoViewList* m_VideoViewList;
+
+	QToolBar* m_ToolBar;
+	QComboBox* m_MeasureCombo;
+	QComboBox* m_PlaneCombo;
+	QwtPlot* m_Plot;
+	QwtPlotPicker* m_Picker;
+	QTimer* m_UpdateTimer;
+
+	QList<MeasureSeriesId> m_SeriesIds;
+	QList<QwtPlotCurve*> m_Curves;
+	QList<QwtPlotIntervalCurve*> m_Envelopes;
+	unsigned int m_LastRevision;
+	int m_LastBins;
+public:
+	GraphWindow(VideoViewList* vvList, QWidget *parent = 0, Qt::WFlags flags = 0);
+	~GraphWindow();
+
+	QToolBar* GetToolBar() {return m_ToolBar;}
+
+	QSize sizeHint() const;
+protected:
+	void showEvent(QShowEvent *event);
+	void hideEvent(QHideEvent *event);
+
+	void UpdateMeasureList(const QList<MeasureSeriesId>& ids);
+	void UpdatePlot();
+	void ClearCurves();
+private slots:
+	void OnTimer();
+	void OnSelectionChanged(int);
+	void OnPointSelected(const QPointF&);
+};
+
+#endif
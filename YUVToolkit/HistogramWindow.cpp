@@ -0,0 +1,162 @@
+#include "YT_Interface.h"
+
+#include "HistogramWindow.h"
+#include "VideoView.h"
+#include "VideoViewList.h"
+
+#include <qwt_plot.h>
+#include <qwt_plot_curve.h>
+#include <qwt_plot_grid.h>
+#include <qwt_legend.h>
+
+static const QColor s_CurveColors[] = {
+	QColor(0, 0, 192),
+	QColor(192, 0, 0),
+	QColor(0, 128, 0),
+	QColor(192, 128, 0),
+	QColor(128, 0, 128),
+	QColor(0, 128, 128),
+};
+
+HistogramWindow::HistogramWindow(VideoViewList* vvList, QWidget *parent, Qt::WFlags flags) :
+	QMainWindow(parent, flags), m_VideoViewList(vvList), m_ToolBar(new QToolBar(this)),
+	m_PlaneCombo(new QComboBox(this)), m_Plot(new QwtPlot(this)), m_UpdateTimer(NULL)
+{
+	m_ToolBar->setMovable(false);
+	m_ToolBar->setAllowedAreas(Qt::TopToolBarArea);
+	m_ToolBar->setIconSize(QSize(22, 22));
+	m_ToolBar->setFloatable(false);
+	addToolBar(Qt::TopToolBarArea, m_ToolBar);
+
+	m_PlaneCombo->addItem("Y");
+	m_PlaneCombo->addItem("U");
+	m_PlaneCombo->addItem("V");
+	m_ToolBar->addWidget(m_PlaneCombo);
+	connect(m_PlaneCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(OnSelectionChanged(int)));
+
+	m_Plot->setCanvasBackground(Qt::white);
+	m_Plot->setAxisTitle(QwtPlot::xBottom, "Value");
+	m_Plot->setAxisTitle(QwtPlot::yLeft, "Pixels");
+	m_Plot->setAxisScale(QwtPlot::xBottom, 0, 256);
+	m_Plot->insertLegend(new QwtLegend(), QwtPlot::BottomLegend);
+
+	QwtPlotGrid* grid = new QwtPlotGrid();
+#if QWT_VERSION >= 0x060100
+	grid->setMajorPen(QPen(Qt::lightGray, 0, Qt::DotLine));
+#else
+	grid->setMajPen(QPen(Qt::lightGray, 0, Qt::DotLine));
+#endif
+	grid->attach(m_Plot);
+
+	setWindowFlags(Qt::Widget);
+	setCentralWidget(m_Plot);
+}
+
+HistogramWindow::~HistogramWindow()
+{
+}
+
+QSize HistogramWindow::sizeHint() const
+{
+	return QSize(300, 200);
+}
+
+void HistogramWindow::showEvent( QShowEvent *event )
+{
+	m_LastStats.clear();
+	m_VideoViewList->SetStatisticsEnabled(STATISTICS_HISTOGRAM_WINDOW, true);
+
+	m_UpdateTimer = new QTimer(this);
+	m_UpdateTimer->setInterval(100);
+	connect(m_UpdateTimer, SIGNAL(timeout()), this, SLOT(OnTimer()));
+	m_UpdateTimer->start();
+
+	OnTimer();
+}
+
+void HistogramWindow::hideEvent( QHideEvent *event )
+{
+	if (m_UpdateTimer)
+	{
+		m_UpdateTimer->stop();
+		SAFE_DELETE(m_UpdateTimer);
+	}
+
+	m_VideoViewList->SetStatisticsEnabled(STATISTICS_HISTOGRAM_WINDOW, false);
+}
+
+void HistogramWindow::OnTimer()
+{
+	// Each computed frame gets a new statistics object, so comparing them
+	// tells if any view shows another frame
+	QList<FrameStatsPtr> stats;
+	for (int i=0; i<m_VideoViewList->size(); i++)
+	{
+		FramePtr frame = VV_LASTFRAME(m_VideoViewList->at(i));
+		stats.append(frame?frame->Info(FRAME_STATS).value<FrameStatsPtr>():FrameStatsPtr());
+	}
+
+	if (stats != m_LastStats)
+	{
+		m_LastStats = stats;
+		UpdatePlot();
+	}
+}
+
+void HistogramWindow::UpdatePlot()
+{
+	int plane = m_PlaneCombo->currentIndex();
+
+	while (m_Curves.size() > m_LastStats.size())
+	{
+		delete m_Curves.takeLast();
+	}
+
+	QVector<double> values(256), counts(256);
+	for (int v=0; v<256; v++)
+	{
+		values[v] = v;
+	}
+
+	for (int i=0; i<m_LastStats.size(); i++)
+	{
+		if (i == m_Curves.size())
+		{
+			QwtPlotCurve* curve = new QwtPlotCurve();
+			curve->setPen(QPen(s_CurveColors[i%(sizeof(s_CurveColors)/sizeof(s_CurveColors[0]))]));
+			curve->setStyle(QwtPlotCurve::Steps);
+			curve->attach(m_Plot);
+			m_Curves.append(curve);
+		}
+
+		FrameStatsPtr stats = m_LastStats.at(i);
+		VideoView* vv = m_VideoViewList->at(i);
+		QwtPlotCurve* curve = m_Curves.at(i);
+		if (!stats || !stats->hasHistogram || plane >= stats->planes)
+		{
+			curve->setTitle(vv->title());
+			curve->setSamples(QVector<double>(), QVector<double>());
+			continue;
+		}
+
+		const PlaneStats& s = stats->plane[plane];
+		for (int v=0; v<256; v++)
+		{
+			counts[v] = s.histogram[v];
+		}
+		curve->setSamples(values, counts);
+
+		QString title;
+		QTextStream(&title) << vv->title() << "  min " << s.min << "  max " << s.max
+			<< "  mean " << QString::number(s.Mean(), 'f', 2)
+			<< "  variance " << QString::number(s.Variance(), 'f', 2);
+		curve->setTitle(title);
+	}
+
+	m_Plot->replot();
+}
+
+void HistogramWindow::OnSelectionChanged( int )
+{
+	UpdatePlot();
+}
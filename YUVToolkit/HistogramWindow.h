@@ -0,0 +1,42 @@
+#ifndef HISTOGRAM_WINDOW_H
+#define HISTOGRAM_WINDOW_H
+
+#include "FrameStats.h"
+#include <QtGui>
+#include <QtCore>
+
+class VideoViewList;
+class QwtPlot;
+class QwtPlotCurve;
+
+// Histogram of one plane of the frame shown in each view, with its min, max,
+// mean and variance. Statistics are computed by the process thread while
+// this window is shown, this window only plots them.
+class HistogramWindow : public QMainWindow
+{
+	Q_OBJECT;
+	VideoViewList* m_VideoViewList;
+
+	QToolBar* m_ToolBar;
+	QComboBox* m_PlaneCombo;
+	QwtPlot* m_Plot;
+	QTimer* m_UpdateTimer;
+
+	QList<QwtPlotCurve*> m_Curves;
+	QList<FrameStatsPtr> m_LastStats; // plotted, to redraw only when changed
+public:
+	HistogramWindow(VideoViewList* vvList, QWidget *parent = 0, Qt::WFlags flags = 0);
+	~HistogramWindow();
+
+	QSize sizeHint() const;
+protected:
+	void showEvent(QShowEvent *event);
+	void hideEvent(QHideEvent *event);
+
+	void UpdatePlot();
+private slots:
+	void OnTimer();
+	void OnSelectionChanged(int);
+};
+
+#endif
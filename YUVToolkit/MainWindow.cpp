@@ -9,6 +9,9 @@
 #include "RenderThread.h"
 #include "VideoViewList.h"
 #include "MeasureWindow.h"
+#include "GraphWindow.h"
+#include "HistogramWindow.h"
+#include "PixelWindow.h"
 #include "ScoreWindow.h"
 #include "Options.h"
 #include "Settings.h"
@@ -40,7 +43,9 @@ MainWindow::MainWindow(QWidget *parent, Qt::WFlags flags) :
 	m_TimeLabel1(0), m_TimeLabel2(0), m_RenderSpeedLabel(0),
 	m_ZoomLabel(0), m_ActionsButton(0), m_CompareButton(0),
 	m_ColorGroup(0), m_ZoomGroup(0), m_MeasureWindow(0),
-	m_MeasureDockWidget(0), m_ZoomMode(0), m_LastSliderValue(0),
+	m_MeasureDockWidget(0), m_GraphWindow(0), m_GraphDockWidget(0),
+	m_HistogramWindow(0), m_HistogramDockWidget(0), m_PixelWindow(0), m_PixelDockWidget(0),
+	m_ZoomMode(0), m_LastSliderValue(0),
 	m_IsPlaying(false), m_UpdateTimer(0), m_AllowContextMenu(true), m_Engine(NULL), m_Debugger(NULL)
 {
 	windowCounter++;
@@ -200,9 +205,13 @@ MainWindow::MainWindow(QWidget *parent, Qt::WFlags flags) :
 	connect(m_VideoViewList, SIGNAL(VideoViewSourceListChanged()), m_MeasureWindow, SLOT(OnVideoViewSourceListChanged()));
 	connect(m_VideoViewList->GetProcessThread(), SIGNAL(lastFrameDisplayed()), this, SLOT(OnLastFrameDisplayed()));
 	connect(ui.action_Distortion_Map, SIGNAL(toggled(bool)), m_MeasureWindow, SLOT(OnShowDistortionMap(bool)));
+	connect(ui.action_Export_Measures, SIGNAL(triggered()), m_MeasureWindow, SLOT(OnExportResults()));
+	connect(ui.action_Measure_All_Frames, SIGNAL(toggled(bool)), m_MeasureWindow, SLOT(OnMeasureAllFrames(bool)));
 	
 	bool showDistMap = settings.SETTINGS_GET_SHOW_DIST_MAP();
 	ui.action_Distortion_Map->setChecked(showDistMap);
+	ui.action_Measure_All_Frames->setChecked(settings.SETTINGS_GET_MEASURE_ALL_FRAMES());
+	m_VideoViewList->GetProcessThread()->GetFusedMeasure()->SetEnabled(settings.SETTINGS_GET_FUSED_MEASURE());
 
 	m_MeasureWindow->GetToolBar()->addAction(ui.action_Enable_Measures);
 	m_MeasureWindow->GetToolBar()->addAction(ui.action_Distortion_Map);
@@ -210,7 +219,34 @@ MainWindow::MainWindow(QWidget *parent, Qt::WFlags flags) :
 	m_MeasureWindow->GetToolBar()->addAction(ui.action_Select_Original);
 	m_MeasureWindow->GetToolBar()->addAction(ui.action_Select_Processed_1);
 	m_MeasureWindow->GetToolBar()->addAction(ui.action_Select_Processed_2);
+	m_MeasureWindow->GetToolBar()->addSeparator();
+	m_MeasureWindow->GetToolBar()->addAction(ui.action_Measure_All_Frames);
+	m_MeasureWindow->GetToolBar()->addAction(ui.action_Export_Measures);
+
+
+	m_GraphDockWidget = new QDockWidget("Graph", this );
+	m_GraphDockWidget->setAllowedAreas(Qt::BottomDockWidgetArea|Qt::TopDockWidgetArea);
+	m_GraphDockWidget->setVisible(false);
+
+	m_GraphWindow = new GraphWindow(m_VideoViewList, m_GraphDockWidget);
+	m_GraphDockWidget->setWidget(m_GraphWindow);
+	addDockWidget(Qt::BottomDockWidgetArea, m_GraphDockWidget);
+
+	m_HistogramDockWidget = new QDockWidget("Histogram", this );
+	m_HistogramDockWidget->setAllowedAreas(Qt::AllDockWidgetAreas);
+	m_HistogramDockWidget->setVisible(false);
 
+	m_HistogramWindow = new HistogramWindow(m_VideoViewList, m_HistogramDockWidget);
+	m_HistogramDockWidget->setWidget(m_HistogramWindow);
+	addDockWidget(Qt::RightDockWidgetArea, m_HistogramDockWidget);
+
+	m_PixelDockWidget = new QDockWidget("Pixels", this );
+	m_PixelDockWidget->setAllowedAreas(Qt::LeftDockWidgetArea|Qt::RightDockWidgetArea);
+	m_PixelDockWidget->setVisible(false);
+
+	m_PixelWindow = new PixelWindow(m_VideoViewList, ui.rendererWidget, m_PixelDockWidget);
+	m_PixelDockWidget->setWidget(m_PixelWindow);
+	addDockWidget(Qt::RightDockWidgetArea, m_PixelDockWidget);
 
 	m_ScoreDockWidget = new QDockWidget("Score", this );
 	m_ScoreDockWidget->setAllowedAreas(Qt::BottomDockWidgetArea);
@@ -563,7 +599,8 @@ VideoView* MainWindow::openFileInternal( QString strPath )
 	}
 
 	QFile file(strPath);
-	if (!file.exists())
+	bool isStream = strPath.startsWith(SOURCE_STDIN_PREFIX) || strPath.startsWith(SOURCE_SOCKET_PREFIX);
+	if (!isStream && !file.exists())
 	{
 		QMessageBox::warning(this, "Error", "File does not exist.");
 		return NULL;
@@ -641,6 +678,7 @@ void MainWindow::openScript( QString strPath, bool debug )
 	scriptMainWindow.setProperty("scoreWindow", m_Engine->newQObject(m_ScoreWindow));
 
 	scriptMainWindow.setProperty("actionScore", m_Engine->newQObject(m_ScoreDockWidget->toggleViewAction()));
+	scriptMainWindow.setProperty("actionHistogram", m_Engine->newQObject(m_HistogramDockWidget->toggleViewAction()));
 	scriptMainWindow.setProperty("actionCompare", m_Engine->newQObject(ui.action_Compare));
 	scriptMainWindow.setProperty("actionOptions", m_Engine->newQObject(ui.action_Options));
 	scriptMainWindow.setProperty("actionClose", m_Engine->newQObject(ui.action_Close));
@@ -870,26 +908,23 @@ void MainWindow::on_action_Step_Back_Fast_triggered()
 
 void MainWindow::on_action_Seek_Beginning_triggered()
 {
-	const QList<unsigned int>& tsLst = m_VideoViewList->GetMergedTimeStamps();
-	if (tsLst.size())
-	{
-		m_VideoViewList->GetControl()->Seek(tsLst.first(), false);
-	}
+	const MergedTimeline& tsLst = m_VideoViewList->GetMergedTimeStamps();
+	m_VideoViewList->GetControl()->Seek(tsLst.First(), false);
 }
 
 void MainWindow::on_action_Seek_End_triggered()
 {
-	const QList<unsigned int>& tsLst = m_VideoViewList->GetMergedTimeStamps();
-	if (tsLst.size())
-	{
-		m_VideoViewList->GetControl()->Seek(tsLst.last(), false);
-	}
+	const MergedTimeline& tsLst = m_VideoViewList->GetMergedTimeStamps();
+	m_VideoViewList->GetControl()->Seek(tsLst.Last(), false);
 }
 
 void MainWindow::OnTimer()
 {
 	ui.action_Enable_Logging->setChecked(GetHostImpl()->IsLoggingEnabled());
 	ui.action_Compare->setChecked(m_MeasureDockWidget->toggleViewAction()->isChecked());
+	ui.action_Graph->setChecked(m_GraphDockWidget->toggleViewAction()->isChecked());
+	ui.action_Histogram->setChecked(m_HistogramDockWidget->toggleViewAction()->isChecked());
+	ui.action_Pixel_Window->setChecked(m_PixelDockWidget->toggleViewAction()->isChecked());
 
 	if (!m_VideoViewList->size())
 	{
@@ -901,13 +936,13 @@ void MainWindow::OnTimer()
 
 	PlaybackControl::Status status;
 	m_VideoViewList->GetControl()->GetStatus(&status);
-	const QList<unsigned int>& tsLst = m_VideoViewList->GetMergedTimeStamps();
+	const MergedTimeline& tsLst = m_VideoViewList->GetMergedTimeStamps();
 
 	m_VideoViewList->CheckRenderReset();
 	
 	UpdateActiveVideoView();
 	VideoView* active = m_ActiveVideoView;
-	OnUpdateSlider(tsLst.last(), status.lastProcessPTS);
+	OnUpdateSlider(tsLst.Last(), status.lastProcessPTS);
 
 	if (!active)
 	{
@@ -972,6 +1007,15 @@ void MainWindow::OnTimer()
 			m_RenderSpeedLabel->setText("Paused");
 		}
 	}
+
+	// Occupancy of frame pools of all windows
+	int pools, inUse, capacity;
+	qint64 bytes, budget;
+	GetHostImpl()->GetFramePoolStats(pools, inUse, capacity, bytes, budget);
+	str.clear();
+	QTextStream(&str) << "Frame pools: " << inUse << " / " << capacity << " frames in use, "
+		<< bytes/(1024*1024) << " / " << budget/(1024*1024) << " MB";
+	m_RenderSpeedLabel->setToolTip(str);
 	
 
 	if (status.isPlaying)
@@ -1003,19 +1047,8 @@ void MainWindow::stepVideo( int step )
 	PlaybackControl::Status status;
 	m_VideoViewList->GetControl()->GetStatus(&status);
 
-	const QList<unsigned int>& tsLst = m_VideoViewList->GetMergedTimeStamps();
-	// QList<unsigned int>::iterator i = qBinaryFind(timeStampList.begin(), timeStampList.end(), status.lastDisplayPTS);
-	int frame_num=0;
-	for (frame_num=0; frame_num<tsLst.size(); frame_num++)
-	{
-		if (status.lastDisplayPTS == tsLst.at(frame_num))
-		{
-			break;
-		}
-	}
-	
-	frame_num = MIN(MAX(frame_num + step, 0), tsLst.size()-1);
-	unsigned int pts = tsLst.at(frame_num);
+	const MergedTimeline& tsLst = m_VideoViewList->GetMergedTimeStamps();
+	unsigned int pts = tsLst.Step(status.lastDisplayPTS, step);
 	m_VideoViewList->GetControl()->Seek(pts, false);
 
 	bool old = m_Slider->blockSignals(true);
@@ -1038,6 +1071,9 @@ void MainWindow::EnableButtons( int nrSources )
 
 	m_ActionsButton->setEnabled(nrSources!=0);
 	ui.action_Compare->setEnabled(nrSources>1);
+	ui.action_Graph->setEnabled(nrSources>1);
+	ui.action_Histogram->setEnabled(nrSources!=0);
+	ui.action_Pixel_Window->setEnabled(nrSources!=0);
 	
 	// ui.action_Select_Processed_2->setEnabled(nrSources>2);
 	ui.action_Select_Original->setEnabled(false);
@@ -1050,11 +1086,14 @@ void MainWindow::EnableButtons( int nrSources )
 	if (nrSources == 0)
 	{
 		m_Slider->setSliderPosition(0);
+		m_HistogramDockWidget->hide();
+		m_PixelDockWidget->hide();
 	}
 
 	if (nrSources<2)
 	{
 		m_MeasureDockWidget->hide();
+		m_GraphDockWidget->hide();
 	}
 }
 
@@ -1189,27 +1228,6 @@ void MainWindow::OnVideoViewClosed(VideoView* vv)
 	m_ActiveVideoView = NULL;
 	emit activeVideoViewChanged(NULL);
 
-	if (vv->GetType() == PLUGIN_TRANSFORM)
-	{
-		// VideoQueue* vq = vv->GetRefVideoQueue();
-		for (int i=0; i<m_VideoViewList->size(); i++)
-		{
-			// VideoView* vvRef = m_VideoViewList->at(i);
-			/*if (vq == vvRef->GetVideoQueue())
-			{
-				const QList<QAction*>& actions = vvRef->GetTransformActions();
-				for (int j=0; j<actions.size(); j++)
-				{
-					TransformActionData* data = (TransformActionData*)actions[j]->data().value<void *>();
-					if (data->outputName == vv->GetTitle())
-					{
-						actions[j]->setChecked(false);
-					}
-				}
-			}*/
-		}
-	}
-
 	autoResizeWindow();
 
 	if (m_VideoViewList->size() == 0)
@@ -1294,6 +1312,21 @@ void MainWindow::on_action_Compare_triggered()
 	m_MeasureDockWidget->toggleViewAction()->trigger();
 }
 
+void MainWindow::on_action_Graph_triggered()
+{
+	m_GraphDockWidget->toggleViewAction()->trigger();
+}
+
+void MainWindow::on_action_Histogram_triggered()
+{
+	m_HistogramDockWidget->toggleViewAction()->trigger();
+}
+
+void MainWindow::on_action_Pixel_Window_triggered()
+{
+	m_PixelDockWidget->toggleViewAction()->trigger();
+}
+
 void MainWindow::on_action_Select_From_triggered()
 {
 	m_VideoViewList->GetControl()->SelectFrom();
@@ -1507,3 +1540,8 @@ void MainWindow::enableSubjectiveTestInterface(bool status)
 
 }
 
+void MainWindow::enableStatistics( bool enable )
+{
+	m_VideoViewList->SetStatisticsEnabled(STATISTICS_SCRIPT, enable);
+}
+
@@ -20,6 +20,9 @@ class QClickableSlider;
 struct Graph_Stats;
 struct SourceInfo;
 class MeasureWindow;
+class GraphWindow;
+class HistogramWindow;
+class PixelWindow;
 class ScoreWindow;
 class QDockWidget;
 class QScriptEngine;
@@ -68,6 +71,8 @@ public slots:
 
 	void fullscreen();
 	void enableSubjectiveTestInterface(bool status);
+	// Histograms of frames shown, see VideoView::statistics()
+	void enableStatistics(bool enable);
 
 protected:
 	VideoView* openFileInternal(QString strPath);
@@ -121,6 +126,9 @@ private slots:
 	void on_action_Enable_Logging_triggered();
 	void on_action_Quality_Measures_triggered();
 	void on_action_Compare_triggered();
+	void on_action_Graph_triggered();
+	void on_action_Histogram_triggered();
+	void on_action_Pixel_Window_triggered();
 
 	void on_action_Select_From_triggered();
 	void on_action_Select_To_triggered();
@@ -146,6 +154,12 @@ private:
 	QActionGroup* m_ZoomGroup;
 	MeasureWindow* m_MeasureWindow;
 	QDockWidget* m_MeasureDockWidget;
+	GraphWindow* m_GraphWindow;
+	QDockWidget* m_GraphDockWidget;
+	HistogramWindow* m_HistogramWindow;
+	QDockWidget* m_HistogramDockWidget;
+	PixelWindow* m_PixelWindow;
+	QDockWidget* m_PixelDockWidget;
 
 	ScoreWindow* m_ScoreWindow;
 	QDockWidget* m_ScoreDockWidget;
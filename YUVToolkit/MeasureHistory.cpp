@@ -0,0 +1,658 @@
+#include "MeasureHistory.h"
+#include <float.h>
+#include <math.h>
+
+// Frame numbers beyond this are ignored to keep columns in reasonable size
+#define MAX_HISTORY_FRAMES	(1<<24)
+
+static inline int PopCount(quint32 v)
+{
+	v = v - ((v >> 1) & 0x55555555);
+	v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+	return (((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+void SumTree::Resize( int size )
+{
+	m_Tree.fill(0, size+1);
+}
+
+void SumTree::Add( int index, double value )
+{
+	for (int i=index+1; i<m_Tree.size(); i+=(i&-i))
+	{
+		m_Tree[i] += value;
+	}
+}
+
+double SumTree::Prefix( int index ) const
+{
+	double sum = 0;
+	for (int i=qMin(index, m_Tree.size()-1); i>0; i-=(i&-i))
+	{
+		sum += m_Tree[i];
+	}
+	return sum;
+}
+
+void MinMaxTree::Resize( int size )
+{
+	m_Size = 1;
+	while (m_Size < size)
+	{
+		m_Size <<= 1;
+	}
+	m_Min.fill(DBL_MAX, m_Size*2);
+	m_Max.fill(-DBL_MAX, m_Size*2);
+}
+
+void MinMaxTree::Set( int index, double value )
+{
+	int i = index+m_Size;
+	m_Min[i] = m_Max[i] = value;
+	for (i>>=1; i>0; i>>=1)
+	{
+		m_Min[i] = qMin(m_Min[i*2], m_Min[i*2+1]);
+		m_Max[i] = qMax(m_Max[i*2], m_Max[i*2+1]);
+	}
+}
+
+void MinMaxTree::Clear( int index )
+{
+	int i = index+m_Size;
+	m_Min[i] = DBL_MAX;
+	m_Max[i] = -DBL_MAX;
+	for (i>>=1; i>0; i>>=1)
+	{
+		m_Min[i] = qMin(m_Min[i*2], m_Min[i*2+1]);
+		m_Max[i] = qMax(m_Max[i*2], m_Max[i*2+1]);
+	}
+}
+
+bool MinMaxTree::Range( int from, int to, double& minValue, double& maxValue ) const
+{
+	minValue = DBL_MAX;
+	maxValue = -DBL_MAX;
+	for (int l=from+m_Size, r=to+m_Size+1; l<r; l>>=1, r>>=1)
+	{
+		if (l&1)
+		{
+			minValue = qMin(minValue, m_Min[l]);
+			maxValue = qMax(maxValue, m_Max[l]);
+			l++;
+		}
+		if (r&1)
+		{
+			--r;
+			minValue = qMin(minValue, m_Min[r]);
+			maxValue = qMax(maxValue, m_Max[r]);
+		}
+	}
+	return minValue <= maxValue;
+}
+
+struct RankItem
+{
+	double value;
+	int index;
+	bool operator< (const RankItem& r) const {return value < r.value;}
+};
+
+void RankTree::Build( const QVector<double>& values, const QVector<bool>& valid )
+{
+	m_Size = values.size();
+
+	QVector<RankItem> items;
+	for (int i=0; i<m_Size; i++)
+	{
+		if (valid.at(i))
+		{
+			RankItem item = {values.at(i), i};
+			items.append(item);
+		}
+	}
+	qStableSort(items.begin(), items.end());
+
+	// Frames without results get the largest rank, so they are never selected
+	int validCount = items.size();
+	QVector<int> ranks(m_Size, validCount);
+	m_Sorted.resize(validCount);
+	for (int i=0; i<validCount; i++)
+	{
+		ranks[items.at(i).index] = i;
+		m_Sorted[i] = items.at(i).value;
+	}
+
+	m_ValidPrefix.resize(m_Size+1);
+	m_ValidPrefix[0] = 0;
+	for (int i=0; i<m_Size; i++)
+	{
+		m_ValidPrefix[i+1] = m_ValidPrefix[i] + (valid.at(i)?1:0);
+	}
+
+	m_Levels = 1;
+	while ((1<<m_Levels) <= validCount)
+	{
+		m_Levels++;
+	}
+
+	int words = m_Size/32+1;
+	m_Bits.resize(m_Levels);
+	m_Ones.resize(m_Levels);
+	m_Zeros.resize(m_Levels);
+
+	QVector<int> next(m_Size);
+	for (int level=0; level<m_Levels; level++)
+	{
+		int bit = m_Levels-1-level;
+		QVector<quint32>& bits = m_Bits[level];
+		QVector<quint32>& ones = m_Ones[level];
+		bits.fill(0, words);
+		ones.fill(0, words);
+
+		int zeros = 0;
+		for (int i=0; i<m_Size; i++)
+		{
+			if ((ranks[i]>>bit)&1)
+			{
+				bits[i>>5] |= (1u<<(i&31));
+			}else
+			{
+				zeros++;
+			}
+		}
+		for (int w=1; w<words; w++)
+		{
+			ones[w] = ones[w-1] + PopCount(bits[w-1]);
+		}
+		m_Zeros[level] = zeros;
+
+		// Stable partition, zeros first
+		int z = 0, o = zeros;
+		for (int i=0; i<m_Size; i++)
+		{
+			if ((ranks[i]>>bit)&1)
+			{
+				next[o++] = ranks[i];
+			}else
+			{
+				next[z++] = ranks[i];
+			}
+		}
+		ranks = next;
+	}
+}
+
+int RankTree::Count( int from, int to ) const
+{
+	return m_ValidPrefix.at(to+1)-m_ValidPrefix.at(from);
+}
+
+int RankTree::Rank1( int level, int pos ) const
+{
+	const QVector<quint32>& bits = m_Bits.at(level);
+	return m_Ones.at(level).at(pos>>5) + PopCount(bits.at(pos>>5) & ((1u<<(pos&31))-1));
+}
+
+double RankTree::Select( int from, int to, int k ) const
+{
+	int l = from;
+	int r = to+1;
+	int rank = 0;
+	for (int level=0; level<m_Levels; level++)
+	{
+		int onesL = Rank1(level, l);
+		int onesR = Rank1(level, r);
+		int zeros = (r-l)-(onesR-onesL);
+		if (k < zeros)
+		{
+			l -= onesL;
+			r -= onesR;
+			rank <<= 1;
+		}else
+		{
+			k -= zeros;
+			l = m_Zeros.at(level)+onesL;
+			r = m_Zeros.at(level)+onesR;
+			rank = (rank<<1)|1;
+		}
+	}
+
+	return m_Sorted.at(qMin(rank, m_Sorted.size()-1));
+}
+
+// Rebuilds rank tree of a plane from copies of its values
+class RankBuildTask : public QRunnable
+{
+public:
+	RankBuildTask(RankSnapshotPtr snapshot, const QVector<double>& values, const QVector<bool>& valid) :
+		m_Snapshot(snapshot), m_Values(values), m_Valid(valid) {}
+
+	void run()
+	{
+		RankTreePtr tree(new RankTree);
+		tree->Build(m_Values, m_Valid);
+
+		QMutexLocker locker(&m_Snapshot->mutex);
+		m_Snapshot->tree = tree;
+		m_Snapshot->building = false;
+	}
+private:
+	RankSnapshotPtr m_Snapshot;
+	QVector<double> m_Values;
+	QVector<bool> m_Valid;
+};
+
+MeasureSeries::MeasureSeries() : m_LastFrame(-1)
+{
+	for (int i=0; i<PLANE_COUNT; i++)
+	{
+		m_Ranks[i] = RankSnapshotPtr(new RankSnapshot);
+		m_RanksDirty[i] = true;
+	}
+}
+
+void MeasureSeries::Grow( int size )
+{
+	int capacity = qMax(m_PTS.size(), 256);
+	while (capacity < size)
+	{
+		capacity *= 2;
+	}
+
+	int oldCapacity = m_PTS.size();
+	m_PTS.resize(capacity);
+	m_TestFrameNumbers.resize(capacity);
+	for (int i=oldCapacity; i<capacity; i++)
+	{
+		m_PTS[i] = INVALID_PTS;
+	}
+
+	for (int p=0; p<PLANE_COUNT; p++)
+	{
+		int oldSize = m_Valid[p].size();
+		m_Results[p].resize(capacity);
+		m_Valid[p].resize(capacity);
+		for (int i=oldSize; i<capacity; i++)
+		{
+			m_Valid[p][i] = false;
+		}
+
+		m_Sums[p].Resize(capacity);
+		m_Counts[p].Resize(capacity);
+		m_MinMax[p].Resize(capacity);
+		for (int i=0; i<oldSize; i++)
+		{
+			if (m_Valid[p].at(i))
+			{
+				m_Sums[p].Add(i, m_Results[p].at(i));
+				m_Counts[p].Add(i, 1);
+				m_MinMax[p].Set(i, m_Results[p].at(i));
+			}
+		}
+		m_RanksDirty[p] = true;
+	}
+}
+
+void MeasureSeries::Set( unsigned int frameNumber, unsigned int pts, unsigned int testFrameNumber, const MeasureOperation& op )
+{
+	if (frameNumber >= MAX_HISTORY_FRAMES)
+	{
+		return;
+	}
+
+	int frame = (int)frameNumber;
+	if (frame >= Size())
+	{
+		Grow(frame+1);
+	}
+
+	if (m_PTS.at(frame) != INVALID_PTS)
+	{
+		m_PTSIndex.remove(m_PTS.at(frame));
+		m_FramePTS.remove(frame);
+	}
+	m_PTS[frame] = pts;
+	m_TestFrameNumbers[frame] = testFrameNumber;
+	m_LastFrame = qMax(m_LastFrame, frame);
+	if (pts != INVALID_PTS)
+	{
+		m_PTSIndex.insert(pts, frame);
+		m_FramePTS.insert(frame, pts);
+	}
+
+	for (int p=0; p<PLANE_COUNT; p++)
+	{
+		if (m_Valid[p].at(frame))
+		{
+			m_Sums[p].Add(frame, -m_Results[p].at(frame));
+			m_Counts[p].Add(frame, -1);
+			m_MinMax[p].Clear(frame);
+		}
+
+		m_Valid[p][frame] = op.hasResults[p];
+		m_Results[p][frame] = op.results[p];
+		if (op.hasResults[p])
+		{
+			m_Sums[p].Add(frame, op.results[p]);
+			m_Counts[p].Add(frame, 1);
+			m_MinMax[p].Set(frame, op.results[p]);
+		}
+		m_RanksDirty[p] = true;
+	}
+}
+
+bool MeasureSeries::Get( unsigned int frameNumber, unsigned int testFrameNumber, MeasureOperation& op ) const
+{
+	if (frameNumber >= (unsigned int)Size() || m_PTS.at(frameNumber) == INVALID_PTS ||
+		m_TestFrameNumbers.at(frameNumber) != testFrameNumber)
+	{
+		return false;
+	}
+
+	for (int p=0; p<PLANE_COUNT; p++)
+	{
+		op.hasResults[p] = m_Valid[p].at(frameNumber);
+		op.results[p] = m_Results[p].at(frameNumber);
+	}
+	return true;
+}
+
+bool MeasureSeries::FindRange( unsigned int ptsFrom, unsigned int ptsTo, int& from, int& to ) const
+{
+	QMap<unsigned int, int>::const_iterator first = m_PTSIndex.lowerBound(ptsFrom);
+	QMap<unsigned int, int>::const_iterator last = m_PTSIndex.upperBound(ptsTo);
+	if (first == m_PTSIndex.constEnd() || first == last)
+	{
+		return false;
+	}
+	--last;
+
+	from = qMin(first.value(), last.value());
+	to = qMax(first.value(), last.value());
+	return true;
+}
+
+bool MeasureSeries::Aggregate( int plane, int from, int to, const QList<double>& percentiles, MeasureAggregate& result )
+{
+	result.count = (int)m_Counts[plane].Range(from, to);
+	result.percentiles.clear();
+	if (result.count <= 0)
+	{
+		return false;
+	}
+
+	result.mean = m_Sums[plane].Range(from, to)/result.count;
+	m_MinMax[plane].Range(from, to, result.min, result.max);
+
+	if (percentiles.size() == 0)
+	{
+		return true;
+	}
+
+	RankSnapshot* snapshot = m_Ranks[plane].data();
+	RankTreePtr tree;
+	bool build = false;
+	snapshot->mutex.lock();
+	tree = snapshot->tree;
+	if (m_RanksDirty[plane] && !snapshot->building)
+	{
+		snapshot->building = true;
+		build = true;
+	}
+	snapshot->mutex.unlock();
+
+	if (build)
+	{
+		// Vectors are shared until the next Set(..) writes to them, which
+		// then copies them once in O(n). So each build costs O(n log n) on
+		// a worker thread plus one O(n) copy, and Set(..) stays O(log n)
+		// otherwise.
+		m_RanksDirty[plane] = false;
+		QThreadPool::globalInstance()->start(new RankBuildTask(m_Ranks[plane], m_Results[plane], m_Valid[plane]));
+	}
+
+	if (!tree)
+	{
+		// Not ready until the first build is done, queries never wait for it
+		return true;
+	}
+
+	int last = qMin(to, tree->Size()-1);
+	int count = (from <= last)?tree->Count(from, last):0;
+	for (int i=0; i<percentiles.size() && count>0; i++)
+	{
+		// Nearest rank
+		int k = (int)ceil(percentiles.at(i)/100.0*count)-1;
+		k = qBound(0, k, count-1);
+		result.percentiles.append(tree->Select(from, last, k));
+	}
+
+	return true;
+}
+
+void MeasureSeries::Envelope( int plane, int bins, QVector<double>& frames, QVector<double>& minValues, 
+	QVector<double>& maxValues, QVector<double>& meanValues ) const
+{
+	frames.clear();
+	minValues.clear();
+	maxValues.clear();
+	meanValues.clear();
+
+	int count = m_LastFrame+1;
+	bins = qMin(bins, count);
+	for (int b=0; b<bins; b++)
+	{
+		int from = (int)(((qint64)b)*count/bins);
+		int to = (int)(((qint64)b+1)*count/bins)-1;
+		double n = m_Counts[plane].Range(from, to);
+		if (n < 1)
+		{
+			continue;
+		}
+
+		double minValue, maxValue;
+		m_MinMax[plane].Range(from, to, minValue, maxValue);
+		frames.append((from+to)/2.0);
+		minValues.append(minValue);
+		maxValues.append(maxValue);
+		meanValues.append(m_Sums[plane].Range(from, to)/n);
+	}
+}
+
+unsigned int MeasureSeries::NearestPTS( int frame ) const
+{
+	if (m_FramePTS.isEmpty())
+	{
+		return INVALID_PTS;
+	}
+
+	// First measured frame at or after given one, or the one before it
+	// if that is closer, earlier frame wins a tie
+	QMap<int, unsigned int>::const_iterator next = m_FramePTS.lowerBound(frame);
+	if (next == m_FramePTS.constBegin())
+	{
+		return next.value();
+	}
+
+	QMap<int, unsigned int>::const_iterator prev = next-1;
+	if (next == m_FramePTS.constEnd() || frame-prev.key() <= next.key()-frame)
+	{
+		return prev.value();
+	}
+	return next.value();
+}
+
+bool MeasureSeriesId::operator<( const MeasureSeriesId& k ) const
+{
+	if (sourceViewId1 != k.sourceViewId1)
+	{
+		return sourceViewId1 < k.sourceViewId1;
+	}
+	if (sourceViewId2 != k.sourceViewId2)
+	{
+		return sourceViewId2 < k.sourceViewId2;
+	}
+	return measureName < k.measureName;
+}
+
+MeasureHistory::MeasureHistory() : m_Revision(0)
+{
+}
+
+MeasureHistory::~MeasureHistory()
+{
+	Clear();
+}
+
+void MeasureHistory::Store( unsigned int sourceViewId1, unsigned int sourceViewId2,
+	const Frame& frame1, const Frame& frame2, const MeasureOperation& op )
+{
+	QMutexLocker locker(&m_Mutex);
+
+	MeasureSeriesId key = {op.measureName, sourceViewId1, sourceViewId2};
+	MeasureSeries*& series = m_Series[key];
+	if (!series)
+	{
+		series = new MeasureSeries;
+	}
+
+	series->Set(frame1.FrameNumber(), frame1.PTS(), frame2.FrameNumber(), op);
+	m_Revision++;
+}
+
+bool MeasureHistory::Lookup( unsigned int sourceViewId1, unsigned int sourceViewId2,
+	const Frame& frame1, const Frame& frame2, MeasureOperation& op )
+{
+	QMutexLocker locker(&m_Mutex);
+
+	MeasureSeriesId key = {op.measureName, sourceViewId1, sourceViewId2};
+	MeasureSeries* series = m_Series.value(key);
+	if (!series)
+	{
+		return false;
+	}
+
+	return series->Get(frame1.FrameNumber(), frame2.FrameNumber(), op);
+}
+
+bool MeasureHistory::Aggregate( const QString& measureName, unsigned int sourceViewId1, unsigned int sourceViewId2,
+	int plane, unsigned int ptsFrom, unsigned int ptsTo, const QList<double>& percentiles, MeasureAggregate& result )
+{
+	QMutexLocker locker(&m_Mutex);
+
+	MeasureSeriesId key = {measureName, sourceViewId1, sourceViewId2};
+	MeasureSeries* series = m_Series.value(key);
+	int from = 0, to = 0;
+	if (!series || !series->FindRange(ptsFrom, ptsTo, from, to))
+	{
+		return false;
+	}
+
+	return series->Aggregate(plane, from, to, percentiles, result);
+}
+
+bool MeasureHistory::Export( const QString& path )
+{
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		return false;
+	}
+
+	QMutexLocker locker(&m_Mutex);
+
+	QTextStream out(&file);
+	out << "Measure,Original,Processed,Frame,PTS,Processed Frame,Y,U,V,Color\n";
+
+	QMapIterator<MeasureSeriesId, MeasureSeries*> it(m_Series);
+	while (it.hasNext())
+	{
+		it.next();
+		const MeasureSeriesId& key = it.key();
+		const MeasureSeries* series = it.value();
+
+		for (int i=0; i<series->Size(); i++)
+		{
+			if (series->PTS(i) == INVALID_PTS)
+			{
+				continue;
+			}
+
+			out << key.measureName << "," << key.sourceViewId1 << "," << key.sourceViewId2 << ","
+				<< i << "," << series->PTS(i) << "," << series->TestFrameNumber(i);
+			for (int p=0; p<PLANE_COUNT; p++)
+			{
+				out << ",";
+				if (series->HasResult(i, p))
+				{
+					out << QString::number(series->Result(i, p), 'f', 4);
+				}
+			}
+			out << "\n";
+		}
+	}
+
+	return out.status() == QTextStream::Ok;
+}
+
+void MeasureHistory::Clear( unsigned int viewId )
+{
+	QMutexLocker locker(&m_Mutex);
+
+	QMutableMapIterator<MeasureSeriesId, MeasureSeries*> it(m_Series);
+	while (it.hasNext())
+	{
+		it.next();
+		if (it.key().sourceViewId1 == viewId || it.key().sourceViewId2 == viewId)
+		{
+			delete it.value();
+			it.remove();
+			m_Revision++;
+		}
+	}
+}
+
+void MeasureHistory::Clear()
+{
+	QMutexLocker locker(&m_Mutex);
+
+	qDeleteAll(m_Series);
+	m_Series.clear();
+	m_Revision++;
+}
+
+unsigned int MeasureHistory::GetRevision()
+{
+	QMutexLocker locker(&m_Mutex);
+	return m_Revision;
+}
+
+void MeasureHistory::GetSeriesList( QList<MeasureSeriesId>& ids )
+{
+	QMutexLocker locker(&m_Mutex);
+	ids = m_Series.keys();
+}
+
+bool MeasureHistory::Envelope( const MeasureSeriesId& id, int plane, int bins, QVector<double>& frames, 
+	QVector<double>& minValues, QVector<double>& maxValues, QVector<double>& meanValues )
+{
+	QMutexLocker locker(&m_Mutex);
+
+	MeasureSeries* series = m_Series.value(id);
+	if (!series)
+	{
+		return false;
+	}
+
+	series->Envelope(plane, bins, frames, minValues, maxValues, meanValues);
+	return frames.size()>0;
+}
+
+unsigned int MeasureHistory::FrameToPTS( const MeasureSeriesId& id, int frame )
+{
+	QMutexLocker locker(&m_Mutex);
+
+	MeasureSeries* series = m_Series.value(id);
+	return series?series->NearestPTS(frame):INVALID_PTS;
+}
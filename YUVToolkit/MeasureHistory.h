@@ -0,0 +1,181 @@
+#ifndef MEASURE_HISTORY_H
+#define MEASURE_HISTORY_H
+
+#include "YT_Interface.h"
+#include <QtCore>
+
+// Prefix sums with O(log n) point update and range query
+class SumTree
+{
+public:
+	void Resize(int size);
+	void Add(int index, double value);
+	// Sum of [0, index)
+	double Prefix(int index) const;
+	// Sum of [from, to]
+	double Range(int from, int to) const {return Prefix(to+1)-Prefix(from);}
+private:
+	QVector<double> m_Tree;
+};
+
+// Minimum and maximum with O(log n) point update and range query
+class MinMaxTree
+{
+public:
+	void Resize(int size);
+	void Set(int index, double value);
+	void Clear(int index);
+	// Min and max of [from, to], returns false if there are no values
+	bool Range(int from, int to, double& minValue, double& maxValue) const;
+private:
+	int m_Size;
+	QVector<double> m_Min;
+	QVector<double> m_Max;
+};
+
+// Wavelet matrix over ranks of values, k-th smallest value of a range in O(log n).
+// Static, it is rebuilt when values have been changed since last query.
+class RankTree
+{
+public:
+	void Build(const QVector<double>& values, const QVector<bool>& valid);
+	// k-th (0 based) smallest valid value in [from, to]
+	double Select(int from, int to, int k) const;
+	// Number of valid values in [from, to]
+	int Count(int from, int to) const;
+	int Size() const {return m_Size;}
+private:
+	int Rank1(int level, int pos) const;
+
+	int m_Size;
+	int m_Levels;
+	QVector<double> m_Sorted;
+	QVector<int> m_ValidPrefix;
+	QVector<QVector<quint32> > m_Bits;
+	QVector<QVector<quint32> > m_Ones;
+	QVector<int> m_Zeros;
+};
+
+typedef QSharedPointer<RankTree> RankTreePtr;
+
+// Latest rank tree of one plane of a series. Rebuilding takes O(n log n), so
+// it is done on a worker thread from a copy of the values, at most one at a
+// time, and queries keep using the tree built before until it is done.
+struct RankSnapshot
+{
+	QMutex mutex;
+	RankTreePtr tree;
+	bool building;
+
+	RankSnapshot() : building(false) {}
+};
+typedef QSharedPointer<RankSnapshot> RankSnapshotPtr;
+
+struct MeasureAggregate
+{
+	int count;
+	double mean;
+	double min;
+	double max;
+
+	// Same order as percentiles given to MeasureHistory::Aggregate(..),
+	// empty if none of the frames has been ranked yet
+	QList<double> percentiles;
+};
+
+// Results of one measure between one pair of videos, one row per frame of
+// the reference video, and one column per plane
+class MeasureSeries
+{
+public:
+	MeasureSeries();
+
+	void Set(unsigned int frameNumber, unsigned int pts, unsigned int testFrameNumber, const MeasureOperation& op);
+	bool Get(unsigned int frameNumber, unsigned int testFrameNumber, MeasureOperation& op) const;
+
+	// Frame range [from, to] that covers PTS range, false if no frames inside
+	bool FindRange(unsigned int ptsFrom, unsigned int ptsTo, int& from, int& to) const;
+	// Percentiles come from the rank tree built last on a worker thread, so
+	// results stored since may be missing from them until the next rebuild
+	// is done, and there are none until the first build is done
+	bool Aggregate(int plane, int from, int to, const QList<double>& percentiles, MeasureAggregate& result);
+	// Min, max and mean of each of bins equal frame ranges that cover whole series
+	void Envelope(int plane, int bins, QVector<double>& frames, QVector<double>& minValues,
+		QVector<double>& maxValues, QVector<double>& meanValues) const;
+	// PTS of measured frame closest to given frame
+	unsigned int NearestPTS(int frame) const;
+
+	int Size() const {return m_PTS.size();}
+	int LastFrame() const {return m_LastFrame;}
+	unsigned int PTS(int frame) const {return m_PTS.at(frame);}
+	unsigned int TestFrameNumber(int frame) const {return m_TestFrameNumbers.at(frame);}
+	bool HasResult(int frame, int plane) const {return m_Valid[plane].at(frame);}
+	double Result(int frame, int plane) const {return m_Results[plane].at(frame);}
+
+private:
+	void Grow(int size);
+
+	QVector<unsigned int> m_PTS;
+	QVector<unsigned int> m_TestFrameNumbers;
+	QVector<double> m_Results[PLANE_COUNT];
+	QVector<bool> m_Valid[PLANE_COUNT];
+	QMap<unsigned int, int> m_PTSIndex;
+	QMap<int, unsigned int> m_FramePTS; // measured frames only, for NearestPTS(..)
+	int m_LastFrame;
+
+	SumTree m_Sums[PLANE_COUNT];
+	SumTree m_Counts[PLANE_COUNT];
+	MinMaxTree m_MinMax[PLANE_COUNT];
+	RankSnapshotPtr m_Ranks[PLANE_COUNT];
+	bool m_RanksDirty[PLANE_COUNT];
+};
+
+// Identifies results of one measure between one pair of videos
+struct MeasureSeriesId
+{
+	QString measureName;
+	unsigned int sourceViewId1;
+	unsigned int sourceViewId2;
+
+	bool operator< (const MeasureSeriesId& k) const;
+};
+
+// Keeps per frame results of all measures, so that frames visited before
+// do not need to be measured again. Thread safe.
+class MeasureHistory
+{
+public:
+	MeasureHistory();
+	~MeasureHistory();
+
+	void Store(unsigned int sourceViewId1, unsigned int sourceViewId2,
+		const Frame& frame1, const Frame& frame2, const MeasureOperation& op);
+	// Fills results of op if frame pair has been measured before
+	bool Lookup(unsigned int sourceViewId1, unsigned int sourceViewId2,
+		const Frame& frame1, const Frame& frame2, MeasureOperation& op);
+
+	// Aggregate results within [ptsFrom, ptsTo], percentiles in range 0..100
+	bool Aggregate(const QString& measureName, unsigned int sourceViewId1, unsigned int sourceViewId2,
+		int plane, unsigned int ptsFrom, unsigned int ptsTo, const QList<double>& percentiles, MeasureAggregate& result);
+
+	// Write all results as comma separated values, one row per frame
+	bool Export(const QString& path);
+
+	// Changes each time results are stored or cleared
+	unsigned int GetRevision();
+	void GetSeriesList(QList<MeasureSeriesId>& ids);
+	bool Envelope(const MeasureSeriesId& id, int plane, int bins, QVector<double>& frames, 
+		QVector<double>& minValues, QVector<double>& maxValues, QVector<double>& meanValues);
+	unsigned int FrameToPTS(const MeasureSeriesId& id, int frame);
+
+	// Remove results that involve given video, or all results
+	void Clear(unsigned int viewId);
+	void Clear();
+
+private:
+	QMutex m_Mutex;
+	QMap<MeasureSeriesId, MeasureSeries*> m_Series;
+	unsigned int m_Revision;
+};
+
+#endif
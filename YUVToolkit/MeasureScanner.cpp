@@ -0,0 +1,298 @@
+#include "MeasureScanner.h"
+#include "MeasureHistory.h"
+#include "ColorConversion.h"
+#include "VideoView.h"
+#include "VideoViewList.h"
+
+// Number of frames measured by one task
+#define SCAN_TASK_FRAMES 16
+
+class MeasureScanTask : public QRunnable
+{
+public:
+	MeasureScanTask(MeasureScanner* scanner, const MeasureScanner::Job& job, int from, int to) :
+		m_Scanner(scanner), m_Job(job), m_From(from), m_To(to)
+	{
+	}
+
+	void run();
+private:
+	// Returns frameOrig if source is in native color, or else frameNative after conversion
+	FramePtr ReadNativeFrame(Source* source, unsigned int pts, FramePtr frameOrig, FramePtr frameNative);
+
+	MeasureScanner* m_Scanner;
+	const MeasureScanner::Job& m_Job;
+	int m_From;
+	int m_To;
+};
+
+FramePtr MeasureScanTask::ReadNativeFrame( Source* source, unsigned int pts, FramePtr frameOrig, FramePtr frameNative )
+{
+	if (source->ReadFrame(frameOrig, pts) != OK)
+	{
+		return FramePtr();
+	}
+
+	COLOR_FORMAT c = frameOrig->Format()->Color();
+	if (IsNativeFormat(c))
+	{
+		return frameOrig;
+	}
+
+	FormatPtr format = GetHostImpl()->NewFormat();
+	format->SetColor(GetNativeFormat(c));
+	format->SetWidth(frameOrig->Format()->Width());
+	format->SetHeight(frameOrig->Format()->Height());
+	format->PlaneSize(0);
+
+	if (*frameNative->Format() != *format)
+	{
+		frameNative->Reset();
+		frameNative->SetFormat(format);
+		frameNative->Allocate();
+	}
+	ColorConversion(*frameOrig, *frameNative);
+
+	return frameNative;
+}
+
+void MeasureScanTask::run()
+{
+	Measure* measure = m_Job.plugin->plugin->NewMeasure(m_Job.plugin->string);
+	if (!measure)
+	{
+		return;
+	}
+
+	int count = m_Job.sources2.size();
+	FramePtr frameOrig1 = GetHostImpl()->NewFrame();
+	FramePtr frameNative1 = GetHostImpl()->NewFrame();
+	FrameList framesOrig2, framesNative2;
+	QVector<MeasureOperation> ops(count*m_Job.measureNames.size());
+	for (int k=0; k<count; k++)
+	{
+		framesOrig2.append(GetHostImpl()->NewFrame());
+		framesNative2.append(GetHostImpl()->NewFrame());
+		for (int j=0; j<m_Job.measureNames.size(); j++)
+		{
+			MeasureOperation& op = ops[k*m_Job.measureNames.size()+j];
+			op.measureName = m_Job.measureNames.at(j);
+			op.distMapWidth = op.distMapHeight = 0;
+			op.distMapBlockSize = 1;
+		}
+	}
+
+	for (int i=m_From; i<m_To; i++)
+	{
+		if (!m_Scanner->WaitUntilIdle())
+		{
+			break;
+		}
+
+		unsigned int pts = m_Job.timeStamps.at(i);
+		FramePtr frame1 = ReadNativeFrame(m_Job.source1, pts, frameOrig1, frameNative1);
+		if (!frame1)
+		{
+			m_Scanner->FrameDone();
+			continue;
+		}
+
+		FrameList processed;
+		UintList sourceViewIds2;
+		QList<QList<MeasureOperation*> > operations;
+		for (int k=0; k<count; k++)
+		{
+			FramePtr frame2 = ReadNativeFrame(m_Job.sources2.at(k), pts, framesOrig2.at(k), framesNative2.at(k));
+			if (!frame2)
+			{
+				continue;
+			}
+
+			// Skip frames that have been measured during playback
+			QList<MeasureOperation*> opList;
+			bool cached = true;
+			for (int j=0; j<m_Job.measureNames.size(); j++)
+			{
+				MeasureOperation* op = &ops[k*m_Job.measureNames.size()+j];
+				opList.append(op);
+				cached = cached && m_Scanner->m_History->Lookup(m_Job.sourceViewId1,
+					m_Job.sourceViewIds2.at(k), *frame1, *frame2, *op);
+			}
+
+			if (!cached)
+			{
+				processed.append(frame2);
+				sourceViewIds2.append(m_Job.sourceViewIds2.at(k));
+				operations.append(opList);
+			}
+		}
+
+		if (processed.size())
+		{
+			measure->ProcessMultiple(frame1, processed, PLANE_Y, operations);
+
+			for (int k=0; k<operations.size(); k++)
+			{
+				for (int j=0; j<operations.at(k).size(); j++)
+				{
+					m_Scanner->m_History->Store(m_Job.sourceViewId1, sourceViewIds2.at(k),
+						*frame1, *processed.at(k), *operations.at(k).at(j));
+				}
+			}
+		}
+
+		m_Scanner->FrameDone();
+	}
+
+	m_Job.plugin->plugin->ReleaseMeasure(measure);
+}
+
+MeasureScanner::MeasureScanner(VideoViewList* vvList, QObject* parent) :
+	QObject(parent), m_VideoViewList(vvList), m_Control(vvList->GetControl()),
+	m_History(vvList->GetProcessThread()->GetMeasureHistory()), m_Total(0), m_Stop(false)
+{
+	m_Pool.setMaxThreadCount(qMax(QThread::idealThreadCount()-1, 1));
+
+	// Sources are deleted right after this signal
+	connect(m_VideoViewList, SIGNAL(VideoViewClosed(VideoView*)), this, SLOT(OnVideoViewClosed(VideoView*)));
+}
+
+MeasureScanner::~MeasureScanner()
+{
+	Stop();
+}
+
+void MeasureScanner::Start( const QList<MeasureItem>& requests )
+{
+	Stop();
+
+	for (int i=0; i<requests.size(); i++)
+	{
+		const MeasureItem& item = requests.at(i);
+		VideoView* vv1 = m_VideoViewList->find(item.sourceViewId1);
+		VideoView* vv2 = m_VideoViewList->find(item.sourceViewId2);
+		if (!VV_SOURCE(vv1) || !VV_SOURCE(vv2))
+		{
+			continue;
+		}
+
+		int j = 0;
+		for (; j<m_Jobs.size(); j++)
+		{
+			if (m_Jobs.at(j).plugin == item.plugin && m_Jobs.at(j).sourceViewId1 == item.sourceViewId1)
+			{
+				break;
+			}
+		}
+		if (j == m_Jobs.size())
+		{
+			Job job;
+			job.plugin = item.plugin;
+			job.sourceViewId1 = item.sourceViewId1;
+			job.source1 = vv1->GetSource();
+			job.source1->GetTimeStamps(job.timeStamps);
+			m_Jobs.append(job);
+		}
+
+		Job& job = m_Jobs[j];
+		if (!job.measureNames.contains(item.op.measureName))
+		{
+			job.measureNames.append(item.op.measureName);
+		}
+		if (!job.sourceViewIds2.contains(item.sourceViewId2))
+		{
+			job.sourceViewIds2.append(item.sourceViewId2);
+			job.sources2.append(vv2->GetSource());
+		}
+
+		if (!m_ViewIds.contains(item.sourceViewId1))
+		{
+			m_ViewIds.append(item.sourceViewId1);
+		}
+		if (!m_ViewIds.contains(item.sourceViewId2))
+		{
+			m_ViewIds.append(item.sourceViewId2);
+		}
+	}
+
+	m_Total = 0;
+	m_Done = 0;
+	for (int j=0; j<m_Jobs.size(); j++)
+	{
+		m_Total += m_Jobs.at(j).timeStamps.size();
+	}
+
+	// Tasks are queued in frame order, so results fill up from the beginning
+	for (int from=0; ; from+=SCAN_TASK_FRAMES)
+	{
+		bool queued = false;
+		for (int j=0; j<m_Jobs.size(); j++)
+		{
+			const Job& job = m_Jobs.at(j);
+			if (from < job.timeStamps.size())
+			{
+				int to = qMin(from+SCAN_TASK_FRAMES, job.timeStamps.size());
+				m_Pool.start(new MeasureScanTask(this, job, from, to));
+				queued = true;
+			}
+		}
+
+		if (!queued)
+		{
+			break;
+		}
+	}
+}
+
+void MeasureScanner::Stop()
+{
+	m_Mutex.lock();
+	m_Stop = true;
+	m_WaitCondition.wakeAll();
+	m_Mutex.unlock();
+
+	m_Pool.waitForDone();
+
+	m_Jobs.clear();
+	m_ViewIds.clear();
+	m_Total = 0;
+	m_Done = 0;
+	m_Stop = false;
+}
+
+bool MeasureScanner::IsRunning()
+{
+	return m_Total > 0 && m_Done < m_Total;
+}
+
+void MeasureScanner::GetProgress( int& done, int& total )
+{
+	done = m_Done;
+	total = m_Total;
+}
+
+bool MeasureScanner::WaitUntilIdle()
+{
+	QMutexLocker locker(&m_Mutex);
+	while (!m_Stop)
+	{
+		PlaybackControl::Status status;
+		m_Control->GetStatus(&status);
+		if (!status.isPlaying)
+		{
+			return true;
+		}
+
+		// Leave all cores to playback
+		m_WaitCondition.wait(&m_Mutex, 100);
+	}
+	return false;
+}
+
+void MeasureScanner::OnVideoViewClosed( VideoView* vv )
+{
+	if (m_ViewIds.contains(vv->GetID()))
+	{
+		Stop();
+	}
+}
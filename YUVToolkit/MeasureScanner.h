@@ -0,0 +1,73 @@
+#ifndef MEASURE_SCANNER_H
+#define MEASURE_SCANNER_H
+
+#include "YT_InterfaceImpl.h"
+#include <QtCore>
+
+class VideoViewList;
+class VideoView;
+class MeasureHistory;
+class MeasureScanTask;
+
+// Measures every frame of the compared videos in the background and stores
+// the results in MeasureHistory. Frames are read with Source::ReadFrame(..),
+// so playback position is not changed. Work is split in ranges of frames and
+// run on a thread pool that leaves one core for playback, and is paused
+// while video is playing.
+class MeasureScanner : public QObject
+{
+	Q_OBJECT;
+
+	friend class MeasureScanTask;
+public:
+	MeasureScanner(VideoViewList* vvList, QObject* parent = 0);
+	~MeasureScanner();
+
+	// Stop previous scan and measure all frames needed by requests
+	void Start(const QList<MeasureItem>& requests);
+	bool IsRunning();
+	// Number of reference frames scanned so far, and in total
+	void GetProgress(int& done, int& total);
+
+public slots:
+	void Stop();
+
+private slots:
+	void OnVideoViewClosed(VideoView*);
+
+private:
+	// Measures of one plugin between one reference and its processed videos
+	struct Job
+	{
+		PlugInInfo* plugin;
+		QStringList measureNames;
+
+		unsigned int sourceViewId1;
+		Source* source1;
+		QList<unsigned int> timeStamps;
+
+		UintList sourceViewIds2;
+		QList<Source*> sources2;
+	};
+
+	// Blocks while video is playing, returns false if scan is stopped
+	bool WaitUntilIdle();
+	bool IsStopped() {return m_Stop;}
+	void FrameDone() {m_Done.ref();}
+
+	VideoViewList* m_VideoViewList;
+	PlaybackControl* m_Control;
+	MeasureHistory* m_History;
+	QThreadPool m_Pool;
+
+	QList<Job> m_Jobs;
+	UintList m_ViewIds;
+	int m_Total;
+	QAtomicInt m_Done;
+	volatile bool m_Stop;
+
+	QMutex m_Mutex;
+	QWaitCondition m_WaitCondition;
+};
+
+#endif
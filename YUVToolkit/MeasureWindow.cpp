@@ -3,10 +3,14 @@
 #include "MeasureWindow.h"
 #include "VideoView.h"
 #include "VideoViewList.h"
+#include "ProcessThread.h"
+#include "MeasureHistory.h"
+#include "MeasureScanner.h"
 #include "Settings.h"
 
-MeasureResultsModel::MeasureResultsModel( QObject *parent, QList<MeasureItem>& results) :
-QAbstractTableModel(parent), m_Results(results)
+MeasureResultsModel::MeasureResultsModel( QObject *parent, QList<MeasureItem>& results, 
+	MeasureHistory* history, PlaybackControl* control) :
+QAbstractTableModel(parent), m_Results(results), m_History(history), m_Control(control)
 {
 	for (int i=0; i<m_Results.size(); i++)
 	{
@@ -74,6 +78,22 @@ QVariant MeasureResultsModel::data( const QModelIndex &index, int role /*= Qt::D
 			}
 		}
 
+		break;
+	case Qt::ToolTipRole:
+		{
+			unsigned int sourceViewId1 = m_SourceView1Ids.at(col);
+			unsigned int sourceViewId2 = m_SourceView2Ids.at(col);
+			const QString& measureName = m_MeasureNameRows.at(row/4);
+
+			for (int i=0; i<m_Results.size(); i++)
+			{
+				const MeasureItem& res = m_Results.at(i);
+				if (res.op.measureName == measureName && res.sourceViewId1 == sourceViewId1 && res.sourceViewId2 == sourceViewId2)
+				{
+					return AggregateToolTip(res, row % 4);
+				}
+			}
+		}
 		break;
 	case Qt::FontRole:
 		if (row%4 == 3)
@@ -99,15 +119,7 @@ QVariant MeasureResultsModel::headerData( int section, Qt::Orientation orientati
 	case Qt::DisplayRole:
 		{
 			if (orientation == Qt::Horizontal) {
-				switch (section)
-				{
-				case 0:
-					return QString("1");
-				case 1:
-					return QString("2");
-				case 2:
-					return QString("3");
-				}
+				return QString("%1").arg(section+1);
 			}else {
 				QString header = m_MeasureNameRows.at(section/4);
 				int plane = section%4;
@@ -167,15 +179,50 @@ Qt::ItemFlags MeasureResultsModel::flags( const QModelIndex & index ) const
 	return 0;
 }
 
+QString MeasureResultsModel::AggregateToolTip( const MeasureItem& res, int plane ) const
+{
+	// Aggregate over selected range, or whole video if nothing is selected
+	PlaybackControl::Status status;
+	m_Control->GetStatus(&status);
+	unsigned int ptsFrom = (status.selectionFrom != INVALID_PTS)?status.selectionFrom:0;
+	unsigned int ptsTo = (status.selectionTo != INVALID_PTS)?status.selectionTo:INVALID_PTS;
+
+	QList<double> percentiles;
+	percentiles << 5 << 50 << 95;
+
+	MeasureAggregate agg;
+	if (!m_History->Aggregate(res.op.measureName, res.sourceViewId1, res.sourceViewId2, 
+		plane, ptsFrom, ptsTo, percentiles, agg))
+	{
+		return QString();
+	}
+
+	QString str;
+	QTextStream stream(&str);
+	stream << "Mean: " << QString("%1").arg(agg.mean, 0, 'f', 2) << "\n"
+		<< "Min: " << QString("%1").arg(agg.min, 0, 'f', 2) << "\n"
+		<< "Max: " << QString("%1").arg(agg.max, 0, 'f', 2) << "\n";
+	if (agg.percentiles.size() == percentiles.size())
+	{
+		stream << "5%: " << QString("%1").arg(agg.percentiles.at(0), 0, 'f', 2) << "\n"
+			<< "Median: " << QString("%1").arg(agg.percentiles.at(1), 0, 'f', 2) << "\n"
+			<< "95%: " << QString("%1").arg(agg.percentiles.at(2), 0, 'f', 2) << "\n";
+	}
+	stream << "Frames: " << agg.count;
+	stream.flush();
+	return str;
+}
+
 void MeasureResultsModel::ResultsUpdated()
 {
-	emit dataChanged(index(0,0), index(8, 1));
+	emit dataChanged(index(0,0), index(rowCount()-1, columnCount()-1));
 }
 
 MeasureWindow::MeasureWindow(VideoViewList* vvList, QWidget *parent, Qt::WFlags flags) : 
 	QMainWindow(parent, flags), m_VideoViewList(vvList), m_ToolBar(new QToolBar(this)),
 	m_ResultsTable(new QTableView(this)), m_ResultsModel(NULL), m_UpdateTimer(NULL),
-	m_ShowDisortionMap(false)
+	m_ScanProgress(new QProgressBar(this)), m_Scanner(new MeasureScanner(vvList, this)),
+	m_ShowDisortionMap(false), m_MeasureAllFrames(false)
 {
 	m_ToolBar->setMovable(false);
 	m_ToolBar->setAllowedAreas(Qt::TopToolBarArea);
@@ -184,6 +231,11 @@ MeasureWindow::MeasureWindow(VideoViewList* vvList, QWidget *parent, Qt::WFlags
 	m_ToolBar->setFloatable(false);
 	addToolBar(Qt::TopToolBarArea, m_ToolBar);
 
+	// Progress of measuring all frames, only shown while it is running
+	statusBar()->setSizeGripEnabled(false);
+	statusBar()->addWidget(m_ScanProgress, 1);
+	statusBar()->hide();
+
 	setWindowFlags(Qt::Widget); 
 	setCentralWidget(m_ResultsTable);
 }
@@ -228,6 +280,24 @@ void MeasureWindow::OnTimer()
 		m_ResultsModel->ResultsUpdated();
 		m_ResultsTable->resizeColumnsToContents();
 	}
+
+	UpdateScanProgress();
+}
+
+void MeasureWindow::UpdateScanProgress()
+{
+	int done, total;
+	m_Scanner->GetProgress(done, total);
+	if (m_Scanner->IsRunning())
+	{
+		m_ScanProgress->setRange(0, total);
+		m_ScanProgress->setValue(done);
+		m_ScanProgress->setFormat("Measuring all frames %p%");
+		statusBar()->show();
+	}else
+	{
+		statusBar()->hide();
+	}
 }
 
 void MeasureWindow::UpdateRequest()
@@ -237,13 +307,23 @@ void MeasureWindow::UpdateRequest()
 	QSettings settings;
 	QStringList distMap = settings.SETTINGS_GET_DIST_MAP();
 	QStringList measureList = settings.SETTINGS_GET_MEASURES();
+	int distMapBlockSize = settings.SETTINGS_GET_DIST_MAP_BLOCK_SIZE();
+
+	// One measure instance per plugin is shared by all processed videos, 
+	// so it can compare them against the reference in one pass
+	QList<Measure*> measures;
+	const QList<PlugInInfo*>& plugins = GetHostImpl()->GetMeasurePluginList();
+	for (int i=0; i<plugins.size(); i++)
+	{
+		PlugInInfo* info = plugins.at(i);
+		measures.append(info->plugin->NewMeasure(info->string));
+	}
 
 	unsigned int sourceView1 = m_SourceList.at(0);
 	for (int j=1; j<m_SourceList.size(); j++)
 	{
 		unsigned int sourceView2 = m_SourceList.at(j);
 
-		const QList<PlugInInfo*>& plugins = GetHostImpl()->GetMeasurePluginList();
 		for (int i=0; i<plugins.size(); i++)
 		{
 			PlugInInfo* info = plugins.at(i);
@@ -251,7 +331,7 @@ void MeasureWindow::UpdateRequest()
 			MeasureItem req = {0};
 			
 			req.plugin = info;
-			req.measure = info->plugin->NewMeasure(info->string);
+			req.measure = measures.at(i);
 
 			const MeasureCapabilities& caps = req.measure->GetCapabilities();
 			for (int k=0; k<caps.measures.size(); k++)
@@ -278,6 +358,7 @@ void MeasureWindow::UpdateRequest()
 				req.sourceViewId1 = sourceView1;
 				req.sourceViewId2 = sourceView2;
 				req.showDistortionMap = showDistMap;
+				req.op.distMapBlockSize = distMapBlockSize;
 				req.viewId = viewId;
 
 				m_MeasureItemList.append(req);
@@ -285,9 +366,34 @@ void MeasureWindow::UpdateRequest()
 		}
 	}
 
-	m_ResultsModel = new MeasureResultsModel(this, m_MeasureItemList);
+	for (int i=0; i<measures.size(); i++)
+	{
+		bool used = false;
+		for (int k=0; k<m_MeasureItemList.size(); k++)
+		{
+			if (m_MeasureItemList.at(k).measure == measures.at(i))
+			{
+				used = true;
+				break;
+			}
+		}
+
+		if (!used)
+		{
+			plugins.at(i)->plugin->ReleaseMeasure(measures.at(i));
+		}
+	}
+
+	m_ResultsModel = new MeasureResultsModel(this, m_MeasureItemList, 
+		m_VideoViewList->GetProcessThread()->GetMeasureHistory(), m_VideoViewList->GetControl());
 	m_VideoViewList->GetProcessThread()->SetMeasureRequests(m_MeasureItemList);
 	m_ResultsTable->setModel(m_ResultsModel);
+
+	if (m_MeasureAllFrames)
+	{
+		m_Scanner->Start(m_MeasureItemList);
+	}
+	UpdateScanProgress();
 	// m_ResultsTable->setShowGrid(false);
 
 	m_UpdateTimer = new QTimer(this);
@@ -308,10 +414,6 @@ void MeasureWindow::UpdateRequest()
 void MeasureWindow::OnVideoViewSourceListChanged()
 {
 	m_SourceList = m_VideoViewList->GetSourceIDList();
-	while (m_SourceList.size()>3)
-	{
-		m_SourceList.removeLast();
-	}
 	
 	UpdateLabels();
 	if (isVisible())
@@ -328,6 +430,10 @@ void MeasureWindow::ClearAll()
 		SAFE_DELETE(m_UpdateTimer);
 	}
 
+	// Scanner uses the same sources, stop it before views are closed
+	m_Scanner->Stop();
+	UpdateScanProgress();
+
 	// Clear request list from process threads
 	m_VideoViewList->GetProcessThread()->SetMeasureRequests(QList<MeasureItem>());
 	m_ResultsTable->setModel(NULL);
@@ -398,5 +504,44 @@ void MeasureWindow::OnShowDistortionMap( bool b)
 
 void MeasureWindow::OnOptionChanged()
 {
+	QSettings settings;
+	m_VideoViewList->GetProcessThread()->GetFusedMeasure()->SetEnabled(settings.SETTINGS_GET_FUSED_MEASURE());
+
 	UpdateRequest();
 }
+
+void MeasureWindow::OnExportResults()
+{
+	QSettings settings;
+	QString path = QFileDialog::getSaveFileName(this, "Export Measure Results",
+		settings.SETTINGS_GET_FILE_PATH(), "Comma Separated Values (*.csv)");
+	if (path.isEmpty())
+	{
+		return;
+	}
+
+	if (!m_VideoViewList->GetProcessThread()->GetMeasureHistory()->Export(path))
+	{
+		QMessageBox::warning(this, "Error", "Failed to write measure results.");
+	}
+}
+
+void MeasureWindow::OnMeasureAllFrames( bool b )
+{
+	m_MeasureAllFrames = b;
+
+	if (isVisible())
+	{
+		if (b)
+		{
+			m_Scanner->Start(m_MeasureItemList);
+		}else
+		{
+			m_Scanner->Stop();
+		}
+		UpdateScanProgress();
+	}
+
+	QSettings settings;
+	settings.SETTINGS_SET_MEASURE_ALL_FRAMES(b);
+}
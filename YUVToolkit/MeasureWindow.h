@@ -6,6 +6,8 @@
 #include <QtCore>
 class VideoViewList;
 class VideoView;
+class MeasureHistory;
+class MeasureScanner;
 
 #include <QAbstractTableModel>
 
@@ -16,9 +18,12 @@ class MeasureResultsModel : public QAbstractTableModel
 	QStringList m_MeasureNameRows;
 	QList<unsigned int> m_SourceView1Ids;
 	QList<unsigned int> m_SourceView2Ids;
-	
+	MeasureHistory* m_History;
+	PlaybackControl* m_Control;
+
+	QString AggregateToolTip(const MeasureItem& res, int plane) const;
 public:
-	MeasureResultsModel(QObject *parent, QList<MeasureItem>& );
+	MeasureResultsModel(QObject *parent, QList<MeasureItem>&, MeasureHistory*, PlaybackControl*);
 	int rowCount(const QModelIndex &parent = QModelIndex()) const ;
 	int columnCount(const QModelIndex &parent = QModelIndex()) const;
 	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
@@ -37,10 +42,13 @@ class MeasureWindow : public QMainWindow
 	QTableView* m_ResultsTable;
 	MeasureResultsModel* m_ResultsModel;
 	QTimer* m_UpdateTimer;
+	QProgressBar* m_ScanProgress;
+	MeasureScanner* m_Scanner;
 
 	UintList m_SourceList;
 	QList<MeasureItem> m_MeasureItemList;
 	bool m_ShowDisortionMap;
+	bool m_MeasureAllFrames;
 public:
 	MeasureWindow(VideoViewList* vvList, QWidget *parent = 0, Qt::WFlags flags = 0);
 	~MeasureWindow();
@@ -55,10 +63,13 @@ protected:
 	void ClearAll();
 	void UpdateRequest();
 	void UpdateLabels();
+	void UpdateScanProgress();
 public slots:
 	void OnVideoViewSourceListChanged();
 	void OnShowDistortionMap(bool);
 	void OnOptionChanged();
+	void OnExportResults();
+	void OnMeasureAllFrames(bool);
 private slots:
 	void on_button_Options_clicked();
 	void OnTimer();
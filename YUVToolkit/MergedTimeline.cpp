@@ -0,0 +1,99 @@
+#include "MergedTimeline.h"
+
+MergedTimeline::MergedTimeline()
+{
+	Clear();
+}
+
+void MergedTimeline::Clear()
+{
+	m_Sources.clear();
+	m_TimeStamps.clear();
+	m_Counts.clear();
+
+	m_TimeStamps.append(0);
+	m_Counts.append(1);
+}
+
+void MergedTimeline::Update( unsigned int viewID, const QList<unsigned int>& timeStamps )
+{
+	Remove(viewID);
+
+	QVector<unsigned int> sorted = timeStamps.toVector();
+	for (int i=1; i<sorted.size(); i++)
+	{
+		if (sorted.at(i) < sorted.at(i-1))
+		{
+			// Source did not return them in order
+			qSort(sorted.begin(), sorted.end());
+			break;
+		}
+	}
+
+	Merge(sorted, 1);
+	m_Sources.insert(viewID, sorted);
+}
+
+void MergedTimeline::Remove( unsigned int viewID )
+{
+	QMap<unsigned int, QVector<unsigned int> >::iterator it = m_Sources.find(viewID);
+	if (it != m_Sources.end())
+	{
+		Merge(it.value(), -1);
+		m_Sources.erase(it);
+	}
+}
+
+void MergedTimeline::Merge( const QVector<unsigned int>& timeStamps, int count )
+{
+	QVector<unsigned int> merged;
+	QVector<unsigned int> counts;
+	merged.reserve(m_TimeStamps.size()+(count>0?timeStamps.size():0));
+	counts.reserve(merged.capacity());
+
+	int i = 0, j = 0;
+	while (i<m_TimeStamps.size() || j<timeStamps.size())
+	{
+		unsigned int ts;
+		int c = 0;
+		if (j>=timeStamps.size() || (i<m_TimeStamps.size() && m_TimeStamps.at(i) <= timeStamps.at(j)))
+		{
+			ts = m_TimeStamps.at(i);
+			c = m_Counts.at(i);
+			i++;
+		}else
+		{
+			ts = timeStamps.at(j);
+		}
+
+		// Duplicates in source are counted each time
+		while (j<timeStamps.size() && timeStamps.at(j) == ts)
+		{
+			c += count;
+			j++;
+		}
+
+		if (c > 0)
+		{
+			merged.append(ts);
+			counts.append(c);
+		}
+	}
+
+	m_TimeStamps = merged;
+	m_Counts = counts;
+}
+
+int MergedTimeline::Index( unsigned int pts ) const
+{
+	QVector<unsigned int>::const_iterator it =
+		qUpperBound(m_TimeStamps.constBegin(), m_TimeStamps.constEnd(), pts);
+	int index = (it-m_TimeStamps.constBegin())-1;
+	return qMax(index, 0);
+}
+
+unsigned int MergedTimeline::Step( unsigned int pts, int step ) const
+{
+	int index = qBound(0, Index(pts)+step, m_TimeStamps.size()-1);
+	return m_TimeStamps.at(index);
+}
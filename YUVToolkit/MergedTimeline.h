@@ -0,0 +1,41 @@
+#ifndef MERGED_TIMELINE_H
+#define MERGED_TIMELINE_H
+
+#include <QtCore>
+
+// Sorted union of time stamps of all sources, kept in one contiguous array
+// with the number of sources sharing each time stamp. Adding or removing a
+// source is a linear merge with its own sorted list, so nothing is sorted
+// again when a source is opened, changed or closed. Time stamp 0 is always
+// included.
+class MergedTimeline
+{
+public:
+	MergedTimeline();
+
+	// Replaces time stamps of source
+	void Update(unsigned int viewID, const QList<unsigned int>& timeStamps);
+	void Remove(unsigned int viewID);
+	void Clear();
+
+	int Size() const {return m_TimeStamps.size();}
+	unsigned int At(int i) const {return m_TimeStamps.at(i);}
+	unsigned int First() const {return m_TimeStamps.first();}
+	unsigned int Last() const {return m_TimeStamps.last();}
+
+	// Index of last time stamp <= pts
+	int Index(unsigned int pts) const;
+	// Time stamp step entries away from the one shown at pts, clamped to
+	// first and last one
+	unsigned int Step(unsigned int pts, int step) const;
+
+private:
+	// Adds (count 1) or removes (count -1) one occurrence of each time stamp
+	void Merge(const QVector<unsigned int>& timeStamps, int count);
+
+	QVector<unsigned int> m_TimeStamps;
+	QVector<unsigned int> m_Counts;
+	QMap<unsigned int, QVector<unsigned int> > m_Sources;
+};
+
+#endif
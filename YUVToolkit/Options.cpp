@@ -7,6 +7,9 @@
 #include <shobjidl.h>
 #endif
 
+// Same order as items of combo_Block_Size
+static const int s_BlockSizes[] = {1, 4, 8, 16, 64};
+
 Options::Options( QWidget *parent, Qt::WFlags flags ) : QDialog(parent, flags)
 {
 	ui.setupUi(this);
@@ -41,6 +44,16 @@ Options::Options( QWidget *parent, Qt::WFlags flags ) : QDialog(parent, flags)
 	QSettings settings;
 	ui.check_Auto_Resize->setChecked(settings.SETTINGS_GET_AUTO_RESIZE());
 	ui.check_Playback_Loop->setChecked(settings.SETTINGS_GET_PLAYBACK_LOOP());
+	ui.check_Fused_Measure->setChecked(settings.SETTINGS_GET_FUSED_MEASURE());
+
+	int blockSize = settings.SETTINGS_GET_DIST_MAP_BLOCK_SIZE();
+	for (int i=0; i<(int)(sizeof(s_BlockSizes)/sizeof(s_BlockSizes[0])); i++)
+	{
+		if (s_BlockSizes[i] == blockSize)
+		{
+			ui.combo_Block_Size->setCurrentIndex(i);
+		}
+	}
 
 	QStringList enabledMeasures = settings.SETTINGS_GET_MEASURES();
 	QStringList distMaps = settings.SETTINGS_GET_DIST_MAP();
@@ -112,6 +125,8 @@ void Options::OnAccepted()
 	SET_SETTING(MEASURES, measureList);
 	SET_SETTING(DIST_MAP, distMapList);
 	SET_SETTING(PLAYBACK_LOOP, ui.check_Playback_Loop->isChecked());
+	SET_SETTING(DIST_MAP_BLOCK_SIZE, s_BlockSizes[ui.combo_Block_Size->currentIndex()]);
+	SET_SETTING(FUSED_MEASURE, ui.check_Fused_Measure->isChecked());
 
 	emit OptionChanged();
 }
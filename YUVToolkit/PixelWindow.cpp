@@ -0,0 +1,324 @@
+#include "YT_Interface.h"
+
+#include "PixelWindow.h"
+#include "VideoView.h"
+#include "VideoViewList.h"
+#include "RendererWidget.h"
+#include "Layout.h"
+
+class PixelCanvas : public QWidget
+{
+public:
+	PixelCanvas(PixelWindow* window) : QWidget(window), m_Window(window) {}
+protected:
+	void paintEvent(QPaintEvent*)
+	{
+		QPainter painter(this);
+		m_Window->PaintRegions(painter);
+	}
+private:
+	PixelWindow* m_Window;
+};
+
+// BT.601, video range
+static QRgb YuvToRgb(int y, int u, int v)
+{
+	int c = 298*(y-16);
+	int d = u-128;
+	int e = v-128;
+	return qRgb(qBound(0, (c+409*e+128)>>8, 255),
+		qBound(0, (c-100*d-208*e+128)>>8, 255),
+		qBound(0, (c+516*d+128)>>8, 255));
+}
+
+// Reads region.size x region.size pixels around (centerX, centerY) of frame,
+// chroma of each pixel from the chroma sample covering it
+static void SampleRegion(const Frame& frame, int centerX, int centerY, PixelRegion& region)
+{
+	FormatPtr format = frame.Format();
+	COLOR_FORMAT color = format->Color();
+	int width = format->Width();
+	int height = format->Height();
+	int size = region.size;
+	int left = centerX-size/2;
+	int top = centerY-size/2;
+
+	region.image = QImage(size, size, QImage::Format_RGB32);
+	region.image.fill(qRgb(128, 128, 128));
+	for (int p=0; p<3; p++)
+	{
+		region.values[p].fill(-1, size*size);
+	}
+
+	if (color == XRGB32)
+	{
+		region.planes = 0;
+		for (int r=0; r<size; r++)
+		{
+			int y = top+r;
+			if (y<0 || y>=height)
+			{
+				continue;
+			}
+
+			const quint32* row = (const quint32*)(frame.Data(0)+y*format->Stride(0));
+			for (int c=0; c<size; c++)
+			{
+				int x = left+c;
+				if (x<0 || x>=width)
+				{
+					continue;
+				}
+
+				QRgb rgb = row[x]|0xFF000000;
+				region.image.setPixel(c, r, rgb);
+				region.values[0][r*size+c] = qRed(rgb);
+				region.values[1][r*size+c] = qGreen(rgb);
+				region.values[2][r*size+c] = qBlue(rgb);
+			}
+		}
+		return;
+	}
+
+	// YV formats keep V before U
+	bool swapUV = (color == YV12 || color == YV16 || color == YV24);
+	region.planes = (color == Y800)?1:3;
+	for (int p=0; p<region.planes; p++)
+	{
+		int plane = (swapUV && p>0)?3-p:p;
+		int planeWidth = format->PlaneWidth(plane);
+		int planeHeight = format->PlaneHeight(plane);
+		const unsigned char* data = frame.Data(plane);
+		int stride = format->Stride(plane);
+		if (!data || !planeWidth || !planeHeight)
+		{
+			continue;
+		}
+
+		for (int r=0; r<size; r++)
+		{
+			int y = top+r;
+			if (y<0 || y>=height)
+			{
+				continue;
+			}
+
+			const unsigned char* row = data+(y*planeHeight/height)*stride;
+			for (int c=0; c<size; c++)
+			{
+				int x = left+c;
+				if (x>=0 && x<width)
+				{
+					region.values[p][r*size+c] = row[x*planeWidth/width];
+				}
+			}
+		}
+	}
+
+	for (int i=0; i<size*size; i++)
+	{
+		int y = region.values[0].at(i);
+		if (y<0)
+		{
+			continue;
+		}
+
+		int u = (region.planes==3)?region.values[1].at(i):128;
+		int v = (region.planes==3)?region.values[2].at(i):128;
+		region.image.setPixel(i%size, i/size, YuvToRgb(y, u<0?128:u, v<0?128:v));
+	}
+}
+
+PixelWindow::PixelWindow(VideoViewList* vvList, RendererWidget* renderWidget, QWidget *parent, Qt::WFlags flags) :
+	QMainWindow(parent, flags), m_VideoViewList(vvList), m_RendererWidget(renderWidget),
+	m_ToolBar(new QToolBar(this)), m_ZoomCombo(new QComboBox(this)), m_UpdateTimer(NULL),
+	m_Position(-1, -1), m_LastPosition(-1, -1)
+{
+	m_ToolBar->setMovable(false);
+	m_ToolBar->setAllowedAreas(Qt::TopToolBarArea);
+	m_ToolBar->setIconSize(QSize(22, 22));
+	m_ToolBar->setFloatable(false);
+	addToolBar(Qt::TopToolBarArea, m_ToolBar);
+
+	m_ZoomCombo->addItem("2x");
+	m_ZoomCombo->addItem("4x");
+	m_ZoomCombo->addItem("8x");
+	m_ZoomCombo->setCurrentIndex(2);
+	m_ToolBar->addWidget(m_ZoomCombo);
+	connect(m_ZoomCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(OnZoomChanged(int)));
+
+	m_Canvas = new PixelCanvas(this);
+	m_Canvas->setBackgroundRole(QPalette::Base);
+	m_Canvas->setAutoFillBackground(true);
+
+	setWindowFlags(Qt::Widget);
+	setCentralWidget(m_Canvas);
+}
+
+PixelWindow::~PixelWindow()
+{
+}
+
+QSize PixelWindow::sizeHint() const
+{
+	return QSize(2*PIXEL_TILE_SIZE+24, 2*PIXEL_TILE_SIZE+100);
+}
+
+void PixelWindow::showEvent( QShowEvent *event )
+{
+	m_LastFrames.clear();
+
+	// Pointer is polled, the video widget does not track it when no
+	// button is pressed
+	m_UpdateTimer = new QTimer(this);
+	m_UpdateTimer->setInterval(20);
+	connect(m_UpdateTimer, SIGNAL(timeout()), this, SLOT(OnTimer()));
+	m_UpdateTimer->start();
+
+	OnTimer();
+}
+
+void PixelWindow::hideEvent( QHideEvent *event )
+{
+	if (m_UpdateTimer)
+	{
+		m_UpdateTimer->stop();
+		SAFE_DELETE(m_UpdateTimer);
+	}
+
+	m_Regions.clear();
+}
+
+bool PixelWindow::GetPointerPosition( QPoint& pt )
+{
+	VideoView* vv = m_RendererWidget->layout->FindVideoAtMoisePosition();
+	if (!vv)
+	{
+		return false;
+	}
+
+	QPoint pos = m_RendererWidget->mapFromGlobal(QCursor::pos());
+	const QRect& src = vv->srcRect;
+	const QRect& dst = vv->dstRect;
+	if (!dst.contains(pos) || dst.width()<=0 || dst.height()<=0)
+	{
+		return false;
+	}
+
+	pt.setX(src.left()+(pos.x()-dst.left())*src.width()/dst.width());
+	pt.setY(src.top()+(pos.y()-dst.top())*src.height()/dst.height());
+	return true;
+}
+
+void PixelWindow::OnTimer()
+{
+	QPoint pt;
+	if (GetPointerPosition(pt))
+	{
+		m_Position = pt;
+	}
+
+	QList<QPair<const Frame*, unsigned int> > frames;
+	for (int i=0; i<m_VideoViewList->size(); i++)
+	{
+		FramePtr frame = VV_LASTFRAME(m_VideoViewList->at(i));
+		frames.append(qMakePair((const Frame*)frame.data(), frame?frame->PTS():INVALID_PTS));
+	}
+
+	if (m_Position == m_LastPosition && frames == m_LastFrames)
+	{
+		return;
+	}
+	m_LastPosition = m_Position;
+	m_LastFrames = frames;
+
+	UpdateRegions();
+}
+
+void PixelWindow::OnZoomChanged( int )
+{
+	UpdateRegions();
+}
+
+void PixelWindow::UpdateRegions()
+{
+	int zoom = 2<<m_ZoomCombo->currentIndex();
+
+	m_Regions.clear();
+	for (int i=0; i<m_VideoViewList->size(); i++)
+	{
+		VideoView* vv = m_VideoViewList->at(i);
+		FramePtr frame = VV_LASTFRAME(vv);
+
+		PixelRegion region;
+		region.title = vv->title();
+		region.center = QPoint(-1, -1);
+		region.size = PIXEL_TILE_SIZE/zoom;
+		region.planes = 0;
+		if (frame && m_Position.x()>=0 && vv->width()>0 && vv->height()>0)
+		{
+			// Frames scaled up by renderer, like distortion maps, are
+			// smaller than the video
+			int x = m_Position.x()*frame->Format()->Width()/vv->width();
+			int y = m_Position.y()*frame->Format()->Height()/vv->height();
+
+			region.center = m_Position;
+			SampleRegion(*frame, x, y, region);
+		}
+		m_Regions.append(region);
+	}
+
+	m_Canvas->update();
+}
+
+void PixelWindow::PaintRegions( QPainter& painter )
+{
+	int textHeight = painter.fontMetrics().height();
+	int tileWidth = PIXEL_TILE_SIZE+8;
+	int tileHeight = PIXEL_TILE_SIZE+3*textHeight+12;
+	int columns = qMax(m_Canvas->width()/tileWidth, 1);
+
+	for (int i=0; i<m_Regions.size(); i++)
+	{
+		const PixelRegion& region = m_Regions.at(i);
+		int left = (i%columns)*tileWidth+4;
+		int top = (i/columns)*tileHeight+4;
+
+		QRect rcImage(left, top, PIXEL_TILE_SIZE, PIXEL_TILE_SIZE);
+		QRect rcText(left, top+PIXEL_TILE_SIZE+2, PIXEL_TILE_SIZE, textHeight);
+		painter.setPen(palette().color(QPalette::Text));
+		painter.drawText(rcText, Qt::AlignLeft, painter.fontMetrics().elidedText(region.title, Qt::ElideRight, PIXEL_TILE_SIZE));
+
+		if (region.center.x()<0)
+		{
+			painter.fillRect(rcImage, palette().color(QPalette::Window));
+			continue;
+		}
+
+		// Scaled without smoothing, each pixel is a square
+		painter.drawImage(rcImage, region.image);
+
+		int zoom = PIXEL_TILE_SIZE/region.size;
+		int c = region.size/2;
+		painter.setPen(Qt::black);
+		painter.drawRect(left+c*zoom-1, top+c*zoom-1, zoom+1, zoom+1);
+		painter.setPen(Qt::white);
+		painter.drawRect(left+c*zoom, top+c*zoom, zoom-1, zoom-1);
+
+		QString values;
+		int index = c*region.size+c;
+		const char* names = (region.planes == 0)?"RGB":"YUV";
+		int count = (region.planes == 1)?1:3;
+		for (int p=0; p<count; p++)
+		{
+			int value = region.values[p].at(index);
+			QTextStream(&values) << names[p] << " " << (value<0?QString("-"):QString::number(value)) << "  ";
+		}
+
+		painter.setPen(palette().color(QPalette::Text));
+		rcText.translate(0, textHeight);
+		painter.drawText(rcText, Qt::AlignLeft, QString("(%1, %2)").arg(region.center.x()).arg(region.center.y()));
+		rcText.translate(0, textHeight);
+		painter.drawText(rcText, Qt::AlignLeft, values.trimmed());
+	}
+}
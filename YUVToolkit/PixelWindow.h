@@ -0,0 +1,62 @@
+#ifndef PIXEL_WINDOW_H
+#define PIXEL_WINDOW_H
+
+#include "YT_Interface.h"
+#include <QtGui>
+#include <QtCore>
+
+class VideoViewList;
+class RendererWidget;
+
+// Size of the zoomed region of each view, in screen pixels
+#define PIXEL_TILE_SIZE 128
+
+// Pixels of one view around the position under the mouse pointer
+struct PixelRegion
+{
+	QString title;
+	QPoint center;     // in video, -1 if view shows no frame
+	int size;          // size x size pixels, center one in the middle
+	int planes;        // 3 for YUV, 1 for Y800, 0 for RGB
+	QImage image;      // size x size, as displayed
+	QVector<int> values[3]; // per plane, -1 outside of frame
+};
+
+// Shows pixels under the mouse pointer zoomed in, with their YUV values,
+// for all views at the same video position. Only the pixels shown are read
+// from the last frame of each view, the render path is not involved.
+class PixelWindow : public QMainWindow
+{
+	Q_OBJECT;
+	VideoViewList* m_VideoViewList;
+	RendererWidget* m_RendererWidget;
+
+	QToolBar* m_ToolBar;
+	QComboBox* m_ZoomCombo;
+	QWidget* m_Canvas;
+	QTimer* m_UpdateTimer;
+
+	QPoint m_Position; // in video, stays when pointer leaves the videos
+	// Sampled last time, regions are read again only if one has changed
+	QPoint m_LastPosition;
+	QList<QPair<const Frame*, unsigned int> > m_LastFrames;
+	QList<PixelRegion> m_Regions;
+public:
+	PixelWindow(VideoViewList* vvList, RendererWidget* renderWidget, QWidget *parent = 0, Qt::WFlags flags = 0);
+	~PixelWindow();
+
+	QSize sizeHint() const;
+	void PaintRegions(QPainter& painter);
+protected:
+	void showEvent(QShowEvent *event);
+	void hideEvent(QHideEvent *event);
+
+	// Position in video under the mouse pointer, false if not over a video
+	bool GetPointerPosition(QPoint& pt);
+	void UpdateRegions();
+private slots:
+	void OnTimer();
+	void OnZoomChanged(int);
+};
+
+#endif
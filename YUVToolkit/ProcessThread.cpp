@@ -2,8 +2,10 @@
 #include "ProcessThread.h"
 #include "ColorMap.h"
 #include "Settings.h"
+#include "ParallelFor.h"
 
-ProcessThread::ProcessThread(PlaybackControl* c) : m_Control(c), m_IsLastFrame(false), m_DistMapFramePool(NULL)
+ProcessThread::ProcessThread(PlaybackControl* c) : m_Control(c), m_IsLastFrame(false), m_DistMapFramePool(NULL),
+	m_StatisticsEnabled(false)
 {
 	moveToThread(this);
 }
@@ -20,7 +22,7 @@ void ProcessThread::run()
 	qRegisterMetaType<RectList>("RectList");
 	qRegisterMetaType<FrameListPtr>("FrameListPtr");
 
-	m_DistMapFramePool = GetHostImpl()->NewFramePool(8, true);
+	m_DistMapFramePool = GetHostImpl()->NewFramePool(DIST_MAP_POOL_SIZE, true);
 
 	QTimer* timer = new QTimer(this);
 	connect(timer, SIGNAL(timeout()), this, SLOT(ProcessFrameQueue()), Qt::DirectConnection);
@@ -33,6 +35,10 @@ void ProcessThread::run()
 
 	GetHostImpl()->ReleaseFramePool(m_DistMapFramePool);
 	m_DistMapFramePool = NULL;
+
+	m_MutexTransform.lock();
+	ReleaseTransformFramePools(true);
+	m_MutexTransform.unlock();
 }
 
 void ProcessThread::Stop()
@@ -41,11 +47,13 @@ void ProcessThread::Stop()
 	wait();
 
 	m_SourceFrames.clear();
+	RebuildSceneIndex();
 }
 
 void ProcessThread::Start()
 {
 	m_LastPTS = INVALID_PTS;
+	RebuildSceneIndex();
 	m_IsLastFrame = false;
 	start();
 }
@@ -71,6 +79,8 @@ void ProcessThread::ProcessFrameQueue()
 			m_LastPTS = status.seekingPTS;
 			m_Control->OnFrameProcessed(status.seekingPTS, status.seekingPTS);
 			
+			ProcessTransforms(scene);
+			ProcessStatistics(scene);
 			ProcessMeasures(scene, status.plane);
 
 			m_IsLastFrame = IsLastScene(scene);
@@ -79,6 +89,7 @@ void ProcessThread::ProcessFrameQueue()
 		{
 			WARNING_LOG("ProcessThread seeking %d ... %d found", status.seekingPTS, scene->size());
 		}
+		RebuildSceneIndex();
 				
 		emit sceneReady(scene, status.seekingPTS, true);
 
@@ -97,17 +108,15 @@ void ProcessThread::ProcessFrameQueue()
 
 	while (true)
 	{
-		unsigned int ptsNext = 0;
+		unsigned int ptsNext = GetNextPTS();
 		if (m_LastPTS == INVALID_PTS)
 		{
-			ptsNext = GetFirstPTS(sourceViewIds);
 			if (ptsNext == INVALID_PTS)
 			{
 				return;
 			}
 		}else
 		{
-			ptsNext = GetNextPTS(sourceViewIds, m_LastPTS);
 			if (ptsNext == INVALID_PTS)
 			{
 				if (m_IsLastFrame)
@@ -137,48 +146,27 @@ void ProcessThread::ProcessFrameQueue()
 			}
 		}
 
-		FrameListPtr scene; 
+		if (!AdvanceQueues(ptsNext))
+		{
+			// some frames missing
+			return;
+		}
+
+		// Head of each queue is the frame shown at ptsNext
+		FrameListPtr scene = GetHostImpl()->GetFrameList();
 		QMapIterator<unsigned int, FrameList > i(m_SourceFrames);
 		while (i.hasNext()) 
 		{
 			i.next();
-		
-			unsigned int viewID = i.key();
-			FrameList& frameList = m_SourceFrames[viewID];
-
-			FramePtr frameToRender;
-			while (frameList.size()>0)
-			{
-				FramePtr frame = frameList.first();
-				unsigned int _next = frame->Info(NEXT_PTS).toUInt();
-				if (_next <= ptsNext)
-				{
-					frameList.removeFirst();
-					continue;
-				}
-
-				frameToRender = frame;
-				break;
-			}
-
-			if (frameToRender)
-			{
-				if (!scene)
-				{
-					scene = GetHostImpl()->GetFrameList();
-				}
-				scene->append(frameToRender);
-			}else
-			{
-				// some frames missing
-				return;
-			}
+			scene->append(i.value().first());
 		}
 
 		if (scene && scene->size()>0)
 		{
 			m_Control->OnFrameProcessed(ptsNext, INVALID_PTS);
 			
+			ProcessTransforms(scene);
+			ProcessStatistics(scene);
 			ProcessMeasures(scene, status.plane);
 
 			emit sceneReady(scene, ptsNext, false);
@@ -212,6 +200,10 @@ void ProcessThread::ReceiveFrame( FramePtr frame )
 
 	FrameList& frameList = m_SourceFrames[viewID];
 	frameList.append(frame);
+	if (frameList.size() == 1)
+	{
+		UpdateSceneIndex(viewID, m_LastPTS);
+	}
 }
 
 bool ProcessThread::CleanAndCheckQueue(UintList& sourceViewIds)
@@ -224,6 +216,7 @@ bool ProcessThread::CleanAndCheckQueue(UintList& sourceViewIds)
 		unsigned int viewID = i.key();
 		if (sourceViewIds.indexOf(viewID) == -1)
 		{
+			RemoveFromSceneIndex(viewID);
 			i.remove();
 		}
 	}
@@ -310,61 +303,107 @@ void ProcessThread::SetSources( UintList sourceViewIDs )
 	m_SourceViewIds = sourceViewIDs;
 }
 
-unsigned int ProcessThread::GetFirstPTS( UintList sourceViewIds )
+unsigned int ProcessThread::GetNextPTS()
 {
-	unsigned int ptsFirst = INVALID_PTS;
-	QMapIterator<unsigned int, FrameList > i(m_SourceFrames);
-	while (i.hasNext())
+	if (m_SceneIndex.isEmpty() || m_SceneIndexKeys.size() < m_SourceFrames.size())
 	{
-		i.next();
+		return INVALID_PTS;
+	}
+
+	return m_SceneIndex.constBegin().key();
+}
+
+bool ProcessThread::AdvanceQueues( unsigned int pts )
+{
+	// Only views at the front of the index change by pts, others keep 
+	// showing their first frame
+	while (!m_SceneIndex.isEmpty() && m_SceneIndex.constBegin().key() <= pts)
+	{
+		unsigned int viewID = m_SceneIndex.constBegin().value();
+		m_SceneIndex.erase(m_SceneIndex.begin());
+		m_SceneIndexKeys.remove(viewID);
 
-		unsigned int viewID = i.key();
 		FrameList& frameList = m_SourceFrames[viewID];
+		while (frameList.size()>0 && frameList.first()->Info(NEXT_PTS).toUInt() <= pts)
+		{
+			frameList.removeFirst();
+		}
 
 		if (frameList.size() == 0)
 		{
-			return INVALID_PTS;
+			// Some keys were moved to pts already, compute them from
+			// m_LastPTS again and wait for more frames
+			RebuildSceneIndex();
+			return false;
 		}
 
-		FramePtr frame = frameList.first();
-		unsigned int pts = frame->PTS();
-		ptsFirst = qMin<unsigned int>(pts, ptsFirst);
+		UpdateSceneIndex(viewID, pts);
 	}
-	return ptsFirst;
+
+	return true;
 }
 
-unsigned int ProcessThread::GetNextPTS( UintList sourceViewIds, unsigned int currentPTS )
+void ProcessThread::UpdateSceneIndex( unsigned int viewID, unsigned int currentPTS )
 {
-	unsigned int ptsNext = INVALID_PTS;
-	QMapIterator<unsigned int, FrameList > i(m_SourceFrames);
-	while (i.hasNext())
+	RemoveFromSceneIndex(viewID);
+
+	const FrameList& frameList = m_SourceFrames[viewID];
+	if (frameList.size() == 0)
 	{
-		i.next();
+		return;
+	}
 
-		unsigned int viewID = i.key();
-		FrameList& frameList = m_SourceFrames[viewID];
+	// First frame has not been shown yet, or else it changes at its next PTS
+	FramePtr frame = frameList.first();
+	unsigned int key = frame->PTS();
+	if (currentPTS != INVALID_PTS && key <= currentPTS)
+	{
+		key = frame->Info(NEXT_PTS).toUInt();
+	}
 
-		if (frameList.size() == 0)
-		{
-			return INVALID_PTS;
-		}
+	m_SceneIndex.insert(key, viewID);
+	m_SceneIndexKeys.insert(viewID, key);
+}
 
-		FramePtr frame = frameList.first();
-		unsigned int pts = frame->PTS();
-		if (pts<=currentPTS)
-		{
-			pts = frame->Info(NEXT_PTS).toUInt();
-		}
-		
-		ptsNext = qMin<unsigned int>(pts, ptsNext);
+void ProcessThread::RemoveFromSceneIndex( unsigned int viewID )
+{
+	QMap<unsigned int, unsigned int>::iterator it = m_SceneIndexKeys.find(viewID);
+	if (it != m_SceneIndexKeys.end())
+	{
+		m_SceneIndex.remove(it.value(), viewID);
+		m_SceneIndexKeys.erase(it);
+	}
+}
+
+void ProcessThread::RebuildSceneIndex()
+{
+	m_SceneIndex.clear();
+	m_SceneIndexKeys.clear();
+
+	QMapIterator<unsigned int, FrameList > i(m_SourceFrames);
+	while (i.hasNext())
+	{
+		i.next();
+		UpdateSceneIndex(i.key(), m_LastPTS);
 	}
-	return ptsNext;
 }
 
 void ProcessThread::SetMeasureRequests(const QList<MeasureItem>& requests )
 {
 	QMutexLocker locker(&m_MutexMeasure);
 	m_MeasureRequests = requests;
+
+	// Source thread of each processed video compares with first reference
+	QMap<unsigned int, unsigned int> references;
+	for (int i=0; i<requests.size(); i++)
+	{
+		const MeasureItem& item = requests.at(i);
+		if (!references.contains(item.sourceViewId2))
+		{
+			references.insert(item.sourceViewId2, item.sourceViewId1);
+		}
+	}
+	m_FusedMeasure.SetReferences(references);
 }
 
 void ProcessThread::GetMeasureResults( QList<MeasureItem>& results )
@@ -390,43 +429,169 @@ void ProcessThread::GetMeasureResults( QList<MeasureItem>& results )
 	}
 }
 
-void ProcessThread::ProcessMeasures( FrameListPtr scene, YUV_PLANE plane )
+void ProcessThread::SetTransformRequests( const QList<TransformItem>& requests )
 {
-	QMutexLocker locker(&m_MutexMeasure);
+	QMutexLocker locker(&m_MutexTransform);
+	m_TransformRequests = requests;
+}
 
-	if (!m_MeasureRequests.size())
+// Transforms of one scene that can run at once, each one on its own
+// worker thread
+struct TransformJobs
+{
+	QList<Transform*> transforms;
+	FrameList sources1;
+	FrameList sources2;
+	FrameList results;
+	RESULT* res;
+
+	void operator()(int from, int to)
 	{
-		return;
+		for (int i=from; i<to; i++)
+		{
+			res[i] = transforms.at(i)->Process(sources1.at(i), sources2.at(i), results.at(i));
+		}
 	}
+};
 
-	PlugInInfo* plugin = 0;
-	Measure* measure = 0;
-	unsigned int sourceViewId1 = 0;
-	unsigned int sourceViewId2 = 0;
-	QList<MeasureOperation*> operations;
-	QList<unsigned int> viewIds;
+void ProcessThread::ProcessTransforms( FrameListPtr scene )
+{
+	QMutexLocker locker(&m_MutexTransform);
 
-	QMap<QString, double> measureUpperRange;
-	QMap<QString, double> measureLowerRange;
-	QMap<QString, bool> measureBiggerValueIsBetter;
+	ReleaseTransformFramePools(false);
 
-	// Group the measure operations that have same 
-	// plugin/measure pointers and same sources
-	for (int i=0; i<m_MeasureRequests.size(); i++)
+	// Transforms of transform views run after the views they depend on
+	QList<TransformItem> pending = m_TransformRequests;
+	while (pending.size())
 	{
-		MeasureItem& item = m_MeasureRequests[i];
+		TransformJobs jobs;
+		UintList viewIds;
+		for (int i=0; i<pending.size();)
+		{
+			const TransformItem& item = pending.at(i);
+			FramePtr f1 = FindFrame(scene, item.sourceViewId1);
+			FramePtr f2 = item.need2Inputs?FindFrame(scene, item.sourceViewId2):FramePtr();
+			if (!f1 || (item.need2Inputs && !f2))
+			{
+				i++;
+				continue;
+			}
 
-		if (item.plugin != plugin || item.measure != measure || 
-			item.sourceViewId1 != sourceViewId1 || item.sourceViewId2 != sourceViewId2)
+			FormatPtr format = GetHostImpl()->NewFormat();
+			FramePtr result;
+			if (item.transform->GetFormat(f1->Format(), format) == OK)
+			{
+				FramePool*& pool = m_TransformFramePools[item.viewId];
+				if (!pool)
+				{
+					pool = GetHostImpl()->NewFramePool(TRANSFORM_POOL_SIZE, true);
+				}
+				pool->Adapt(false);
+				result = pool->Get();
+			}
+
+			if (result)
+			{
+				if (*result->Format() != *format)
+				{
+					result->Reset();
+				}
+				if (result->Data(0) == 0)
+				{
+					result->SetFormat(format);
+					result->Allocate();
+				}
+
+				jobs.transforms.append(item.transform);
+				jobs.sources1.append(f1);
+				jobs.sources2.append(f2);
+				jobs.results.append(result);
+				viewIds.append(item.viewId);
+			}
+			pending.removeAt(i);
+		}
+
+		if (!viewIds.size())
 		{
-			ProcessOperations(scene, plane, operations, viewIds,
-				measure, sourceViewId1, sourceViewId2);
+			// Rest depend on views missing in this scene
+			break;
+		}
 
-			plugin = item.plugin;
-			measure = item.measure;
-			sourceViewId1 = item.sourceViewId1;
-			sourceViewId2 = item.sourceViewId2;
+		QVector<RESULT> res(viewIds.size());
+		jobs.res = res.data();
+		ParallelFor(viewIds.size(), 1, jobs);
+
+		for (int i=0; i<viewIds.size(); i++)
+		{
+			if (res.at(i) != OK)
+			{
+				continue;
+			}
+
+			FramePtr f1 = jobs.sources1.at(i);
+			FramePtr f2 = jobs.sources2.at(i);
+			FramePtr result = jobs.results.at(i);
+			result->SetPTS(f1->PTS());
+			result->SetFrameNumber(f1->FrameNumber());
+			result->SetInfo(VIEW_ID, viewIds.at(i));
+			result->SetInfo(IS_LAST_FRAME, f1->Info(IS_LAST_FRAME).toBool() && 
+				(!f2 || f2->Info(IS_LAST_FRAME).toBool()));
+			scene->append(result);
 		}
+	}
+}
+
+void ProcessThread::ReleaseTransformFramePools( bool all )
+{
+	QMutableMapIterator<unsigned int, FramePool*> it(m_TransformFramePools);
+	while (it.hasNext())
+	{
+		it.next();
+
+		bool used = false;
+		for (int i=0; i<m_TransformRequests.size() && !all && !used; i++)
+		{
+			used = (m_TransformRequests.at(i).viewId == it.key());
+		}
+
+		if (!used)
+		{
+			GetHostImpl()->ReleaseFramePool(it.value());
+			it.remove();
+		}
+	}
+}
+
+void ProcessThread::ProcessStatistics( FrameListPtr scene )
+{
+	if (!m_StatisticsEnabled)
+	{
+		return;
+	}
+
+	// Frame shown again while paused already has them
+	for (int i=0; i<scene->size(); i++)
+	{
+		GetFrameHistogram(scene->at(i));
+	}
+}
+
+void ProcessThread::ProcessMeasures( FrameListPtr scene, YUV_PLANE plane )
+{
+	QMutexLocker locker(&m_MutexMeasure);
+
+	if (!m_MeasureRequests.size())
+	{
+		return;
+	}
+
+	// Group the measure operations that have same plugin/measure pointers 
+	// and same reference, so that each measure compares one reference with
+	// all its processed videos in one call
+	QList<MeasureGroup> groups;
+	for (int i=0; i<m_MeasureRequests.size(); i++)
+	{
+		MeasureItem& item = m_MeasureRequests[i];
 
 		item.op.hasResults[PLANE_Y] = 
 			item.op.hasResults[PLANE_U] = 
@@ -443,12 +608,43 @@ void ProcessThread::ProcessMeasures( FrameListPtr scene, YUV_PLANE plane )
 
 			item.op.distMap = m_DistMaps[item.viewId];
 		}
-		operations.append(&item.op);
-		viewIds.append(item.viewId);
+
+		int g = 0;
+		for (; g<groups.size(); g++)
+		{
+			const MeasureGroup& group = groups.at(g);
+			if (group.plugin == item.plugin && group.measure == item.measure && 
+				group.sourceViewId1 == item.sourceViewId1)
+			{
+				break;
+			}
+		}
+		if (g == groups.size())
+		{
+			MeasureGroup group;
+			group.plugin = item.plugin;
+			group.measure = item.measure;
+			group.sourceViewId1 = item.sourceViewId1;
+			groups.append(group);
+		}
+
+		MeasureGroup& group = groups[g];
+		int k = group.sourceViewIds2.indexOf(item.sourceViewId2);
+		if (k == -1)
+		{
+			k = group.sourceViewIds2.size();
+			group.sourceViewIds2.append(item.sourceViewId2);
+			group.operations.append(QList<MeasureOperation*>());
+			group.viewIds.append(UintList());
+		}
+		group.operations[k].append(&item.op);
+		group.viewIds[k].append(item.viewId);
 	}
 
-	ProcessOperations(scene, plane, operations, viewIds,
-		measure, sourceViewId1, sourceViewId2);
+	for (int g=0; g<groups.size(); g++)
+	{
+		ProcessOperations(scene, plane, groups[g]);
+	}
 }
 
 FramePtr ProcessThread::FindFrame( FrameListPtr lst, unsigned int id)
@@ -478,33 +674,82 @@ bool ProcessThread::IsLastScene( FrameListPtr scene )
 	return true;
 }
 
-void ProcessThread::ProcessOperations(FrameListPtr scene, YUV_PLANE plane, 
-	QList<MeasureOperation*>& operations, QList<unsigned int>& viewIds,
-	Measure* measure, unsigned int sourceViewId1, unsigned int sourceViewId2)
+void ProcessThread::ProcessOperations(FrameListPtr scene, YUV_PLANE plane, MeasureGroup& group)
 {
-	if (!operations.size())
+	FramePtr f1 = FindFrame(scene, group.sourceViewId1);
+	if (!f1)
 	{
 		return;
 	}
 
-	FramePtr f1 = FindFrame(scene, sourceViewId1);
-	FramePtr f2 = FindFrame(scene, sourceViewId2);
-	if (f1 && f2)
+	FrameList processed;
+	UintList sourceViewIds2;
+	QList<QList<MeasureOperation*> > operations;
+	QList<UintList> viewIds;
+	for (int k=0; k<group.sourceViewIds2.size(); k++)
 	{
-		YUV_PLANE p = plane;
-		const MeasureCapabilities& cap = measure->GetCapabilities();
-		if (p == PLANE_COLOR && !cap.hasColorDistortionMap)
+		unsigned int sourceViewId2 = group.sourceViewIds2.at(k);
+		FramePtr f2 = FindFrame(scene, sourceViewId2);
+		if (!f2)
+		{
+			continue;
+		}
+
+		// Use results from history if this pair of frames was measured
+		// before and no distortion map is needed
+		const QList<MeasureOperation*>& ops = group.operations.at(k);
+		bool cached = true;
+		for (int j=0; j<ops.size() && cached; j++)
 		{
-			p = PLANE_Y;
+			cached = !ops.at(j)->distMap && 
+				m_MeasureHistory.Lookup(group.sourceViewId1, sourceViewId2, *f1, *f2, *ops.at(j));
 		}
-		measure->Process(f1, f2, p, operations);
 
-		for (int j=0; j<operations.size(); j++)
+		// Or combine sums the source thread computed while reading the frame
+		if (!cached && FusedMeasureResults(*f1, group.sourceViewId1, *f2, ops))
+		{
+			for (int j=0; j<ops.size(); j++)
+			{
+				m_MeasureHistory.Store(group.sourceViewId1, sourceViewId2, *f1, *f2, *ops.at(j));
+			}
+			cached = true;
+		}
+
+		if (!cached)
+		{
+			processed.append(f2);
+			sourceViewIds2.append(sourceViewId2);
+			operations.append(ops);
+			viewIds.append(group.viewIds.at(k));
+		}
+	}
+
+	if (!processed.size())
+	{
+		return;
+	}
+
+	Measure* measure = group.measure;
+	YUV_PLANE p = plane;
+	const MeasureCapabilities& cap = measure->GetCapabilities();
+	if (p == PLANE_COLOR && !cap.hasColorDistortionMap)
+	{
+		p = PLANE_Y;
+	}
+	measure->ProcessMultiple(f1, processed, p, operations);
+
+	for (int k=0; k<operations.size(); k++)
+	{
+		for (int j=0; j<operations.at(k).size(); j++)
 		{
-			MeasureOperation* op = operations.at(j);
+			MeasureOperation* op = operations.at(k).at(j);
+			m_MeasureHistory.Store(group.sourceViewId1, sourceViewIds2.at(k), 
+				*f1, *processed.at(k), *op);
+
 			if (op->distMapWidth && op->distMapHeight)
 			{
 				const MeasureInfo& info = GetHostImpl()->GetMeasureInfo(op->measureName);
+				m_DistMapFramePool->Adapt(false);
 				FramePtr frame = m_DistMapFramePool->Get();
 
 				if (frame)
@@ -512,19 +757,26 @@ void ProcessThread::ProcessOperations(FrameListPtr scene, YUV_PLANE plane,
 					CreateColorMap(frame, op->distMap, op->distMapWidth, op->distMapHeight, 
 						info.upperRange, info.lowerRange, info.biggerValueIsBetter);
 
-					frame->SetInfo(VIEW_ID, viewIds.at(j));
+					frame->SetInfo(VIEW_ID, viewIds.at(k).at(j));
 					frame->SetInfo(IS_LAST_FRAME, true);
+
+					// Map of a chroma plane or of blocks is smaller than the video,
+					// renderer scales it back up to size of the video
+					frame->SetInfo(RENDER_SRC_SCALE_X, ((float)op->distMapWidth)/f1->Format()->Width());
+					frame->SetInfo(RENDER_SRC_SCALE_Y, ((float)op->distMapHeight)/f1->Format()->Height());
+					frame->SetInfo(RENDER_NEAREST, op->distMapBlockSize > 1);
 					scene->append(frame);
 				}
 			}
 		}
 	}
-	operations.clear();
-	viewIds.clear();
 }
 
 void ProcessThread::CleanFrameQueue( unsigned int viewId )
 {
+	// Video has changed, results measured so far are no longer valid
+	m_MeasureHistory.Clear(viewId);
+
 	if (!m_SourceFrames.contains(viewId))
 	{
 		return;
@@ -532,4 +784,5 @@ void ProcessThread::CleanFrameQueue( unsigned int viewId )
 
 	FrameList& frameList = m_SourceFrames[viewId];
 	frameList.clear();
+	RemoveFromSceneIndex(viewId);
 }
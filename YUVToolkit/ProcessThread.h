@@ -2,10 +2,18 @@
 #define PROCESS_THREAD_H
 
 #include "YT_InterfaceImpl.h"
+#include "MeasureHistory.h"
+#include "FrameStats.h"
 #include <QThread>
 #include <QList>
 #include <QMap>
 
+// Smallest number of distortion map frames kept, pool keeps as many as
+// are in use at once
+#define DIST_MAP_POOL_SIZE 2
+// Same for output frames of each transform view
+#define TRANSFORM_POOL_SIZE 2
+
 class ProcessThread : public QThread
 {
 	Q_OBJECT;
@@ -23,6 +31,17 @@ public:
 	void SetMeasureRequests(const QList<MeasureItem>& requests);
 	// Manage measure results
 	void GetMeasureResults(QList<MeasureItem>& results);
+	// Results of all frames measured so far
+	MeasureHistory* GetMeasureHistory() {return &m_MeasureHistory;}
+	// Measures computed by source threads while reading frames
+	FusedMeasure* GetFusedMeasure() {return &m_FusedMeasure;}
+	// Histogram and plane statistics of each frame of each scene, cached on
+	// the frame as FRAME_STATS
+	void SetStatisticsEnabled(bool enabled) {m_StatisticsEnabled = enabled;}
+	bool IsStatisticsEnabled() {return m_StatisticsEnabled;}
+
+	// Manage transform views, which are computed for each scene
+	void SetTransformRequests(const QList<TransformItem>& requests);
 signals:
 	// Signals that one scene is ready for render
 	void sceneReady(FrameListPtr scene, unsigned int pts, bool seeking);
@@ -37,20 +56,46 @@ private slots:
 private:
 	void run();
 	
-	unsigned int GetFirstPTS(UintList sourceViewIds);
-	unsigned int GetNextPTS(UintList sourceViewIds, unsigned int currentPTS);
+	// PTS of next scene after m_LastPTS, or of first scene after start or
+	// seek, INVALID_PTS if some view has no frames queued
+	unsigned int GetNextPTS();
+	// Drop frames of views whose shown frame changes by pts, returns
+	// false if some view has run out of frames
+	bool AdvanceQueues(unsigned int pts);
+	// Scene index keeps views ordered by the PTS at which their shown frame
+	// changes, so next scene is found without looking at every view
+	void UpdateSceneIndex(unsigned int viewID, unsigned int currentPTS);
+	void RemoveFromSceneIndex(unsigned int viewID);
+	void RebuildSceneIndex();
 	FrameListPtr FastSeekQueue(unsigned int pts, UintList sourceViewIds, bool& completed);
 	bool CleanAndCheckQueue(UintList& sourceViewIds);
 	void ProcessMeasures(FrameListPtr scene, YUV_PLANE plane);
+	void ProcessStatistics(FrameListPtr scene);
+	// Appends output frames of transform views to scene
+	void ProcessTransforms(FrameListPtr scene);
+	void ReleaseTransformFramePools(bool all);
 	FramePtr FindFrame(FrameListPtr, unsigned int);
 	bool IsLastScene(FrameListPtr scene);
-	void ProcessOperations(FrameListPtr scene, YUV_PLANE plane, 
-		QList<MeasureOperation*>& operations, QList<unsigned int>& viewIds,
-		Measure* measure, unsigned int sourceViewId1, unsigned int sourceViewId2);
+	// Measure operations of one measure that share the same reference
+	struct MeasureGroup
+	{
+		PlugInInfo* plugin;
+		Measure* measure;
+		unsigned int sourceViewId1;
+		UintList sourceViewIds2;
+		QList<QList<MeasureOperation*> > operations;
+		QList<UintList> viewIds;
+	};
+	void ProcessOperations(FrameListPtr scene, YUV_PLANE plane, MeasureGroup& group);
 private:
 	QMap<unsigned int, FrameList > m_SourceFrames;
 	PlaybackControl* m_Control;
 	unsigned int m_LastPTS;
+
+	// Next change PTS -> view, and view -> its key in m_SceneIndex.
+	// Views with empty queue are not in the index.
+	QMultiMap<unsigned int, unsigned int> m_SceneIndex;
+	QMap<unsigned int, unsigned int> m_SceneIndexKeys;
 	bool m_IsLastFrame;
 
 	QMap<unsigned int, DistMapPtr> m_DistMaps;
@@ -62,6 +107,13 @@ private:
 
 	QMutex m_MutexMeasure;
 	QList<MeasureItem> m_MeasureRequests;
+	MeasureHistory m_MeasureHistory;
+	FusedMeasure m_FusedMeasure;
+	volatile bool m_StatisticsEnabled;
+
+	QMutex m_MutexTransform;
+	QList<TransformItem> m_TransformRequests;
+	QMap<unsigned int, FramePool*> m_TransformFramePools; // per transform view
 };
 
 #endif
\ No newline at end of file
@@ -3,15 +3,23 @@
 
 #include "VideoViewList.h"
 #include "ColorConversion.h"
+#include "ParallelFor.h"
 
 #include <assert.h>
+#include <string.h>
 
 RenderThread::RenderThread(Renderer* renderer, PlaybackControl* c) :
 	m_RenderCounter(0), m_RenderInterval(0), m_SpeedRatio(1.0f),
-	m_Renderer(renderer), m_LastPTS(0), m_LastSeeking(false), m_Control(c), m_Exit(false)
+	m_Renderer(renderer), m_LastPTS(0), m_LastSeeking(false), m_LayoutChanged(false), 
+	m_MosaicFront(-1), m_MosaicClear(0), m_PendingPlane(PLANE_COLOR), m_PendingMosaic(-1), m_JobsRunning(false),
+	m_Control(c), m_Exit(false)
 
 {
 	moveToThread(this);
+
+	// Started right away when a scene is converted ahead, it never waits
+	// behind other work queued on the global pool
+	m_JobsPool.setMaxThreadCount(1);
 }
 
 RenderThread::~RenderThread(void)
@@ -37,15 +45,9 @@ void RenderThread::run()
 
 	WARNING_LOG("Render run cleaning up");
 
-	for (int i = 0; i < m_RenderFrames.size(); i++) 
-	{
-		FramePtr renderFrame = m_RenderFrames.at(i);
-		if (renderFrame)
-		{
-			m_Renderer->Deallocate(renderFrame);
-		}
-	}
-	m_RenderFrames.clear();
+	FinishFrames(false);
+	ReleaseRenderFrames();
+	ReleaseMosaic();
 
 	WARNING_LOG("Render run finish");
 }
@@ -105,17 +107,61 @@ void RenderThread::Render()
 		nextIsSeeking = m_SeekingQueue.takeFirst();
 		nextScene = m_SceneQueue.takeFirst();
 
-		RenderFrames(nextScene, status.plane);
-	}else if (m_RenderFrames.size()== 0 && m_LastSourceFrames && m_LastSourceFrames->size()>0)
+		m_MutexLayout.lock();
+		bool layoutChanged = m_LayoutChanged;
+		m_LayoutChanged = false;
+		m_MutexLayout.unlock();
+
+		if (m_PendingScene != nextScene || m_PendingPlane != status.plane || layoutChanged)
+		{
+			// Not converted ahead, e.g. right after seeking, or converted for
+			// the layout before views were zoomed or moved
+			RenderFrames(nextScene, status.plane);
+		}
+		FinishFrames(true);
+	}else if (m_LastSourceFrames && m_LastSourceFrames->size()>0)
+	{
+		m_MutexLayout.lock();
+		bool layoutChanged = m_LayoutChanged;
+		m_LayoutChanged = false;
+		m_MutexLayout.unlock();
+
+		if (m_RenderFrames.size()== 0 && m_MosaicScene.isEmpty())
+		{
+			// paused and render reset
+			RenderFrames(m_LastSourceFrames, status.plane);
+			FinishFrames(true);
+		}else if (layoutChanged)
+		{
+			// zoomed or moved while paused
+			RenderFrames(m_LastSourceFrames, status.plane, true);
+			FinishFrames(true);
+		}
+	}
+
+	if (m_PendingScene && (m_SceneQueue.isEmpty() || m_SceneQueue.first() != m_PendingScene ||
+		m_PendingPlane != status.plane))
+	{
+		// Scene converted ahead was dropped by seeking
+		FinishFrames(false);
+	}
+	if (!m_PendingScene && !m_SceneQueue.isEmpty())
 	{
-		// paused and render reset
-		RenderFrames(m_LastSourceFrames, status.plane);
+		// Convert next scene while this one is presented, so it only needs
+		// to be swapped in when it is due
+		StartFrames(m_SceneQueue.first(), status.plane);
 	}
 
-	if (m_RenderFrames.size()>0)
+	if (!m_MosaicScene.isEmpty() || m_RenderFrames.size()>0)
 	{
-		UpdateLayout();
-		m_Renderer->RenderScene(m_RenderFrames);
+		if (!m_MosaicScene.isEmpty())
+		{
+			m_Renderer->RenderScene(m_MosaicScene);
+		}else
+		{
+			UpdateLayout();
+			m_Renderer->RenderScene(m_RenderFrames);
+		}
 
 		int elapsedSinceLastRenderCycle = m_RenderCycleTime.restart();
 		WARNING_LOG("Render cycle: %d (%.2f) ms", elapsedSinceLastRenderCycle, m_RenderInterval);
@@ -153,72 +199,383 @@ void RenderThread::RenderScene( FrameListPtr scene, unsigned int pts, bool seeki
 void RenderThread::SetLayout(UintList ids, RectList srcRects, RectList dstRects)
 {
 	QMutexLocker locker(&m_MutexLayout);
+	if (m_ViewIDs == ids && m_SrcRects == srcRects && m_DstRects == dstRects)
+	{
+		return;
+	}
+
 	m_ViewIDs = ids;
 	m_SrcRects = srcRects;
 	m_DstRects = dstRects;
+	m_LayoutChanged = true;
+
+	m_ViewIndex.clear();
+	for (int j = 0; j < m_ViewIDs.size(); j++)
+	{
+		m_ViewIndex.insert(m_ViewIDs.at(j), j);
+	}
+}
+
+bool RenderThread::GetViewLayout( unsigned int viewID, QRect& srcRect, QRect& dstRect )
+{
+	QMutexLocker locker(&m_MutexLayout);
+	int j = m_ViewIndex.value(viewID, -1);
+	if (j == -1)
+	{
+		return false;
+	}
+
+	srcRect = m_SrcRects.at(j);
+	dstRect = m_DstRects.at(j);
+	return true;
 }
 
-void RenderThread::RenderFrames(FrameListPtr sourceFrames, YUV_PLANE plane)
+// Rounds rect out to whole chroma samples
+static QRect AlignToChroma(const QRect& rect, COLOR_FORMAT color, int width, int height)
 {
-	FrameImpl tempFrame;
+	int alignX = (color == I420 || color == I422)?2:1;
+	int alignY = (color == I420)?2:1;
+	int left = rect.left()&~(alignX-1);
+	int top = rect.top()&~(alignY-1);
+	int right = qMin((rect.left()+rect.width()+alignX-1)&~(alignX-1), width);
+	int bottom = qMin((rect.top()+rect.height()+alignY-1)&~(alignY-1), height);
+	return QRect(left, top, right-left, bottom-top);
+}
 
-	for (int i = 0; i < sourceFrames->size(); i++) 
+// Source frame to render, or one plane of it as gray frame in planeFrame.
+// Scale maps video coordinates to those of the returned frame.
+static Frame* SelectPlane(FramePtr sourceFrameOrig, YUV_PLANE plane, FrameImpl& planeFrame, float& scaleX, float& scaleY)
+{
+	Frame* sourceFrame = sourceFrameOrig.data();
+	scaleX = 1;
+	scaleY = 1;
+	if (sourceFrameOrig->HasInfo(RENDER_SRC_SCALE_X))
 	{
-		FramePtr sourceFrameOrig = sourceFrames->at(i);
-		if (!sourceFrameOrig)
+		scaleX = sourceFrameOrig->Info(RENDER_SRC_SCALE_X).toFloat();
+		scaleY = sourceFrameOrig->Info(RENDER_SRC_SCALE_Y).toFloat();
+	}
+	if (plane != PLANE_COLOR)
+	{
+		COLOR_FORMAT c = sourceFrameOrig->Format()->Color();
+		if (c == I420 || c == I422 || c == I444)
 		{
-			continue;
+			sourceFrame = &planeFrame;
+
+			FormatPtr format = sourceFrameOrig->Format();
+			sourceFrame->Format()->SetColor(Y800);
+			sourceFrame->Format()->SetWidth(format->PlaneWidth(plane));
+			sourceFrame->Format()->SetHeight(format->PlaneHeight(plane));
+			sourceFrame->Format()->SetStride(0, format->Stride(plane));
+			sourceFrame->Format()->PlaneSize(0);
+
+
+			sourceFrame->SetData(0, sourceFrameOrig->Data(plane));
+
+			scaleX = ((float)format->PlaneWidth(plane))/format->Width();
+			scaleY = ((float)format->PlaneHeight(plane))/format->Height();
 		}
-		unsigned int viewID = sourceFrameOrig->Info(VIEW_ID).toUInt();
+	}
 
-		Frame* sourceFrame = sourceFrameOrig.data();
-		float scaleX = 1;
-		float scaleY = 1;
-		if (plane != PLANE_COLOR)
+	return sourceFrame;
+}
+
+// Source rect of view in coordinates of the frame rendered
+static QRect VisibleRect(const QRect& srcRect, float scaleX, float scaleY, const QRect& frameRect)
+{
+	QRect visible((int)(srcRect.left()*scaleX), (int)(srcRect.top()*scaleY),
+		(int)(srcRect.width()*scaleX), (int)(srcRect.height()*scaleY));
+	return visible & frameRect;
+}
+
+// Bytes per pixel of packed render frame, 0 if planar
+static int PixelBytes(COLOR_FORMAT color)
+{
+	switch (color)
+	{
+	case Y800:
+		return 1;
+	case RGB24:
+	case BGR24:
+		return 3;
+	case RGBX32:
+	case XRGB32:
+	case BGRX32:
+	case XBGR32:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+// Converts render jobs of one scene, each one on its own worker thread
+struct RenderJobs
+{
+	QList<RenderJob>& jobs;
+
+	RenderJobs(QList<RenderJob>& j) : jobs(j) {}
+
+	void operator()(int from, int to)
+	{
+		for (int i=from; i<to; i++)
 		{
-			COLOR_FORMAT c = sourceFrameOrig->Format()->Color();
-			if (c == I420 || c == I422 || c == I444)
+			const RenderJob& job = jobs.at(i);
+			if (!job.tile.isNull())
+			{
+				// Into its part of the mosaic render frame
+				FormatPtr format = job.out->Format();
+				FrameImpl out;
+				out.Format()->SetColor(format->Color());
+				out.Format()->SetWidth(job.tile.width());
+				out.Format()->SetHeight(job.tile.height());
+				out.Format()->SetStride(0, format->Stride(0));
+				out.Format()->PlaneSize(0);
+				out.SetData(0, job.out->Data(0)+job.tile.top()*format->Stride(0)+
+					job.tile.left()*PixelBytes(format->Color()));
+
+				ScaledColorConversion(*job.input, job.region, out, *job.scratch);
+			}else if (!job.region.isNull())
 			{
-				sourceFrame = &tempFrame;
+				ScaledColorConversion(*job.input, job.region, *job.out, *job.scratch);
+			}else if (job.out->Format()->Color() == job.input->Format()->Color())
+			{
+				// Renderer takes this color natively, only copy planes
+				CopyFrame(*job.input, *job.out);
+			}else
+			{
+				ColorConversion(*job.input, *job.out);
+			}
+		}
+	}
+};
+
+// Runs render jobs on the worker threads, while render thread presents
+class RenderJobsTask : public QRunnable
+{
+public:
+	RenderJobsTask(QList<RenderJob>& jobs, QSemaphore* done) : m_Jobs(jobs), m_Done(done) {}
+
+	void run()
+	{
+		ParallelFor(m_Jobs.jobs.size(), 1, m_Jobs);
+		m_Done->release();
+	}
+private:
+	RenderJobs m_Jobs;
+	QSemaphore* m_Done;
+};
+
+void RenderThread::RenderFrames(FrameListPtr sourceFrames, YUV_PLANE plane, bool layoutChanged)
+{
+	FinishFrames(false);
+	PrepareFrames(sourceFrames, plane, layoutChanged);
+
+	RenderJobs jobs(m_Jobs);
+	ParallelFor(m_Jobs.size(), 1, jobs);
+}
+
+void RenderThread::StartFrames(FrameListPtr sourceFrames, YUV_PLANE plane)
+{
+	PrepareFrames(sourceFrames, plane, false);
 
-				FormatPtr format = sourceFrameOrig->Format();
-				sourceFrame->Format()->SetColor(Y800);
-				sourceFrame->Format()->SetWidth(format->PlaneWidth(plane));
-				sourceFrame->Format()->SetHeight(format->PlaneHeight(plane));
-				sourceFrame->Format()->SetStride(0, format->Stride(plane));
-				sourceFrame->Format()->PlaneSize(0);
+	if (m_Jobs.size() > 0)
+	{
+		m_JobsRunning = true;
+		m_JobsPool.start(new RenderJobsTask(m_Jobs, &m_JobsDone));
+	}
+}
 
+void RenderThread::FinishFrames(bool present)
+{
+	if (m_JobsRunning)
+	{
+		m_JobsDone.acquire();
+		m_JobsRunning = false;
+	}
+	m_Jobs.clear();
 
-				sourceFrame->SetData(0, sourceFrameOrig->Data(plane));
+	for (int i = 0; i < m_PendingFrames.size(); i++)
+	{
+		m_Renderer->ReleaseFrame(m_PendingFrames.at(i));
+	}
 
-				scaleX = ((float)format->PlaneWidth(plane))/format->Width();
-				scaleY = ((float)format->PlaneHeight(plane))/format->Height();
+	if (m_PendingMosaic != -1)
+	{
+		// Tiles know which mosaic render frames hold them, nothing to undo
+		if (present)
+		{
+			m_MosaicFront = m_PendingMosaic;
+			m_MosaicScene.clear();
+			m_MosaicScene.append(m_MosaicFrames[m_MosaicFront]);
+		}
+	}else
+	{
+		for (int i = 0; i < m_PendingFrames.size(); i++)
+		{
+			FramePtr renderFrame = m_PendingFrames.at(i);
+			unsigned int viewID = renderFrame->Info(VIEW_ID).toUInt();
+			RenderView* view = m_RenderViews.value(viewID);
+			int pos = m_RenderFrameIndex.value(viewID, -1);
+			if (!present)
+			{
+				view->spare.append(renderFrame);
+			}else if (pos == -1)
+			{
+				m_RenderFrameIndex.insert(viewID, m_RenderFrames.size());
+				m_RenderFrames.append(renderFrame);
+			}else
+			{
+				view->spare.append(m_RenderFrames.at(pos));
+				m_RenderFrames[pos] = renderFrame;
 			}
 		}
+	}
+
+	m_PendingFrames.clear();
+	m_PendingMosaic = -1;
+	m_PendingScene.clear();
+}
+
+void RenderThread::PrepareFrames(FrameListPtr sourceFrames, YUV_PLANE plane, bool layoutChanged)
+{
+	m_PendingScene = sourceFrames;
+	m_PendingPlane = plane;
+
+	if (PrepareMosaic(sourceFrames, plane))
+	{
+		ReleaseRenderFrames();
+		return;
+	}
+	ReleaseMosaic();
+
+	// Drop render frames not presented of views no longer shown, the ones
+	// presented are dropped by UpdateLayout()
+	m_MutexLayout.lock();
+	QHash<unsigned int, int> viewIndex = m_ViewIndex;
+	m_MutexLayout.unlock();
+	QMutableHashIterator<unsigned int, RenderView*> it(m_RenderViews);
+	while (it.hasNext())
+	{
+		it.next();
+		if (!viewIndex.contains(it.key()))
+		{
+			RenderView* view = it.value();
+			for (int k = 0; k < view->spare.size(); k++)
+			{
+				m_Renderer->Deallocate(view->spare.at(k));
+			}
+			delete view;
+			it.remove();
+		}
+	}
+
+	for (int i = 0; i < sourceFrames->size(); i++) 
+	{
+		FramePtr sourceFrameOrig = sourceFrames->at(i);
+		if (!sourceFrameOrig)
+		{
+			continue;
+		}
+		unsigned int viewID = sourceFrameOrig->Info(VIEW_ID).toUInt();
+
+		RenderView*& view = m_RenderViews[viewID];
+		if (!view)
+		{
+			view = new RenderView;
+		}
+
+		float scaleX, scaleY;
+		Frame* sourceFrame = SelectPlane(sourceFrameOrig, plane, view->planeFrame, scaleX, scaleY);
 		
-		int pos = -1;
-		for (int k = 0; k < m_RenderFrames.size(); k++) 
+		int pos = m_RenderFrameIndex.value(viewID, -1);
+		FramePtr presented = (pos == -1)?FramePtr():m_RenderFrames.at(pos);
+
+		FormatPtr sourceFormat = sourceFrame->Format();
+		COLOR_FORMAT sourceColor = sourceFormat->Color();
+
+		// Part of source frame held by render frame, and its size there. When
+		// the view is shrunk, only the part shown is converted, scaled down to
+		// the size it is shown at, instead of uploading the whole frame and
+		// letting the renderer scale it. When zoomed in, only the part shown
+		// and a margin around it is converted, so panning within the margin
+		// does not need the frame again.
+		QRect frameRect(0, 0, sourceFormat->Width(), sourceFormat->Height());
+		QRect region = frameRect;
+		QSize size = region.size();
+		bool partial = false;
+		QRect srcRect, dstRect;
+		if (IsNativeFormat(sourceColor) && GetViewLayout(viewID, srcRect, dstRect))
 		{
-			FramePtr _frame = m_RenderFrames.at(k);
-			if (_frame && _frame->Info(VIEW_ID).toUInt() == viewID)
+			QRect visible = VisibleRect(srcRect, scaleX, scaleY, frameRect);
+
+			QRect held;
+			bool heldUnscaled = false;
+			if (presented)
 			{
-				pos = k;
-				break;
+				held = presented->Info(RENDER_REGION).toRect();
+				heldUnscaled = (held.width() == presented->Format()->Width() &&
+					held.height() == presented->Format()->Height());
+			}
+
+			if (dstRect.width() < visible.width() && dstRect.height() < visible.height())
+			{
+				region = AlignToChroma(visible, sourceColor, frameRect.width(), frameRect.height());
+				size = QSize((dstRect.width()+1)&~1, (dstRect.height()+1)&~1);
+				partial = true;
+			}else if (!visible.isEmpty() && visible != frameRect)
+			{
+				int marginX = qMax(visible.width()/RENDER_MARGIN_DIVISOR, 16);
+				int marginY = qMax(visible.height()/RENDER_MARGIN_DIVISOR, 16);
+				QRect wanted = visible.adjusted(-marginX, -marginY, marginX, marginY) & frameRect;
+				if (heldUnscaled && held.contains(visible) && held != frameRect &&
+					held == AlignToChroma(held, sourceColor, frameRect.width(), frameRect.height()) &&
+					held.width() <= 2*wanted.width() && held.height() <= 2*wanted.height())
+				{
+					// Keep position while panning, so the render frame is
+					// not allocated again
+					region = held;
+				}else
+				{
+					region = AlignToChroma(wanted, sourceColor, frameRect.width(), frameRect.height());
+				}
+				size = region.size();
+				partial = (region != frameRect);
+			}
+
+			if (layoutChanged && presented && held == region &&
+				presented->Format()->Width() == size.width() && presented->Format()->Height() == size.height())
+			{
+				// Render frame presented still holds what is shown
+				continue;
 			}
 		}
 
-		if (pos == -1)
+		FormatPtr renderFormat = sourceFormat;
+		if (partial)
 		{
-			pos = m_RenderFrames.size();
-			m_RenderFrames.append(FramePtr());
+			renderFormat = FormatPtr(new FormatImpl);
+			renderFormat->SetColor(sourceColor);
+			renderFormat->SetWidth(size.width());
+			renderFormat->SetHeight(size.height());
+			renderFormat->PlaneSize(0);
 		}
 
-		FramePtr& renderFrame = m_RenderFrames[pos];
-		// Deallocate if resolution changed
-		if (renderFrame && (sourceFrame->Format()->Width() != 
+		// Renderer may take the source color only for some frame sizes, e.g.
+		// even ones for YV12, otherwise the render frame is converted
+		bool nativeColor = m_Renderer->IsColorSupported(sourceColor, 
+			renderFormat->Width(), renderFormat->Height());
+
+		// Render frame not presented. Deallocate if resolution changed, or if
+		// it no longer matches the color the renderer wants for this source
+		FramePtr renderFrame;
+		if (!view->spare.isEmpty())
+		{
+			renderFrame = view->spare.takeFirst();
+		}
+		if (renderFrame && (renderFormat->Width() != 
 			renderFrame->Format()->Width() || 
-			sourceFrame->Format()->Height() != 
-			renderFrame->Format()->Height()))
+			renderFormat->Height() != 
+			renderFrame->Format()->Height() ||
+			nativeColor != (renderFrame->Format()->Color() == sourceColor)))
 		{
 			m_Renderer->Deallocate(renderFrame);
 			renderFrame.clear();
@@ -227,33 +584,32 @@ void RenderThread::RenderFrames(FrameListPtr sourceFrames, YUV_PLANE plane)
 		// Allocate if needed
 		if (!renderFrame)
 		{
-			m_Renderer->Allocate(renderFrame, sourceFrame->Format());
+			m_Renderer->Allocate(renderFrame, renderFormat);
+			if (!renderFrame)
+			{
+				continue;
+			}
 		}
 		
 		renderFrame->SetInfo(VIEW_ID, viewID);
 		renderFrame->SetInfo(RENDER_SRC_SCALE_X, scaleX);
 		renderFrame->SetInfo(RENDER_SRC_SCALE_Y, scaleY);
+		renderFrame->SetInfo(RENDER_REGION, region);
+		renderFrame->SetInfo(RENDER_NEAREST, sourceFrameOrig->Info(RENDER_NEAREST).toBool());
 
-		// Render frame
+		// Render frame is written by jobs and released by FinishFrames(..)
 		if (m_Renderer->GetFrame(renderFrame) == OK)
 		{
-			if (sourceFrame->Format() == renderFrame->Format())
-			{
-				for (int i=0; i<4; i++)
-				{
-					size_t len = renderFrame->Format()->PlaneSize(i);
-					if (len > 0)
-					{
-						memcpy(renderFrame->Data(i), sourceFrame->Data(i), len);
-					}
-				}
-
-			}else
-			{
-				ColorConversion(*sourceFrame, *renderFrame);
-			}
-
-			m_Renderer->ReleaseFrame(renderFrame);
+			RenderJob job;
+			job.input = sourceFrame;
+			job.region = partial?region:QRect();
+			job.out = renderFrame.data();
+			job.scratch = &view->scratch;
+			m_Jobs.append(job);
+			m_PendingFrames.append(renderFrame);
+		}else
+		{
+			view->spare.append(renderFrame);
 		}
 	}
 }
@@ -263,6 +619,7 @@ void RenderThread::UpdateLayout()
 	QMutexLocker locker(&m_MutexLayout);
 
 	// Find frames without layout info and delete them
+	bool removed = false;
 	QMutableListIterator<FramePtr> i(m_RenderFrames);
 	while (i.hasNext()) 
 	{
@@ -270,14 +627,16 @@ void RenderThread::UpdateLayout()
 		if (!renderFrame)
 		{
 			i.remove();
+			removed = true;
 			continue;
 		}
 
-		int j = m_ViewIDs.indexOf(renderFrame->Info(VIEW_ID).toUInt());
+		int j = m_ViewIndex.value(renderFrame->Info(VIEW_ID).toUInt(), -1);
 		if (j == -1)
 		{
 			m_Renderer->Deallocate(renderFrame);
 			i.remove();
+			removed = true;
 		}else
 		{
 			QRect srcRect = m_SrcRects.at(j);
@@ -288,10 +647,278 @@ void RenderThread::UpdateLayout()
 			srcRect.setTop((int)(srcRect.top()*scaleY));
 			srcRect.setBottom((int)(srcRect.bottom()*scaleY));
 
+			// Into the part of source frame held, at the size it is held
+			QRect region = renderFrame->Info(RENDER_REGION).toRect();
+			if (region.isValid())
+			{
+				double zoomX = ((double)renderFrame->Format()->Width())/region.width();
+				double zoomY = ((double)renderFrame->Format()->Height())/region.height();
+				int left = qRound((srcRect.left()-region.left())*zoomX);
+				int top = qRound((srcRect.top()-region.top())*zoomY);
+				int right = qRound((srcRect.left()+srcRect.width()-region.left())*zoomX);
+				int bottom = qRound((srcRect.top()+srcRect.height()-region.top())*zoomY);
+				srcRect = QRect(left, top, right-left, bottom-top) & 
+					QRect(0, 0, renderFrame->Format()->Width(), renderFrame->Format()->Height());
+			}
+
 			renderFrame->SetInfo(SRC_RECT, srcRect);
 			renderFrame->SetInfo(DST_RECT, m_DstRects.at(j));
 		}
 	}
+
+	if (removed)
+	{
+		m_RenderFrameIndex.clear();
+		for (int k = 0; k < m_RenderFrames.size(); k++)
+		{
+			m_RenderFrameIndex.insert(m_RenderFrames.at(k)->Info(VIEW_ID).toUInt(), k);
+		}
+	}
+}
+
+bool RenderThread::PrepareMosaic(FrameListPtr sourceFrames, YUV_PLANE plane)
+{
+	UintList viewIDs;
+	RectList srcRects, dstRects;
+	QHash<unsigned int, int> viewIndex;
+	m_MutexLayout.lock();
+	viewIDs = m_ViewIDs;
+	srcRects = m_SrcRects;
+	dstRects = m_DstRects;
+	viewIndex = m_ViewIndex;
+	m_MutexLayout.unlock();
+
+	if (viewIDs.size() < RENDER_MOSAIC_VIEWS)
+	{
+		return false;
+	}
+
+	// Mosaic render frame covers all views
+	QRect mosaicRect;
+	for (int j = 0; j < dstRects.size(); j++)
+	{
+		mosaicRect |= dstRects.at(j);
+	}
+	if (mosaicRect.isEmpty())
+	{
+		return false;
+	}
+
+	// Mosaic render frame not presented is drawn into
+	int back = (m_MosaicFront+1)%RENDER_MOSAIC_BUFFERS;
+	int backBit = 1<<back;
+	FramePtr& mosaicFrame = m_MosaicFrames[back];
+	if (mosaicFrame && (mosaicFrame->Format()->Width() != mosaicRect.width() ||
+		mosaicFrame->Format()->Height() != mosaicRect.height()))
+	{
+		m_Renderer->Deallocate(mosaicFrame);
+		mosaicFrame.clear();
+	}
+
+	// Drop tiles of views no longer shown, their part is cleared below
+	int allBits = (1<<RENDER_MOSAIC_BUFFERS)-1;
+	QMutableHashIterator<unsigned int, MosaicTile*> it(m_MosaicTiles);
+	while (it.hasNext())
+	{
+		it.next();
+		if (!viewIndex.contains(it.key()))
+		{
+			delete it.value();
+			it.remove();
+			m_MosaicClear = allBits;
+		}
+	}
+
+	for (int i = 0; i < sourceFrames->size(); i++)
+	{
+		FramePtr sourceFrameOrig = sourceFrames->at(i);
+		if (!sourceFrameOrig)
+		{
+			continue;
+		}
+		unsigned int viewID = sourceFrameOrig->Info(VIEW_ID).toUInt();
+		int j = viewIndex.value(viewID, -1);
+		if (j == -1)
+		{
+			continue;
+		}
+
+		MosaicTile*& tile = m_MosaicTiles[viewID];
+		if (!tile)
+		{
+			tile = new MosaicTile;
+			tile->plane = plane;
+			tile->drawn = 0;
+			m_MosaicClear = allBits;
+		}
+
+		float scaleX, scaleY;
+		tile->input = SelectPlane(sourceFrameOrig, plane, tile->planeFrame, scaleX, scaleY);
+		FormatPtr format = tile->input->Format();
+		if (!IsNativeFormat(format->Color()))
+		{
+			return false;
+		}
+
+		QRect frameRect(0, 0, format->Width(), format->Height());
+		QRect visible = VisibleRect(srcRects.at(j), scaleX, scaleY, frameRect);
+		QRect rect = dstRects.at(j).translated(-mosaicRect.topLeft());
+		if (rect.width() > visible.width() || rect.height() > visible.height())
+		{
+			// Zoomed in views are drawn by the renderer
+			return false;
+		}
+		QRect region = AlignToChroma(visible, format->Color(), frameRect.width(), frameRect.height());
+		if (region.isEmpty() || rect.isEmpty())
+		{
+			tile->region = QRect();
+			continue;
+		}
+
+		if (tile->rect != rect)
+		{
+			m_MosaicClear = allBits;
+		}
+		if (tile->source.toStrongRef() != sourceFrameOrig || tile->plane != plane || 
+			tile->region != region || tile->rect != rect)
+		{
+			tile->source = sourceFrameOrig;
+			tile->plane = plane;
+			tile->region = region;
+			tile->rect = rect;
+			tile->drawn = 0;
+		}
+	}
+
+	if (!mosaicFrame)
+	{
+		// Renderer converts everything it does not take natively to packed rgb
+		FormatPtr format = FormatPtr(new FormatImpl);
+		format->SetColor(I444);
+		format->SetWidth(mosaicRect.width());
+		format->SetHeight(mosaicRect.height());
+		format->PlaneSize(0);
+		if (m_Renderer->Allocate(mosaicFrame, format) != OK || !mosaicFrame)
+		{
+			mosaicFrame.clear();
+			return false;
+		}
+		if (PixelBytes(mosaicFrame->Format()->Color()) == 0)
+		{
+			ReleaseMosaic();
+			return false;
+		}
+		m_MosaicClear |= backBit;
+	}
+	mosaicFrame->SetInfo(SRC_RECT, QRect(0, 0, mosaicRect.width(), mosaicRect.height()));
+	mosaicFrame->SetInfo(DST_RECT, mosaicRect);
+	m_PendingMosaic = back;
+
+	bool clear = (m_MosaicClear & backBit) != 0;
+	if (clear)
+	{
+		// Gaps between views are black, every view is drawn again
+		QHashIterator<unsigned int, MosaicTile*> t(m_MosaicTiles);
+		while (t.hasNext())
+		{
+			t.next();
+			t.value()->drawn &= ~backBit;
+		}
+	}
+
+	// Views this mosaic render frame does not hold yet
+	QList<RenderJob> jobs;
+	for (int i = 0; i < sourceFrames->size(); i++)
+	{
+		FramePtr sourceFrameOrig = sourceFrames->at(i);
+		MosaicTile* tile = sourceFrameOrig ? m_MosaicTiles.value(sourceFrameOrig->Info(VIEW_ID).toUInt()) : 0;
+		if (tile && !tile->region.isEmpty() && !(tile->drawn & backBit))
+		{
+			RenderJob job;
+			job.input = tile->input;
+			job.region = tile->region;
+			job.out = mosaicFrame.data();
+			job.tile = tile->rect;
+			job.scratch = &tile->scratch;
+			jobs.append(job);
+		}
+	}
+
+	if (clear || jobs.size() > 0)
+	{
+		if (m_Renderer->GetFrame(mosaicFrame) != OK)
+		{
+			// Not changed, stays presented
+			m_PendingMosaic = -1;
+			return true;
+		}
+
+		if (clear)
+		{
+			memset(mosaicFrame->Data(0), 0, mosaicFrame->Format()->Stride(0)*mosaicRect.height());
+			m_MosaicClear &= ~backBit;
+		}
+
+		for (int i = 0; i < sourceFrames->size(); i++)
+		{
+			FramePtr sourceFrameOrig = sourceFrames->at(i);
+			MosaicTile* tile = sourceFrameOrig ? m_MosaicTiles.value(sourceFrameOrig->Info(VIEW_ID).toUInt()) : 0;
+			if (tile && !tile->region.isEmpty())
+			{
+				tile->drawn |= backBit;
+			}
+		}
+
+		m_Jobs = jobs;
+		m_PendingFrames.append(mosaicFrame);
+	}
+
+	return true;
+}
+
+void RenderThread::ReleaseRenderFrames()
+{
+	for (int i = 0; i < m_RenderFrames.size(); i++) 
+	{
+		FramePtr renderFrame = m_RenderFrames.at(i);
+		if (renderFrame)
+		{
+			m_Renderer->Deallocate(renderFrame);
+		}
+	}
+	m_RenderFrames.clear();
+	m_RenderFrameIndex.clear();
+
+	QHashIterator<unsigned int, RenderView*> it(m_RenderViews);
+	while (it.hasNext())
+	{
+		it.next();
+		RenderView* view = it.value();
+		for (int k = 0; k < view->spare.size(); k++)
+		{
+			m_Renderer->Deallocate(view->spare.at(k));
+		}
+		delete view;
+	}
+	m_RenderViews.clear();
+}
+
+void RenderThread::ReleaseMosaic()
+{
+	for (int i = 0; i < RENDER_MOSAIC_BUFFERS; i++)
+	{
+		if (m_MosaicFrames[i])
+		{
+			m_Renderer->Deallocate(m_MosaicFrames[i]);
+			m_MosaicFrames[i].clear();
+		}
+	}
+	m_MosaicFront = -1;
+	m_MosaicClear = 0;
+	m_MosaicScene.clear();
+
+	qDeleteAll(m_MosaicTiles);
+	m_MosaicTiles.clear();
 }
 
 unsigned int RenderThread::GetNextPTS( bool& isSeeking )
@@ -2,6 +2,49 @@
 
 #include "YT_InterfaceImpl.h"
 
+// Margin converted around the part of a zoomed in view that is shown, as
+// divisor of the size shown
+#define RENDER_MARGIN_DIVISOR 4
+// Number of views from which all views are composited into one render frame
+#define RENDER_MOSAIC_VIEWS 9
+// Mosaic render frames, one is presented while the next scene is drawn into
+// another one on worker threads
+#define RENDER_MOSAIC_BUFFERS 2
+
+// View composited into the mosaic render frame
+struct MosaicTile
+{
+	QWeakPointer<Frame> source;	// frame drawn last, views not changed are skipped
+	YUV_PLANE plane;
+	QRect region;				// part of source frame drawn
+	QRect rect;					// where in mosaic render frame
+	int drawn;					// bit of each mosaic render frame holding it
+
+	const Frame* input;			// source frame or its plane, while drawing
+	FrameImpl planeFrame;
+	FrameImpl scratch;			// planes halved before conversion
+};
+
+// Render frame of a view not presented, converted into while the other one
+// is presented
+struct RenderView
+{
+	FrameList spare;
+	FrameImpl planeFrame;
+	FrameImpl scratch;			// planes halved before conversion
+};
+
+// Conversion of a view into its render frame, or into its tile of the
+// mosaic render frame, run on worker threads
+struct RenderJob
+{
+	const Frame* input;
+	QRect region;				// part of input scaled to out, all of it if null
+	Frame* out;
+	QRect tile;					// part of mosaic render frame, if not null
+	FrameImpl* scratch;
+};
+
 class RenderThread : public QThread
 {
 	Q_OBJECT;
@@ -28,7 +71,28 @@ private slots:
 
 protected:
 	void run();
-	void RenderFrames(FrameListPtr sourceFrames, YUV_PLANE plane);
+	// Converts scene now, FinishFrames(true) presents it. With layoutChanged,
+	// only views whose render frame no longer holds the part shown are
+	// rendered again.
+	void RenderFrames(FrameListPtr sourceFrames, YUV_PLANE plane, bool layoutChanged=false);
+	// Starts converting scene on worker threads, while the render frames of
+	// the scene before are presented
+	void StartFrames(FrameListPtr sourceFrames, YUV_PLANE plane);
+	// Waits until conversion is done, and with present, swaps the render
+	// frames written in for the ones presented
+	void FinishFrames(bool present);
+	// Gets render frames not presented for scene, and queues the jobs
+	// converting it into them
+	void PrepareFrames(FrameListPtr sourceFrames, YUV_PLANE plane, bool layoutChanged);
+	// Composites all views into one render frame, so the renderer draws it
+	// at once and only views with a new frame are converted. Returns false
+	// if there are too few views, or some view is zoomed in or not in a
+	// native format.
+	bool PrepareMosaic(FrameListPtr sourceFrames, YUV_PLANE plane);
+	void ReleaseRenderFrames();
+	void ReleaseMosaic();
+	// Layout of view in video coordinates, false if view has none
+	bool GetViewLayout(unsigned int viewID, QRect& srcRect, QRect& dstRect);
 
 	void UpdateLayout();
 	unsigned int GetNextPTS(bool& isSeeking);
@@ -52,8 +116,34 @@ protected:
 	UintList m_ViewIDs;
 	RectList m_SrcRects;
 	RectList m_DstRects;
+	QHash<unsigned int, int> m_ViewIndex; // view id -> index in layout
+	// Render frames only hold the part of the frame shown, at the size shown,
+	// so they are made again from last scene when views are zoomed or moved
+	bool m_LayoutChanged;
 
+	// Render frames presented
 	FrameList m_RenderFrames;
+	QHash<unsigned int, int> m_RenderFrameIndex; // view id -> index in m_RenderFrames
+	QHash<unsigned int, RenderView*> m_RenderViews;
+
+	// Mosaic mode, all views in one render frame
+	FramePtr m_MosaicFrames[RENDER_MOSAIC_BUFFERS];
+	int m_MosaicFront;	// mosaic render frame presented, -1 if none
+	int m_MosaicClear;	// bit of each mosaic render frame to clear
+	FrameList m_MosaicScene;
+	QHash<unsigned int, MosaicTile*> m_MosaicTiles;
+
+	// Scene being converted into render frames not presented yet
+	FrameListPtr m_PendingScene;
+	YUV_PLANE m_PendingPlane;
+	FrameList m_PendingFrames;
+	int m_PendingMosaic;	// mosaic render frame written, -1 if none
+	QList<RenderJob> m_Jobs;
+	QSemaphore m_JobsDone;
+	bool m_JobsRunning;
+	// Runs RenderJobsTask, which spreads the jobs over the global pool with
+	// ParallelFor(..), so they do not wait for threads busy with other work
+	QThreadPool m_JobsPool;
 
 	QTime m_RenderCycleTime, m_RenderSpeedTime;
 
@@ -20,6 +20,12 @@
 #define SETTINGS_GET_DIST_MAP()        value("measure/distmap", QStringList()<<"PSNR").toStringList()
 #define SETTINGS_SET_DIST_MAP(v)       setValue("measure/distmap", v)
 
+#define SETTINGS_GET_DIST_MAP_BLOCK_SIZE()   value("measure/distmapblocksize", 1).toInt()
+#define SETTINGS_SET_DIST_MAP_BLOCK_SIZE(v)  setValue("measure/distmapblocksize", v)
+
+#define SETTINGS_GET_MEASURE_ALL_FRAMES()   value("measure/allframes", false).toBool()
+#define SETTINGS_SET_MEASURE_ALL_FRAMES(v)  setValue("measure/allframes", v)
+
 #define SETTINGS_GET_FILE_PATH()       value("main/openfilespath", "").toString()
 #define SETTINGS_SET_FILE_PATH(v)      setValue("main/openfilespath", v)
 
@@ -32,6 +38,12 @@
 #define SETTINGS_GET_AUTO_RESIZE()     value("main/autoresize", true).toBool()
 #define SETTINGS_SET_AUTO_RESIZE(v)    setValue("main/autoresize", v)
 
+#define SETTINGS_GET_FRAME_MEMORY()    value("main/framememory", 1024).toInt()
+#define SETTINGS_SET_FRAME_MEMORY(v)   setValue("main/framememory", v)
+
 #define SETTINGS_GET_PLAYBACK_LOOP()   value("main/playbackloop", true).toBool()
 #define SETTINGS_SET_PLAYBACK_LOOP(v)  setValue("main/playbackloop", v)
+
+#define SETTINGS_GET_FUSED_MEASURE()   value("measure/fused", false).toBool()
+#define SETTINGS_SET_FUSED_MEASURE(v)  setValue("measure/fused", v)
 #endif
\ No newline at end of file
@@ -2,15 +2,16 @@
 #include "YT_InterfaceImpl.h"
 #include "VideoView.h"
 #include "ColorConversion.h"
+#include "FrameStats.h"
 
 #include <qstring.h>
 #include <qmessagebox.h>
 #include <QMutex>
 #include <QMutexLocker>
 
-SourceThread::SourceThread(SourceCallback* cb, int id, PlaybackControl* c, const char* p) :
-	m_ViewID(id), m_LastSeekingPTS(INVALID_PTS), m_Path(p),
-	m_Source(0), m_EndOfFile(false), m_FramePool(0), m_Control(c), m_SourceReset(false)
+SourceThread::SourceThread(SourceCallback* cb, int id, PlaybackControl* c, FusedMeasure* fused, const char* p) :
+	m_ViewID(id), m_LastSeekingPTS(INVALID_PTS), m_NextPTS(INVALID_PTS), m_Path(p),
+	m_Source(0), m_EndOfFile(false), m_FramePool(0), m_Control(c), m_FusedMeasure(fused), m_SourceReset(false)
 {
 	moveToThread(this);
 
@@ -69,6 +70,9 @@ void SourceThread::Start()
 
 void SourceThread::ReadFrames()
 {
+	m_Control->GetStatus(&m_Status);
+	m_FramePool->Adapt(m_Status.isPlaying && m_Status.seekingPTS == INVALID_PTS);
+
 	while (true)
 	{
 		if (!m_FramePool->Size())
@@ -125,25 +129,37 @@ void SourceThread::ReadFrames()
 		}
 		
 		// Get next frame or seek 
-		RESULT res = OK;
-		if (frameOrig)
+		RESULT res = ReadFrame(frame, frameOrig);
+
+		if (res == FRAME_NOT_READY)
 		{
-			res = m_Source->GetFrame(frameOrig, m_Status.seekingPTS);
-			ColorConversion(*frameOrig, *frame);
-		}else
+			// Live source, try again on next timer
+			return;
+		}
+
+		if (res == E_PTS_NOT_FOUND && m_Status.seekingPTS != INVALID_PTS)
 		{
-			res = m_Source->GetFrame(frame, m_Status.seekingPTS);
+			// Source can not go back, so all views go to its next frame instead
+			// of showing a position this source never reached
+			WARNING_LOG("Source %d can not seek to %d, seek to %d", m_ViewID, m_Status.seekingPTS, m_NextPTS);
+			if (m_NextPTS != INVALID_PTS)
+			{
+				m_Control->Seek(m_NextPTS);
+			}
+			return;
 		}
 		
 
 		if (res == OK)
 		{
 			frame->SetInfo(VIEW_ID, m_ViewID);
+			m_FusedMeasure->AddFrame(m_ViewID, frame);
 
 			emit frameReady(frame);
 			WARNING_LOG("Source %d - FrameReady %d", m_ViewID, frame->PTS());
 
 			m_LastSeekingPTS = m_Status.seekingPTS;
+			m_NextPTS = frame->HasInfo(NEXT_PTS)?frame->Info(NEXT_PTS).toUInt():INVALID_PTS;
 			m_EndOfFile = false;
 
 			if (m_SourceReset)
@@ -180,6 +196,34 @@ void SourceThread::EnsureFrameFormat( FramePtr frame, FormatPtr format )
 	}
 }
 
+RESULT SourceThread::ReadFrame( FramePtr frame, FramePtr frameOrig )
+{
+	RESULT res = m_Source->GetFrame(frameOrig?frameOrig:frame, m_Status.seekingPTS);
+
+	// Native frames are read by the source plugin, a pass of their own
+	// would only add to the memory traffic, so they are measured as usual
+	if (!m_FusedMeasure->IsEnabled() || res != OK || !frameOrig)
+	{
+		if (frameOrig)
+		{
+			ColorConversion(*frameOrig, *frame);
+		}
+		frame->SetInfo(FRAME_STATS, QVariant());
+		return res;
+	}
+
+	// Reference frame of same time, if its source has read it already
+	unsigned int refViewId = 0;
+	FramePtr ref = m_FusedMeasure->FindReferenceFrame(m_ViewID, frameOrig->PTS(), refViewId);
+
+	FrameStatsPtr stats(new FrameStats);
+	FrameStatsSink sink(stats.data(), ref.data());
+	ColorConversion(*frameOrig, *frame, &sink);
+	frame->SetInfo(FRAME_STATS, qVariantFromValue(stats));
+
+	return res;
+}
+
 /*void SourceThread::VideoFormatReset()
 {
 	m_VideoFormatReset = true;
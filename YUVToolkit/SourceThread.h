@@ -13,14 +13,17 @@ class Renderer;
 class Format;
 class QDockWidget;
 class VideoView;
+class FusedMeasure;
 
+// Smallest number of frames read ahead, FramePool grows from there when
+// playback runs out of frames
 #define BUFFER_COUNT 4
 
 class SourceThread : public QThread
 {
 	Q_OBJECT;
 public:
-	SourceThread(SourceCallback* cb, int id, PlaybackControl* c, const char* path);
+	SourceThread(SourceCallback* cb, int id, PlaybackControl* c, FusedMeasure* fused, const char* path);
 	~SourceThread(void);
 
 	void Start();
@@ -43,10 +46,14 @@ private slots:
 private:
 	void run();
 	void EnsureFrameFormat(FramePtr frame, FormatPtr format);
+	// Reads frame, converting it if needed. Statistics of converted frames
+	// are computed in the same pass if fused measures are enabled
+	RESULT ReadFrame(FramePtr frame, FramePtr frameOrig);
 	
 private:
 	volatile int m_ViewID;
 	unsigned int m_LastSeekingPTS;
+	unsigned int m_NextPTS; // NEXT_PTS of last frame read
 	QString m_Path;
 	Source* m_Source;
 	volatile bool m_EndOfFile;
@@ -56,6 +63,7 @@ private:
 	FramePool* m_FramePool;
 	PlaybackControl* m_Control;
 	PlaybackControl::Status m_Status;
+	FusedMeasure* m_FusedMeasure;
 
 	bool m_SourceReset;
 };
@@ -19,7 +19,7 @@
 
 VideoView::VideoView(QMainWindow* _mainWin, unsigned int viewId, RendererWidget* _parent, ProcessThread* processThread, PlaybackControl* control) :
 	m_Type(PLUGIN_UNKNOWN), m_SourceThread(NULL), m_ProcessThread(processThread),
-	m_Control(control), m_Transform(0),m_Measure(0),
+	m_Control(control), m_Transform(0), m_TransformMenu(0), m_Measure(0),
 	m_MainWindow(_mainWin), m_Menu(NULL), m_CloseAction(0),
 	m_ViewID(viewId),
 	m_ScaleNum(1), m_ScaleDen(1), m_SrcLeft(0), m_SrcTop(0), m_SrcWidth(0), m_SrcHeight(0),
@@ -33,12 +33,13 @@ VideoView::VideoView(QMainWindow* _mainWin, unsigned int viewId, RendererWidget*
 	connect(m_CloseAction, SIGNAL(triggered()), this, SLOT(close()));
 
 	m_Menu = new QMenu(m_MainWindow);
+	m_TransformMenu = new QMenu("Transform", m_MainWindow);
 }
 
 void VideoView::Init( const char* path)
 {
 	m_Type = PLUGIN_SOURCE;
-	m_SourceThread = new SourceThread(this, m_ViewID, m_Control, path);
+	m_SourceThread = new SourceThread(this, m_ViewID, m_Control, m_ProcessThread->GetFusedMeasure(), path);
 
 	// connect(this, SIGNAL(ResolutionChanged()), m_SourceThread, SLOT(ResolutionDurationChanged()));
 	connect(this, SIGNAL(ResolutionChanged()), m_MainWindow, SLOT(OnAutoResizeWindow()));
@@ -53,12 +54,10 @@ void VideoView::Init( const char* path)
 	emit ResolutionChanged();
 }
 
-void VideoView::Init( Transform* transform, VideoQueue* source, QString outputName )
+void VideoView::Init( Transform* transform, unsigned int source1, unsigned int source2 )
 {
 	m_Type = PLUGIN_TRANSFORM;
 	m_Transform = transform;
-	// m_RefVideoQueue = source;
-	m_OutputName = outputName;
 
 	connect(this, SIGNAL(ResolutionChanged()), m_MainWindow, SLOT(OnAutoResizeWindow()));
 
@@ -98,6 +97,13 @@ void VideoView::UnInit()
 
 VideoView::~VideoView()
 {
+	for (int i=0; i<m_TransformActions.size(); i++)
+	{
+		delete (TransformActionData*)m_TransformActions.at(i)->data().value<void *>();
+	}
+
+	// View may be closed from its own menu
+	m_TransformMenu->deleteLater();
 }
 
 
@@ -297,7 +303,48 @@ void VideoView::UpdateViewPort( double x, double y )
 
 void VideoView::UpdateTransformActionList()
 {
-	
+	if (m_TransformActions.size())
+	{
+		return;
+	}
+
+	// One action for every transform of every plugin
+	const QList<PlugInInfo*>& plugins = GetHostImpl()->GetTransformPluginList();
+	for (int i=0; i<plugins.size(); i++)
+	{
+		PlugInInfo* info = plugins.at(i);
+		Transform* transform = info->plugin->NewTransform(info->string);
+		if (!transform)
+		{
+			continue;
+		}
+
+		const QList<TransformCapability>& caps = transform->GetCapabilities();
+		for (int k=0; k<caps.size(); k++)
+		{
+			TransformActionData* data = new TransformActionData;
+			data->transformPlugin = info->plugin;
+			data->transformName = info->string;
+			data->transformId = caps.at(k).transformId;
+			data->outputName = caps.at(k).outputName;
+			data->parameters = caps.at(k).parameters;
+			data->need2Inputs = caps.at(k).need2Inputs;
+
+			QString text = data->outputName;
+			if (!data->parameters.isEmpty())
+			{
+				text += "...";
+			}
+			QAction* action = new QAction(text, this);
+			action->setData(qVariantFromValue((void*)data));
+			connect(action, SIGNAL(triggered()), this, SLOT(OnTransformTriggered()));
+
+			m_TransformActions.append(action);
+			m_TransformMenu->addAction(action);
+		}
+
+		info->plugin->ReleaseTransform(transform);
+	}
 }
 
 void VideoView::close()
@@ -366,6 +413,17 @@ void VideoView::ResolutionDurationChanged()
 	emit ResolutionChanged();
 }
 
+void VideoView::DurationExtended()
+{
+	// Frames in queues stay valid, so source is not reset
+	if (m_SourceThread)
+	{
+		m_SourceThread->GetSource()->GetInfo(m_SourceInfo);
+	}
+
+	emit DurationChanged();
+}
+
 
 void VideoView::OnDockFloating(bool f)
 {
@@ -394,6 +452,15 @@ void VideoView::UpdateMenu()
 		m_Menu->addAction(m_Dock->toggleViewAction());
 	}
 
+	if (m_Type == PLUGIN_SOURCE || m_Type == PLUGIN_TRANSFORM)
+	{
+		UpdateTransformActionList();
+		if (m_TransformActions.size())
+		{
+			m_Menu->addMenu(m_TransformMenu);
+		}
+	}
+
 	m_Menu->addSeparator();
 	m_Menu->addAction(GetCloseAction());
 }
@@ -439,6 +506,30 @@ void VideoView::setTimeStamps( QList<unsigned int> lst)
 	}
 }
 
+QVariantMap VideoView::statistics( int plane )
+{
+	QVariantMap result;
+	FrameStatsPtr stats = m_LastFrame?m_LastFrame->Info(FRAME_STATS).value<FrameStatsPtr>():FrameStatsPtr();
+	if (!stats || !stats->hasHistogram || plane<0 || plane>=stats->planes)
+	{
+		return result;
+	}
+
+	const PlaneStats& s = stats->plane[plane];
+	QVariantList histogram;
+	for (int v=0; v<256; v++)
+	{
+		histogram.append(s.histogram[v]);
+	}
+
+	result.insert("min", s.min);
+	result.insert("max", s.max);
+	result.insert("mean", s.Mean());
+	result.insert("variance", s.Variance());
+	result.insert("histogram", histogram);
+	return result;
+}
+
 void VideoView::SetLastFrame( FramePtr f )
 {
 	m_LastFrame = f;
@@ -446,10 +537,21 @@ void VideoView::SetLastFrame( FramePtr f )
 	{
 		m_SourceInfo.format = FormatPtr(new FormatImpl);
 	}
+
+	// Frames that are scaled up by renderer, like distortion maps, 
+	// take the size of the video they were computed from
+	FormatPtr format = f->Format();
+	if (f->HasInfo(RENDER_SRC_SCALE_X))
+	{
+		format = FormatPtr(new FormatImpl);
+		*format = *(f->Format());
+		format->SetWidth(qRound(f->Format()->Width()/f->Info(RENDER_SRC_SCALE_X).toFloat()));
+		format->SetHeight(qRound(f->Format()->Height()/f->Info(RENDER_SRC_SCALE_Y).toFloat()));
+	}
 	
-	if (*(m_SourceInfo.format) != *(f->Format()))
+	if (*(m_SourceInfo.format) != *format)
 	{
-		*(m_SourceInfo.format) = *(f->Format());
+		*(m_SourceInfo.format) = *format;
 
 		emit ResolutionChanged();
 	}
@@ -24,7 +24,10 @@ struct TransformActionData
 {
 	YTPlugIn* transformPlugin;
 	QString transformName;
+	unsigned int transformId;
 	QString outputName;
+	QString parameters;
+	bool need2Inputs;
 };
 
 #define VV_SOURCE(vv)  ((vv)?vv->GetSource():NULL)
@@ -38,7 +41,7 @@ class VideoView : public QObject, public SourceCallback
 	friend class VideoViewList;
 private:
 	void Init(const char* path); // for source view
-	void Init(Transform* transform, VideoQueue* source, QString outputName); // for tranform view
+	void Init(Transform* transform, unsigned int source1, unsigned int source2); // for tranform view
 	void Init(unsigned int source, unsigned int processed); // for measure view
 	void UnInit();
 public:
@@ -78,6 +81,7 @@ public:
 
 	void ShowGui(Source*, bool show);
 	void ResolutionDurationChanged();
+	void DurationExtended();
 
 	void UpdateMenu();
 	QMenu* GetMenu();
@@ -87,6 +91,7 @@ signals:
 	void TransformTriggered(QAction*, VideoView*, TransformActionData*);
 
 	void ResolutionChanged(); // Change of resolution during playback
+	void DurationChanged(); // Frames were appended, nothing is reset
 	void SourceReset(unsigned int); // Change of resolution by user, so there might be multi frames of same PTS
 public slots:
 	void close();
@@ -95,6 +100,9 @@ public slots:
 	void setTitle(QString title);
 	QString title();
 	void setTimeStamps(QList<unsigned int>);
+	// Min, max, mean, variance and histogram of a plane of the frame shown,
+	// empty unless statistics are enabled
+	QVariantMap statistics(int plane);
 
 	void OnTransformTriggered();
 	void OnDockFloating(bool);
@@ -112,6 +120,8 @@ private:
 	PlaybackControl* m_Control;
 	Transform* m_Transform; // Used for transform view
 	QString m_OutputName;
+	QMenu* m_TransformMenu;
+	QList<QAction*> m_TransformActions;
 	Measure* m_Measure; // Used for measure view
 	// Render_Frame* m_RenderFrame;
 	QMainWindow* m_MainWindow;
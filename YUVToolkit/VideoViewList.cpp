@@ -14,7 +14,7 @@ VideoViewList::VideoViewList(QMainWindow* mainWindow, RendererWidget* rw) :
 	m_RenderWidget(rw), m_MainWindow(mainWindow),
 	m_IDCounter(0), m_RenderThread(NULL),
 	m_ProcessThread(NULL), m_Duration(0), m_VideoCount(0),
-	m_EndOfFile(false)
+	m_EndOfFile(false), m_StatisticsUsers(0)
 {
 	m_ProcessThread = new ProcessThread(&m_Control);
 	connect(m_RenderWidget,SIGNAL(fullscreen()),this,SIGNAL(fullscreen()));
@@ -46,6 +46,7 @@ VideoView* VideoViewList::NewVideoViewInternal( QString title, unsigned int view
 
 	// m_RenderThread->Start();
 	connect(vv, SIGNAL(ResolutionChanged()), this, SLOT(VideoFormatReset()));
+	connect(vv, SIGNAL(DurationChanged()), this, SLOT(VideoFormatReset()));
 	connect(vv, SIGNAL(ViewPortUpdated(VideoView*,double,double)), this, SLOT(OnViewPortUpdated(VideoView*,double,double)));
 	connect(vv, SIGNAL(Close(VideoView*)), this, SLOT(CloseVideoView(VideoView*)));
 	connect(vv, SIGNAL(TransformTriggered(QAction*, VideoView*, TransformActionData*)), this, SLOT(OnVideoViewTransformTriggered(QAction*, VideoView*, TransformActionData*)));
@@ -66,15 +67,33 @@ void VideoViewList::CloseVideoView( VideoView* vv)
 {
 	PLUGIN_TYPE plugin = vv->GetType();
 	INFO_LOG("VideoViewList::CloseVideoView %X", vv);
-	for (int i=0; i<m_VideoList.size(); ++i) 
+
+	// Transform views are closed with the views they are computed from
+	UintList dependents;
+	for (int i=0; i<m_TransformItems.size(); ++i) 
 	{
-		// VideoView* vv2 = m_VideoList.at(i);
-		/*
-		if (vv2->GetRefVideoQueue() == vv->GetVideoQueue())
+		const TransformItem& item = m_TransformItems.at(i);
+		if (item.sourceViewId1 == vv->GetID() || (item.need2Inputs && item.sourceViewId2 == vv->GetID()))
 		{
-			CloseVideoView(vv2);
-			i = 0; 
-		}*/
+			dependents.append(item.viewId);
+		}
+	}
+	for (int i=0; i<dependents.size(); ++i) 
+	{
+		CloseVideoView(dependents.at(i));
+	}
+
+	for (int i=0; i<m_TransformItems.size(); ++i) 
+	{
+		if (m_TransformItems.at(i).viewId == vv->GetID())
+		{
+			TransformItem item = m_TransformItems.takeAt(i);
+
+			// Process thread is done with the transform once this returns
+			m_ProcessThread->SetTransformRequests(m_TransformItems);
+			item.plugin->ReleaseTransform(item.transform);
+			break;
+		}
 	}
 
 	m_RenderThread->Stop();
@@ -83,8 +102,11 @@ void VideoViewList::CloseVideoView( VideoView* vv)
 	m_VideoList.removeOne(vv);
 	
 	GetProcessThread()->SetSources(GetSourceIDList());
+	// Frames of vv are no longer looked up as reference of other views
+	GetProcessThread()->GetFusedMeasure()->RemoveView(vv->GetID());
 
-	VideoFormatReset();
+	m_MergedTimeStamps.Remove(vv->GetID());
+	UpdateDuration();
 
 	if (m_VideoList.isEmpty())
 	{
@@ -125,6 +147,31 @@ void VideoViewList::CloseVideoView( unsigned int viewId )
 	}
 }
 
+void VideoViewList::SetStatisticsEnabled( int user, bool enabled )
+{
+	if (enabled)
+	{
+		m_StatisticsUsers |= user;
+	}else
+	{
+		m_StatisticsUsers &= ~user;
+	}
+
+	enabled = (m_StatisticsUsers != 0);
+	if (m_ProcessThread->IsStatisticsEnabled() == enabled)
+	{
+		return;
+	}
+	m_ProcessThread->SetStatisticsEnabled(enabled);
+
+	PlaybackControl::Status status;
+	m_Control.GetStatus(&status);
+	if (enabled && !status.isPlaying && status.lastProcessPTS != INVALID_PTS && m_VideoList.size()>0)
+	{
+		m_Control.Seek(status.lastProcessPTS, false);
+	}
+}
+
 void VideoViewList::CheckRenderReset()
 {
 	if (m_RenderThread && m_RenderWidget->GetRenderer()->NeedReset())
@@ -333,29 +380,92 @@ public:
 
 void VideoViewList::OnVideoViewTransformTriggered( QAction* action, VideoView* vv, TransformActionData *data)
 {
-	bool hasView = false;
-	for (int i=0; i<m_VideoList.size(); ++i) 
+	TransformItem item;
+	item.plugin = data->transformPlugin;
+	item.need2Inputs = data->need2Inputs;
+	item.sourceViewId1 = vv->GetID();
+	item.sourceViewId2 = vv->GetID();
+
+	if (data->need2Inputs)
 	{
-		// VideoView* vv2 = m_VideoList.at(i);
-		/*
-		if (vv2->GetType() == PLUGIN_TRANSFORM && vv2->GetRefVideoQueue() == 
-			vv->GetVideoQueue() && vv2->GetOutputName() == data->outputName)
+		// Other input is the reference, by default the first source that is
+		// not vv, which is also the reference of measures
+		UintList sources = GetSourceIDList();
+		sources.removeAll(vv->GetID());
+		if (!sources.size())
+		{
+			QMessageBox::warning(m_MainWindow, data->outputName, "Open another video to compare with first.");
+			return;
+		}
+		item.sourceViewId2 = sources.first();
+
+		if (sources.size() > 1)
 		{
-			hasView = true;
-			CloseVideoView(vv2);
-		}*/
+			QStringList titles;
+			for (int i=0; i<sources.size(); i++)
+			{
+				VideoView* ref = find(sources.at(i));
+				titles.append(QString("[%1] %2").arg(sources.at(i)).arg(ref?ref->title():QString()));
+			}
+
+			bool ok = false;
+			QString title = QInputDialog::getItem(m_MainWindow, data->outputName, "Reference:", 
+				titles, 0, false, &ok);
+			if (!ok)
+			{
+				return;
+			}
+			item.sourceViewId2 = sources.at(titles.indexOf(title));
+		}
 	}
 
-	if (!hasView)
+	QString parameters = data->parameters;
+	if (!parameters.isEmpty())
 	{
-		VideoView* planeVv = NewVideoViewInternal(data->outputName.toAscii(), m_IDCounter++);
+		bool ok = false;
+		parameters = QInputDialog::getText(m_MainWindow, data->outputName, "Parameters:", 
+			QLineEdit::Normal, parameters, &ok);
+		if (!ok)
+		{
+			return;
+		}
+	}
 
-		Transform* transform = data->transformPlugin->NewTransform(data->transformName);
+	item.transform = data->transformPlugin->NewTransform(data->transformName);
+	if (!item.transform)
+	{
+		return;
+	}
+	if (item.transform->Init(data->transformId, parameters) != OK)
+	{
+		data->transformPlugin->ReleaseTransform(item.transform);
+		QMessageBox::warning(m_MainWindow, data->outputName, "Invalid parameters: " + parameters);
+		return;
+	}
 
-		planeVv->Init(transform, vv->GetVideoQueue(), data->outputName);
+	QString title;
+	QTextStream(&title) << data->outputName << " of [" << item.sourceViewId1 << "]";
+	if (item.need2Inputs)
+	{
+		QTextStream(&title) << " and [" << item.sourceViewId2 << "]";
 	}
 
-	action->setChecked(!hasView);
+	item.viewId = m_IDCounter++;
+	VideoView* transformVv = NewVideoViewInternal(title, item.viewId);
+	transformVv->Init(item.transform, item.sourceViewId1, item.sourceViewId2);
+
+	m_TransformItems.append(item);
+	m_ProcessThread->SetTransformRequests(m_TransformItems);
+
+	emit VideoViewListChanged();
+
+	// Compute it for the scene shown now
+	PlaybackControl::Status status;
+	m_Control.GetStatus(&status);
+	if (!status.isPlaying)
+	{
+		m_Control.Seek(status.lastProcessPTS, false);
+	}
 }
 
 void VideoViewList::OnSceneRendered( FrameListPtr scene, unsigned int pts, bool seeking )
@@ -464,30 +574,32 @@ VideoView* VideoViewList::NewVideoViewCompare(QString measureName, unsigned int
 
 void VideoViewList::VideoFormatReset()
 {
-	// Recompute the time stamp list
-	m_MergedTimeStamps.clear();
-	m_MergedTimeStamps.append(0);
-	m_Duration = 0;
-
-	for (int i=0; i<size(); ++i) 
+	// Only merge time stamps of the view that changed
+	VideoView* vv = qobject_cast<VideoView*>(sender());
+	if (vv && m_VideoList.contains(vv))
 	{
-		VideoView* vv = at(i);
 		SourceThread* st = vv->GetSourceThread();
 		if (st)
 		{
-			SourceInfo* info = vv->GetSourceInfo();
-			if (info->duration>m_Duration)
-			{
-				m_Duration = info->duration;
-			}
-
 			QList<unsigned int> timeStamps;
 			st->GetSource()->GetTimeStamps(timeStamps);
-			m_MergedTimeStamps.append(timeStamps);
+			m_MergedTimeStamps.Update(vv->GetID(), timeStamps);
+		}
+	}
 
-			QSet<unsigned int> set = m_MergedTimeStamps.toSet();
-			m_MergedTimeStamps = set.toList();
-			qSort(m_MergedTimeStamps.begin(), m_MergedTimeStamps.end());
+	UpdateDuration();
+}
+
+void VideoViewList::UpdateDuration()
+{
+	m_Duration = 0;
+
+	for (int i=0; i<size(); ++i) 
+	{
+		SourceInfo* info = at(i)->GetSourceInfo();
+		if (info && info->duration>m_Duration)
+		{
+			m_Duration = info->duration;
 		}
 	}
 }
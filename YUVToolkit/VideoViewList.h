@@ -4,6 +4,7 @@
 #include "YT_InterfaceImpl.h"
 #include "RenderThread.h"
 #include "ProcessThread.h"
+#include "MergedTimeline.h"
 
 class VideoView;
 struct TransformActionData;
@@ -12,6 +13,9 @@ class SourceThread;
 class QMainWindow;
 class QAction;
 
+// Users of statistics, each turns them on and off for itself
+#define STATISTICS_HISTOGRAM_WINDOW	1
+#define STATISTICS_SCRIPT			2
 
 class VideoViewList : public QObject
 {
@@ -30,7 +34,7 @@ public:
 	RenderThread* GetRenderThread() {return m_RenderThread;}
 	ProcessThread* GetProcessThread() {return m_ProcessThread;}
 	PlaybackControl* GetControl() {return &m_Control;}
-	const QList<unsigned int>& GetMergedTimeStamps() {return m_MergedTimeStamps;}
+	const MergedTimeline& GetMergedTimeStamps() {return m_MergedTimeStamps;}
 
 	//bool GetRenderFrameList(QList<Render_Frame>& list, unsigned int& pts);
 	unsigned int GetDuration() {return m_Duration;}
@@ -46,8 +50,13 @@ public:
 	VideoView* NewVideoViewCompare(QString measureName, unsigned int viewId, unsigned int orig, unsigned int processed);
 
 	void CloseVideoView(unsigned int viewId);
+
+	// Histograms of frames shown, on while any STATISTICS_* user wants them.
+	// Scene shown now is computed again if paused.
+	void SetStatisticsEnabled(int user, bool enabled);
 private:
 	VideoView* NewVideoViewInternal(QString title, unsigned int viewId);
+	void UpdateDuration();
 public slots:
 	void CloseVideoView(VideoView*);
 	void OnUpdateRenderWidgetPosition();
@@ -55,7 +64,7 @@ public slots:
 	void OnSceneRendered(FrameListPtr scene, unsigned int pts, bool seeking);
 	void OnViewPortUpdated(VideoView*, double x, double y);
 
-	void VideoFormatReset();
+	void VideoFormatReset(); // time stamps of sending view have changed
 signals:
 	void VideoViewCreated(VideoView*);
 	void VideoViewClosed(VideoView*);
@@ -66,7 +75,7 @@ signals:
 private:
 	RendererWidget* m_RenderWidget;
 	QList<VideoView*> m_VideoList;
-	QList<unsigned int> m_MergedTimeStamps;
+	MergedTimeline m_MergedTimeStamps;
 	QMainWindow* m_MainWindow;
 
 	unsigned int m_IDCounter;
@@ -75,9 +84,12 @@ private:
 	RenderThread* m_RenderThread;
 	ProcessThread* m_ProcessThread;
 
+	QList<TransformItem> m_TransformItems;
+
 	unsigned int m_Duration;
 	unsigned int m_VideoCount;
 	bool m_EndOfFile;
+	int m_StatisticsUsers; // STATISTICS_* bits
 };
 
 #endif
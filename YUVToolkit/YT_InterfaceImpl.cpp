@@ -2,6 +2,7 @@
 #include "YT_InterfaceImpl.h"
 #include "MainWindow.h"
 #include "Settings.h"
+#include "FrameBuffer.h"
 
 #include <stdint.h>
 #include <string.h>
@@ -368,7 +369,7 @@ void FrameImpl::Deallocate()
 {
 	if (allocated_data)
 	{
-		delete []allocated_data;
+		FrameBufferArena::Instance()->Release(allocated_data, allocated_size);
 
 		memset(data, 0, sizeof(data));
 
@@ -442,34 +443,40 @@ void FrameImpl::SetFrameNumber( unsigned int value )
 	frame_num = value;
 }
 
-#define DEFAULT_ALIGNMENT	32
+// Buffers come from FrameBufferArena, which is page aligned, and rounded
+// up to its size classes, so a frame keeps its buffer across small format
+// changes.
 RESULT FrameImpl::Allocate()
 {
-	size_t data_length = format->PlaneSize(0)+format->PlaneSize(1)+
-		format->PlaneSize(2)+format->PlaneSize(3);
-
-	size_t align_margin = DEFAULT_ALIGNMENT*4;
+	size_t data_length = 0;
+	for (int i=0; i<4; i++)
+	{
+		data_length += (format->PlaneSize(i)+FRAME_BUFFER_ALIGNMENT-1)&~(size_t)(FRAME_BUFFER_ALIGNMENT-1);
+	}
 
-	if (data_length+align_margin>allocated_size)
+	if (data_length>allocated_size)
 	{
 		if (allocated_data)
 		{
 			Deallocate();
 		}
 
-		allocated_data = new unsigned char[data_length+align_margin];
-		allocated_size = data_length+align_margin;
+		size_t size = data_length;
+		allocated_data = FrameBufferArena::Instance()->Allocate(size);
+		allocated_size = size;
+		if (!allocated_data)
+		{
+			return E_UNKNOWN;
+		}
 	}
 
 	unsigned char* d = allocated_data;
 	for (int i=0; i<4; i++)
 	{
-		while (((unsigned long)d) & (DEFAULT_ALIGNMENT-1))
-			d ++;
 		if (format->PlaneSize(i)>0)
 		{
 			data[i] = d;
-			d += format->PlaneSize(i);
+			d += (format->PlaneSize(i)+FRAME_BUFFER_ALIGNMENT-1)&~(size_t)(FRAME_BUFFER_ALIGNMENT-1);
 		}
 	}
 
@@ -514,16 +521,25 @@ void FrameImpl::Recyle( Frame *obj )
 
 QVariant FrameImpl::Info( INFO_KEY key) const
 {
+	QMutexLocker locker(&infoMutex);
 	return info.value(key);
 }
 
 void FrameImpl::SetInfo( INFO_KEY key, QVariant value)
 {
+	QMutexLocker locker(&infoMutex);
 	info.insert(key, value);
 }
 
+void FrameImpl::ClearInfo()
+{
+	QMutexLocker locker(&infoMutex);
+	info.clear();
+}
+
 bool FrameImpl::HasInfo( INFO_KEY key ) const
 {
+	QMutexLocker locker(&infoMutex);
 	return info.contains(key);
 }
 
@@ -537,7 +553,7 @@ FormatPtr HostImpl::NewFormat()
 	return FormatPtr(new FormatImpl);
 }
 
-HostImpl::HostImpl(int argc, char *argv[]) : m_LogFile(this)
+HostImpl::HostImpl(int argc, char *argv[]) : m_FrameMemory(0), m_FrameMemoryBudget(0), m_LogFile(this)
 {
 	if (argc > 1)
 	{
@@ -814,13 +830,20 @@ void HostImpl::OpenLoggingDirectory()
 
 FramePool* HostImpl::NewFramePool(unsigned int size, bool canGrow)
 {
+	QSettings settings;
 	FramePool* pool = new FramePool(size, canGrow);
+
+	QMutexLocker locker(&m_MutexFramePool);
+	m_FrameMemoryBudget = ((qint64)settings.SETTINGS_GET_FRAME_MEMORY())*1024*1024;
 	m_FramePoolList.append(pool);
 	return pool;
 }
 
 void HostImpl::ReleaseFramePool(FramePool* pool)
 {
+	pool->Drain();
+
+	QMutexLocker locker(&m_MutexFramePool);
 	m_FramePoolListGC.append(pool);
 	m_FramePoolList.removeAll(pool);
 
@@ -833,6 +856,40 @@ void HostImpl::ReleaseFramePool(FramePool* pool)
 	}*/
 }
 
+bool HostImpl::AddFrameMemory( qint64 bytes, bool force )
+{
+	QMutexLocker locker(&m_MutexFramePool);
+	if (!force && m_FrameMemory+bytes > m_FrameMemoryBudget)
+	{
+		return false;
+	}
+
+	m_FrameMemory += bytes;
+	return m_FrameMemory <= m_FrameMemoryBudget;
+}
+
+void HostImpl::GetFramePoolStats( int& pools, int& inUse, int& capacity, qint64& bytes, qint64& budget )
+{
+	// Pools lock themselves before HostImpl, so do not hold both
+	m_MutexFramePool.lock();
+	QList<FramePool*> poolList = m_FramePoolList;
+	budget = m_FrameMemoryBudget;
+	m_MutexFramePool.unlock();
+
+	pools = poolList.size();
+	inUse = capacity = 0;
+	bytes = 0;
+	for (int i=0; i<poolList.size(); i++)
+	{
+		int poolInUse, poolCapacity;
+		qint64 poolBytes;
+		poolList.at(i)->GetStats(poolInUse, poolCapacity, poolBytes);
+		inUse += poolInUse;
+		capacity += poolCapacity;
+		bytes += poolBytes;
+	}
+}
+
 FrameListPtr HostImpl::GetFrameList()
 {
 	QMutexLocker locker(&m_MutexFrameListPool);
@@ -860,12 +917,15 @@ void HostImpl::RecyleFrameList( FrameList* frameList)
 	GetHostImpl()->ReleaseFrameList(frameList);
 }
 
-FramePool::FramePool( unsigned int size, bool canGrow ) : m_CanGrow(canGrow)
+FramePool::FramePool( unsigned int size, bool canGrow ) : m_CanGrow(canGrow),
+	m_MinCapacity(size), m_Capacity(size), m_InUse(0), m_FrameSize(0), m_Reserved(0)
 {
 	for (unsigned int i=0; i<size; i++)
 	{
 		m_Pool.append(new FrameImpl(this));
 	}
+
+	ResetSamples();
 }
 
 FramePool::~FramePool()
@@ -880,31 +940,141 @@ void FramePool::Recycle( Frame* frame )
 {
 	QMutexLocker locker(&m_Mutex);
 
+	m_InUse--;
+	m_FrameSize = static_cast<FrameImpl*>(frame)->AllocatedSize();
+	if (m_InUse+m_Pool.size() >= m_Capacity)
+	{
+		// Pool has shrunk, buffer goes back to FrameBufferArena
+		delete frame;
+		return;
+	}
+
 	m_Pool.append(frame);
 }
 
 FramePtr FramePool::Get()
 {
-	if (m_Pool.size())
+	QMutexLocker locker(&m_Mutex);
+
+	if (!m_CanGrow && m_InUse >= m_Capacity)
+	{
+		return FramePtr(NULL);
+	}
+
+	Frame* frame = m_Pool.size()?m_Pool.takeFirst():new FrameImpl(this);
+	// Info of the frame it held before, like cached FRAME_STATS, is stale
+	static_cast<FrameImpl*>(frame)->ClearInfo();
+	m_InUse++;
+	m_PeakInUse = qMax(m_PeakInUse, m_InUse);
+	return FramePtr(frame, FrameImpl::Recyle);
+}
+
+int FramePool::Size()
+{
+	QMutexLocker locker(&m_Mutex);
+
+	return m_CanGrow?m_Pool.size():(m_Capacity-m_InUse);
+}
+
+void FramePool::ResetSamples()
+{
+	m_AdaptTime.start();
+	m_PeakInUse = m_InUse;
+	m_MinInUse = m_InUse;
+	m_UnderrunSamples = 0;
+	m_FullSamples = 0;
+}
+
+void FramePool::SetCapacity( int capacity )
+{
+	if (capacity != m_Capacity)
+	{
+		INFO_LOG("Frame pool %p capacity %d -> %d, frame size %d", this, m_Capacity, capacity, (int)m_FrameSize);
+	}
+	m_Capacity = capacity;
+
+	while (m_Pool.size() && m_InUse+m_Pool.size() > m_Capacity)
+	{
+		delete m_Pool.takeLast();
+	}
+}
+
+void FramePool::Adapt( bool measureLag )
+{
+	QMutexLocker locker(&m_Mutex);
+
+	if (measureLag)
 	{
-		QMutexLocker locker(&m_Mutex);
+		m_MinInUse = qMin(m_MinInUse, m_InUse);
+		// Consumer has nothing queued but the frame it shows
+		if (m_InUse <= 1)
+		{
+			m_UnderrunSamples++;
+		}
+		if (m_InUse >= m_Capacity)
+		{
+			m_FullSamples++;
+		}
+	}
 
-		Frame* frame = m_Pool.takeFirst();
-		return FramePtr(frame, FrameImpl::Recyle);
+	if (m_AdaptTime.elapsed() < FRAME_POOL_ADAPT_INTERVAL)
+	{
+		return;
 	}
 
+	// Reserve memory for frames at new size of frames
+	qint64 reserved = (qint64)m_Capacity*m_FrameSize;
+	bool withinBudget = GetHostImpl()->AddFrameMemory(reserved-m_Reserved, true);
+	m_Reserved = reserved;
+
+	int capacity = m_Capacity;
 	if (m_CanGrow)
 	{
-		return FramePtr(new FrameImpl(this));
-	}else
+		// Keep as many free frames as were used at once
+		capacity = qMax(m_PeakInUse, m_MinCapacity);
+	}else if (!withinBudget)
 	{
-		return FramePtr(NULL);
+		capacity = qMax(m_Capacity-1, m_MinCapacity);
+	}else if (m_UnderrunSamples > 0 && m_FullSamples > 0)
+	{
+		// Producer could have read ahead more when consumer ran dry
+		if (m_Capacity < FRAME_POOL_MAX_FRAMES && GetHostImpl()->AddFrameMemory(m_FrameSize, false))
+		{
+			m_Reserved += m_FrameSize;
+			capacity = m_Capacity+1;
+		}
+	}else if (measureLag && m_UnderrunSamples == 0 && m_MinInUse > 2)
+	{
+		// Frames were always queued, one less is enough
+		capacity = qMax(m_Capacity-1, m_MinCapacity);
 	}
+
+	SetCapacity(capacity);
+
+	reserved = (qint64)m_Capacity*m_FrameSize;
+	GetHostImpl()->AddFrameMemory(reserved-m_Reserved, true);
+	m_Reserved = reserved;
+
+	ResetSamples();
 }
 
-int FramePool::Size()
+void FramePool::Drain()
+{
+	QMutexLocker locker(&m_Mutex);
+
+	GetHostImpl()->AddFrameMemory(-m_Reserved, true);
+	m_Reserved = 0;
+	m_MinCapacity = 0;
+	SetCapacity(0);
+}
+
+void FramePool::GetStats( int& inUse, int& capacity, qint64& bytes )
 {
-	return m_Pool.size();
+	QMutexLocker locker(&m_Mutex);
+
+	inUse = m_InUse;
+	capacity = m_Capacity;
+	bytes = (qint64)(m_InUse+m_Pool.size())*m_FrameSize;
 }
 
 PlaybackControl::PlaybackControl()
@@ -80,11 +80,13 @@ public:
 	virtual bool HasInfo(INFO_KEY) const;
 	virtual QVariant Info(INFO_KEY) const;
 	virtual void SetInfo(INFO_KEY, QVariant);
+	void ClearInfo();
 
 	// Given the format, allocate the memory and populate Data
 	RESULT Allocate();
 	// Reset the internal buffer, call me before changing the format
 	RESULT Reset();
+	size_t AllocatedSize() const {return allocated_size;}
 
 	static void Recyle(Frame *obj);
 private:
@@ -99,21 +101,60 @@ private:
 	FormatPtr format;
 	FramePool* pool;
 
+	// Host caches FRAME_STATS on frames other threads are reading
+	mutable QMutex infoMutex;
 	QMap<INFO_KEY, QVariant> info;
 };
 
+// Largest number of frames a pool that can not grow may hand out
+#define FRAME_POOL_MAX_FRAMES		64
+// Interval in ms between pool size changes
+#define FRAME_POOL_ADAPT_INTERVAL	500
+
+// Pool of frames that are handed out at most Capacity() at a time. Capacity
+// starts at the initial size and is changed by Adapt(..) while playing: it
+// grows when the consumer ran out of frames although the producer was
+// blocked on a full pool, as long as the memory budget of HostImpl allows,
+// and shrinks when frames were never needed. Pools that can grow hand out
+// any number of frames and keep as many free as were in use at once.
 class FramePool
 {
-	QList<Frame*> m_Pool;
+	QList<Frame*> m_Pool; // free frames
 	QMutex m_Mutex;
 	bool m_CanGrow;
+
+	int m_MinCapacity;
+	int m_Capacity;
+	int m_InUse;
+	size_t m_FrameSize;
+	qint64 m_Reserved; // bytes reserved from the budget
+
+	// Collected since last change of capacity
+	QTime m_AdaptTime;
+	int m_PeakInUse;
+	int m_MinInUse;
+	int m_UnderrunSamples;
+	int m_FullSamples;
+
+	void ResetSamples();
+	void SetCapacity(int capacity);
 public:
 	FramePool(unsigned int size, bool canGrow);
 	virtual ~FramePool();
 
 	FramePtr Get();
 	void Recycle(Frame* frame);
+	// Number of frames left before the pool is exhausted, free frames
+	// for pools that can grow
 	int Size();
+
+	// Sample consumer lag, call regularly from producer. Samples are only
+	// counted when measureLag is true, i.e. during normal playback.
+	void Adapt(bool measureLag);
+	// Owner is done with the pool, frames returned later are deleted
+	void Drain();
+
+	void GetStats(int& inUse, int& capacity, qint64& bytes);
 };
 
 struct PlugInInfo
@@ -137,6 +178,9 @@ class HostImpl : public QObject, public Host
 	QList<PlugInInfo*> m_MeasureList;
 	QList<FramePool*> m_FramePoolList;
 	QList<FramePool*> m_FramePoolListGC;
+	QMutex m_MutexFramePool;
+	qint64 m_FrameMemory;
+	qint64 m_FrameMemoryBudget;
 
 	volatile bool m_LoggingEnabled;
 	QFile m_LogFile;
@@ -165,6 +209,10 @@ public:
 
 	FramePool* NewFramePool(unsigned int size, bool canGrow);
 	void ReleaseFramePool(FramePool*);
+	// Memory reserved by frame pools, returns false if over budget
+	bool AddFrameMemory(qint64 bytes, bool force);
+	// Occupancy of all active frame pools
+	void GetFramePoolStats(int& pools, int& inUse, int& capacity, qint64& bytes, qint64& budget);
 
 	FrameListPtr GetFrameList();
 	void ReleaseFrameList(FrameList*);
@@ -250,4 +298,14 @@ struct MeasureItem
 	MeasureOperation op;
 };
 
+struct TransformItem
+{
+	YTPlugIn* plugin;
+	Transform* transform;
+	bool need2Inputs;
+	unsigned int viewId;
+	unsigned int sourceViewId1;
+	unsigned int sourceViewId2;
+};
+
 #endif // INTERFACE_IMPL_H
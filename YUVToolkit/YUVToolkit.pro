@@ -20,7 +20,15 @@ HEADERS += ./ColorConversion.h \
 	./YT_InterfaceImpl.h \
 	../Plugins/YT_Interface.h \
 	./YTApplication.h \
-	./ColorMap.h
+	./ColorMap.h \
+	./MeasureHistory.h \
+	./GraphWindow.h \
+	./MeasureScanner.h \
+	./FrameBuffer.h \
+	./MergedTimeline.h \
+	./FrameStats.h \
+	./HistogramWindow.h \
+	./PixelWindow.h
 SOURCES += \
 	./ColorConversion.cpp \
 	./Layout.cpp \
@@ -36,7 +44,15 @@ SOURCES += \
 	./VideoViewList.cpp \
 	./YT_InterfaceImpl.cpp \
 	./YTApplication.cpp \
-	./ColorMap.cpp
+	./ColorMap.cpp \
+	./MeasureHistory.cpp \
+	./GraphWindow.cpp \
+	./MeasureScanner.cpp \
+	./FrameBuffer.cpp \
+	./MergedTimeline.cpp \
+	./FrameStats.cpp \
+	./HistogramWindow.cpp \
+	./PixelWindow.cpp
 FORMS += ./MainWindow.ui \
 	 ./Options.ui
 RESOURCES += YUVToolkit.qrc
@@ -58,9 +74,22 @@ VERSION_4 = $$cat(../Setup/VERSION_4)
 VERSION = $${VERSION_1}.$${VERSION_2}.$${VERSION_3}.$${VERSION_4}
 
 FFMPEG_DIR = $$PWD/../3rdparty/ffmpeg
+QWT_DIR = $$PWD/../3rdparty/qwt
 QT_LIBS = Core Gui Script ScriptTools OpenGL
 win32 {
+	# Headers match the prebuilt Qwt 6.0.2 libraries next to them
+	INCLUDEPATH += $${QWT_DIR}/include
 	LIBS += -L"$${FFMPEG_DIR}/lib_win32"
+	LIBS += -L"$${QWT_DIR}/lib_win32"
+	DEFINES += QWT_DLL
+
+	CONFIG(debug, debug|release) {
+		LIBS += -lqwtd
+		EXTRA_DLLS += $${QWT_DIR}/lib_win32/qwtd.dll
+	} else {
+		LIBS += -lqwt
+		EXTRA_DLLS += $${QWT_DIR}/lib_win32/qwt.dll
+	}
 
 	EXTRA_DLLS += \
 		$${FFMPEG_DIR}/bin/swscale-0.dll \
@@ -134,6 +163,18 @@ linux-g++ {
 	LIBS += -lX11
 }
 
+# Installed Qwt is used with its own headers, the vendored ones only match
+# the Windows libraries. Its qwt.prf sets up headers and library, otherwise
+# pass QWT_INCLUDE and QWT_LIB to qmake.
+!win32 {
+	isEmpty(QWT_INCLUDE) {
+		CONFIG += qwt
+	} else {
+		INCLUDEPATH += $${QWT_INCLUDE}
+		LIBS += -L$${QWT_LIB} -lqwt
+	}
+}
+
 LIBS += -lswscale
 
 OTHER_FILES += \
@@ -3,6 +3,7 @@ TEMPLATE = subdirs
 SUBDIRS  = \
     Plugins/YT_GLRenderer \
     Plugins/YT_MeasuresBasic \
+    Plugins/YT_Transforms \
     Plugins/YTS_Raw
 
 win32 {